@@ -0,0 +1,178 @@
+/* fsbench.c - checks and timing loops over the kernel's file system and
+ * RTC code, run by main.c on the host
+ */
+
+#include "types.h"
+#include "lib.h"
+#include "filesys.h"
+#include "rtc.h"
+#include "hostlib.h"
+
+#define BENCH_NAMES     4096        /* names looked up per round, at most */
+#define SMALL_READ      64
+#define SMALL_STRIDE    4093        /* so small reads land all over a block */
+#define CMOS_REG_A      (REG_A & (CMOS_REGS - 1))
+
+static uint8_t names[BENCH_NAMES][FILENAME_LEN + 1];
+static uint32_t files[BENCH_NAMES];     /* inodes of the regular files */
+static uint8_t buf[NUM_B_IN_FOUR_KB];
+
+/* rate_hz
+ * DESCRIPTION: interrupt frequency of an RTC rate (low nibble of register
+ *              A) with the 32.768kHz time base. Rates 1 and 2 are the same
+ *              as 8 and 9 instead of being faster
+ * INPUTS: rate -- 0 to 15
+ * OUTPUTS: none
+ * RETURN VALUE: frequency in Hz, 0 if the rate turns interrupts off
+ */
+static uint32_t rate_hz(uint32_t rate) {
+    if (rate == 0)
+        return 0;
+    if (rate <= 2)
+        rate += 7;
+    return 32768 >> (rate - 1);
+}
+
+/* rtc_rate_check
+ * DESCRIPTION: checks that rtc_write programs every frequency it accepts,
+ *              keeps the time base bits of register A, and refuses the
+ *              others without touching the chip
+ * INPUTS: none
+ * OUTPUTS: a line for the first failure
+ * RETURN VALUE: 0 if all is well, -1 if not
+ */
+int rtc_rate_check(void) {
+    static const int32_t bad[] = {0, 1, 3, 100, 2048, -2};
+    int32_t freq;
+    uint32_t i, before;
+
+    /* divider bits 010, 1024Hz */
+    outb(REG_A, REG_RTC_SEL);
+    outb(0x26, REG_RTC_VAL);
+
+    for (freq = 2; freq <= 1024; freq <<= 1) {
+        if (rtc_write(&freq, sizeof(freq)) == -1) {
+            host_fail("rtc_write refused a power of 2");
+            return -1;
+        }
+        if ((host_cmos(CMOS_REG_A) & 0xF0) != 0x20 || rate_hz(host_cmos(CMOS_REG_A) & 0x0F) != freq) {
+            host_fail("rtc_write programmed the wrong rate");
+            return -1;
+        }
+    }
+    for (i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        before = host_cmos(CMOS_REG_A);
+        if (rtc_write(&bad[i], sizeof(bad[i])) != -1 || host_cmos(CMOS_REG_A) != before) {
+            host_fail("rtc_write took a frequency that is not a power of 2 up to 1024");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* fs_bench
+ * DESCRIPTION: mounts an image and times lookups of every name, reads of
+ *              every regular file in 4KB and in small pieces, and listing
+ *              the directory, checking the results on the way
+ * INPUTS: image -- address of the image, below 4GB, writable
+ *         rounds -- times each loop goes over the whole image
+ * OUTPUTS: a host_report line per loop
+ * RETURN VALUE: 0 if all is well, -1 if not
+ */
+int fs_bench(uint32_t image, uint32_t rounds) {
+    dentry_t dentry;
+    uint32_t count, nfiles, i, r, offset, ops;
+    uint64_t start, bytes;
+    int32_t fd, n;
+
+    filesys_init(image);
+    host_process_init();
+
+    /* a boot block directory has empty slots */
+    count = nfiles = 0;
+    for (i = 0; count < BENCH_NAMES && read_dentry_by_index(i, &dentry) == 0; i++) {
+        if (dentry.filename[0] == '\0')
+            continue;
+        strncpy((int8_t*)names[count], dentry.filename, FILENAME_LEN);
+        names[count++][FILENAME_LEN] = '\0';
+        if (dentry.filetype == FILE_TYPE_FILE)
+            files[nfiles++] = dentry.inode_num;
+    }
+    if (count == 0) {
+        host_fail("no directory entries");
+        return -1;
+    }
+
+    start = host_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < count; i++) {
+            if (read_dentry_by_name(names[i], &dentry) != 0) {
+                host_fail("read_dentry_by_name missed a name");
+                return -1;
+            }
+        }
+    }
+    host_report("read_dentry_by_name", rounds * count, 0, host_ns() - start);
+
+    start = host_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < count; i++) {
+            if (read_dentry_by_name((uint8_t*)"no such file", &dentry) != -1) {
+                host_fail("read_dentry_by_name found a missing name");
+                return -1;
+            }
+        }
+    }
+    host_report("read_dentry_by_name, missing", rounds * count, 0, host_ns() - start);
+
+    ops = bytes = 0;
+    start = host_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < nfiles; i++) {
+            for (offset = 0; (n = read_data(files[i], offset, buf, sizeof(buf))) > 0; offset += n) {
+                ops++;
+                bytes += n;
+            }
+            if (n != 0 || offset != flength(files[i])) {
+                host_fail("read_data stopped short of the end");
+                return -1;
+            }
+        }
+    }
+    host_report("read_data, 4KB", ops, bytes, host_ns() - start);
+
+    ops = bytes = 0;
+    start = host_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < nfiles; i++) {
+            for (offset = 0; offset < flength(files[i]); offset += SMALL_STRIDE) {
+                if ((n = read_data(files[i], offset, buf, SMALL_READ)) <= 0) {
+                    host_fail("read_data failed inside the file");
+                    return -1;
+                }
+                ops++;
+                bytes += n;
+            }
+        }
+    }
+    host_report("read_data, 64B", ops, bytes, host_ns() - start);
+
+    ops = 0;
+    start = host_ns();
+    for (r = 0; r < rounds; r++) {
+        if ((fd = file_open((uint8_t*)".")) == -1) {
+            host_fail("cannot open the directory");
+            return -1;
+        }
+        while ((n = directory_read(fd, (int8_t*)buf, FILENAME_LEN)) > 0)
+            ops++;
+        file_close(fd);
+        if (n != 0) {
+            host_fail("directory_read failed");
+            return -1;
+        }
+    }
+    host_report("directory_read", ops, 0, host_ns() - start);
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+/* host.h - included ahead of every kernel source built by this Makefile
+ *
+ * The kernel's lib.c defines functions with the names of C library ones.
+ * They are renamed here so that the host program gets the C library's and
+ * the kernel code gets its own, as it does when it runs.
+ */
+
+#ifndef _HOST_H
+#define _HOST_H
+
+#define printf      kernel_printf
+#define snprintf    kernel_snprintf
+#define vsnprintf   kernel_vsnprintf
+#define puts        kernel_puts
+#define putc        kernel_putc
+#define strlen      kernel_strlen
+#define memset      kernel_memset
+#define memcpy      kernel_memcpy
+#define memmove     kernel_memmove
+#define strncmp     kernel_strncmp
+#define strcpy      kernel_strcpy
+#define strncpy     kernel_strncpy
+#define strtok      kernel_strtok
+
+#endif /* _HOST_H */
@@ -0,0 +1,24 @@
+/* hostlib.h - between the kernel code built for the host and the host
+ * program around it. Included from both sides, so it only uses C types
+ * the kernel's types.h and the C library agree on
+ */
+
+#ifndef _HOSTLIB_H
+#define _HOSTLIB_H
+
+#define CMOS_REGS   128
+
+/* stubs.c */
+void host_process_init(void);
+unsigned int host_cmos(unsigned int reg);
+
+/* fsbench.c, 0 when all went well */
+int rtc_rate_check(void);
+int fs_bench(unsigned int image, unsigned int rounds);
+
+/* main.c */
+unsigned long long host_ns(void);
+void host_report(const char* what, unsigned int ops, unsigned long long bytes, unsigned long long ns);
+void host_fail(const char* what);
+
+#endif /* _HOSTLIB_H */
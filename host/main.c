@@ -0,0 +1,76 @@
+/* main.c - host side of fsbench: maps the image, keeps time and prints
+ *
+ *   fsbench [-n rounds] [image]
+ *
+ * Runs the RTC rate check, then times the file system calls on the image
+ * (../student-distrib/filesys_img by default), going over it rounds times.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hostlib.h"
+
+#define DEFAULT_IMAGE   "../student-distrib/filesys_img"
+#define DEFAULT_ROUNDS  1000
+
+unsigned long long host_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void host_report(const char* what, unsigned int ops, unsigned long long bytes, unsigned long long ns) {
+    printf("%-30s %10u ops %10.1f ns/op", what, ops, ops ? (double)ns / ops : 0.0);
+    if (bytes)
+        printf(" %8.1f MB/s", ns ? bytes * 1000.0 / ns : 0.0);
+    printf("\n");
+}
+
+void host_fail(const char* what) {
+    fprintf(stderr, "fsbench: %s\n", what);
+}
+
+int main(int argc, char** argv) {
+    const char* path = DEFAULT_IMAGE;
+    unsigned int rounds = DEFAULT_ROUNDS;
+    void* image;
+    off_t size;
+    int fd, i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            rounds = atoi(argv[++i]);
+        else if (argv[i][0] != '-')
+            path = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [-n rounds] [image]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (rtc_rate_check() != 0)
+        return 1;
+    printf("rtc_write rates ok\n");
+
+    /* private and writable: the kernel code updates the image in place */
+    if ((fd = open(path, O_RDONLY)) == -1 || (size = lseek(fd, 0, SEEK_END)) <= 0) {
+        perror(path);
+        return 1;
+    }
+    image = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    printf("%s, %u rounds\n", path, rounds);
+    return (fs_bench((unsigned int)image, rounds) == 0) ? 0 : 1;
+}
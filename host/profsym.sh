@@ -0,0 +1,147 @@
+#!/bin/bash
+# profsym.sh - turns the PROF lines of a serial log into a profile.
+#
+#   profsym.sh [-f] [-k kernel] [-u dir] serial.log
+#
+#   -f          folded stacks ("shell;main;read;terminal_read_[k] 12"),
+#               one line per distinct stack, for flamegraph.pl; without it
+#               a flat profile: self and total samples per function
+#   -k file     kernel ELF (default student-distrib/bootimg)
+#   -u dir      where the user programs are, as <name>.exe or <name>
+#               with symbols (default syscalls)
+#
+# The samples come from "profile" (see student-distrib/profile.h). Kernel
+# addresses are looked up in the kernel, user addresses in the program the
+# task was running; every program is linked at the same address, so the
+# PROF_PROG lines of the dump say which one that is. Needs nm.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+KERNEL=$ROOT/student-distrib/bootimg
+UDIR=$ROOT/syscalls
+FOLDED=0
+
+while getopts "fk:u:" opt; do
+    case $opt in
+        f) FOLDED=1 ;;
+        k) KERNEL=$OPTARG ;;
+        u) UDIR=$OPTARG ;;
+        *) sed -n '4,11p' "$0"; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+LOG=$1
+if [ -z "$LOG" ] || [ ! -f "$LOG" ]; then
+    sed -n '4,11p' "$0"
+    exit 2
+fi
+if [ ! -f "$KERNEL" ]; then
+    echo "profsym.sh: no kernel $KERNEL" >&2
+    exit 2
+fi
+
+SYMS=$(mktemp)
+trap 'rm -f "$SYMS"' EXIT
+
+# "<image> <hex address> <function>" for every function, by address
+nm -n "$KERNEL" | awk '$2 ~ /^[tTwW]$/ { print "kernel", $1, $3 }' > "$SYMS"
+for prog in $(tr -d '\r' < "$LOG" | awk '$1 == "PROF_PROG" { print $3 }' | sort -u); do
+    if [ -f "$UDIR/$prog.exe" ]; then
+        f=$UDIR/$prog.exe
+    elif [ -f "$UDIR/$prog" ]; then
+        f=$UDIR/$prog
+    else
+        echo "profsym.sh: no symbols for $prog, its addresses stay hex" >&2
+        continue
+    fi
+    nm -n "$f" 2>/dev/null | awk -v img="$prog" '$2 ~ /^[tTwW]$/ { print img, $1, $3 }' >> "$SYMS"
+done
+
+tr -d '\r' < "$LOG" | awk -v folded=$FOLDED '
+function hex(s,    n, i, c) {
+    n = 0
+    s = tolower(s)
+    for (i = 1; i <= length(s); i++) {
+        c = index("0123456789abcdef", substr(s, i, 1))
+        if (c == 0)
+            break
+        n = n * 16 + c - 1
+    }
+    return n
+}
+# function at addr in image img, the address in hex if there is none
+function lookup(img, addr,    lo, hi, mid) {
+    lo = 1
+    hi = nsyms[img]
+    if (hi == 0 || addr < saddr[img, 1])
+        return sprintf("0x%08x", addr)
+    while (lo < hi) {
+        mid = int((lo + hi + 1) / 2)
+        if (saddr[img, mid] <= addr)
+            lo = mid
+        else
+            hi = mid - 1
+    }
+    return sname[img, lo]
+}
+# name of a frame; kernel ones get _[k] as flamegraph.pl colours them
+function frame(cpl, prog, addr) {
+    if (cpl == 0)
+        return lookup("kernel", addr) (folded ? "_[k]" : "")
+    return lookup(prog, addr)
+}
+FILENAME == syms {
+    n = ++nsyms[$1]
+    saddr[$1, n] = hex($2)
+    sname[$1, n] = $3
+    next
+}
+$1 == "PROF_PROG" {
+    progs[hex($2)] = $3
+    next
+}
+$1 == "PROF_LOST" {
+    lost += hex($2)
+    next
+}
+$1 == "PROF" {
+    total++
+    cpl = hex($3)
+    prog = (hex($4) in progs) ? progs[hex($4)] : "idle"
+    image = cpl == 0 ? "kernel" : prog
+    leaf = frame(cpl, prog, hex($5))
+    self[image " " leaf]++
+    delete seen
+    seen[image " " leaf] = 1
+    stack = leaf
+    for (i = 6; i <= NF; i++) {
+        f = frame(cpl, prog, hex($i) - 1)       # the call, not the return
+        stack = f ";" stack
+        if (!((image " " f) in seen)) {
+            seen[image " " f] = 1
+            incl[image " " f]++
+        }
+    }
+    incl[image " " leaf]++
+    stacks[prog ";" stack]++
+    next
+}
+END {
+    if (total == 0) {
+        print "no PROF lines" > "/dev/stderr"
+        exit 1
+    }
+    if (folded) {
+        for (s in stacks)
+            print s, stacks[s]
+        exit 0
+    }
+    printf "%d samples", total
+    if (lost)
+        printf ", %d lost", lost
+    printf "\n  self%%    self   total  image        function\n"
+    for (k in incl) {
+        split(k, part, " ")
+        printf "%6.1f %7d %7d  %-12s %s\n", 100 * self[k] / total, self[k], incl[k], part[1], part[2] | "sort -k2,2nr -k3,3nr"
+    }
+}
+' syms="$SYMS" "$SYMS" -
@@ -0,0 +1,130 @@
+/* stubs.c - what the kernel code built here expects from the rest of the
+ * kernel: one process to hold open files, a small frame pool, and the
+ * CMOS ports the RTC driver programs
+ */
+
+#include "types.h"
+#include "lib.h"
+#include "pcb.h"
+#include "paging.h"
+#include "filesys.h"
+#include "rtc.h"
+#include "hostlib.h"
+
+#define HOST_FRAMES 128
+
+static pcb_t host_pcb;
+static uint8_t frames[HOST_FRAMES][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+static uint32_t frames_used;
+
+static uint8_t cmos[CMOS_REGS];
+static uint32_t cmos_index;
+
+/* host_process_init
+ * DESCRIPTION: gives the only process a file array with stdin and stdout
+ *              open, so fds from file_open start at 2 as in the kernel.
+ *              Call it after filesys_init
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void host_process_init(void) {
+    host_pcb.pid = 0;
+    host_pcb.owner = 0;
+    host_pcb.parent_num = PID_NONE;
+    host_pcb.files = host_pcb.file_array;
+    init_file_array(host_pcb.files);
+}
+
+/* getCurrentProcessPCB, getProcessPCB
+ * DESCRIPTION: every task is the one set up by host_process_init
+ */
+pcb_t* getCurrentProcessPCB() {
+    return &host_pcb;
+}
+
+pcb_t* getProcessPCB(uint32_t pid) {
+    return &host_pcb;
+}
+
+/* frame_alloc, frame_free
+ * DESCRIPTION: hand out 4KB frames from a static pool, never given back.
+ *              The pool sits below 4GB, so the addresses fit in a uint32_t
+ * INPUTS: phys -- frame to free
+ * RETURN VALUE: address of a frame, 0 when the pool is used up
+ */
+uint32_t frame_alloc(void) {
+    if (frames_used == HOST_FRAMES)
+        return 0;
+    return (uint32_t)frames[frames_used++];
+}
+
+void frame_free(uint32_t phys) {
+}
+
+/* host_inb, host_outb
+ * DESCRIPTION: port I/O for lib.h under HOST_BUILD. Ports 0x70/0x71 are a
+ *              CMOS whose index port ignores the NMI bit; others read 0
+ * INPUTS: data -- byte to write, port
+ * OUTPUTS: none
+ * RETURN VALUE: byte read
+ */
+uint32_t host_inb(uint32_t port) {
+    if (port == REG_RTC_VAL)
+        return cmos[cmos_index];
+    return 0;
+}
+
+void host_outb(uint32_t data, uint32_t port) {
+    if (port == REG_RTC_SEL)
+        cmos_index = data & (CMOS_REGS - 1);
+    else if (port == REG_RTC_VAL)
+        cmos[cmos_index] = data;
+}
+
+/* host_cmos
+ * DESCRIPTION: reads a CMOS register as the RTC driver left it
+ * INPUTS: reg -- register number without the NMI bit
+ * OUTPUTS: none
+ * RETURN VALUE: its value
+ */
+uint32_t host_cmos(uint32_t reg) {
+    return cmos[reg & (CMOS_REGS - 1)];
+}
+
+/* Devices with no host counterpart: nothing to read or write */
+int32_t terminal_open(void) { return 0; }
+int32_t terminal_close(void) { return 0; }
+int32_t terminal_read(int32_t fd, char* buffer, uint32_t num_chars) { return 0; }
+int32_t terminal_write(int32_t fd, char* buffer, uint32_t num_chars) { return num_chars; }
+int32_t pipe_open(const uint8_t* filename) { return -1; }
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t pipe_close(int32_t fd) { return -1; }
+void pipe_ref(uint32_t pipe, uint32_t end) { }
+int32_t trace_open(const uint8_t* filename) { return -1; }
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t trace_close(int32_t fd) { return -1; }
+int32_t sysstat_open(const uint8_t* filename) { return -1; }
+int32_t sysstat_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t sysstat_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t sysstat_close(int32_t fd) { return -1; }
+int32_t proc_lookup(const uint8_t* filename) { return -1; }
+int32_t proc_open(const uint8_t* filename) { return -1; }
+int32_t proc_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t proc_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t proc_close(int32_t fd) { return -1; }
+int32_t proc_getdents(int32_t fd, uint8_t* buf, int32_t nbytes) { return -1; }
+int32_t klog_quiet = 0;
+void klog_append(const int8_t* s, uint32_t n) { }
+int32_t klog_open(const uint8_t* filename) { return -1; }
+int32_t klog_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t klog_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t klog_close(int32_t fd) { return -1; }
+int32_t profile_open(const uint8_t* filename) { return -1; }
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes) { return -1; }
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes) { return -1; }
+int32_t profile_close(int32_t fd) { return -1; }
+void enable_irq(uint32_t irq_num) { }
+void send_eoi(uint32_t irq_num) { }
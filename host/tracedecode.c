@@ -0,0 +1,234 @@
+/* tracedecode.c - turns the kernel trace into a timeline and latency stats
+ *
+ *   tracedecode [-q] [log]
+ *
+ * Reads the TRACE lines that tracedump (or stop() after a fatal exception)
+ * sent to COM1, from a serial log that may hold other output too, or from
+ * stdin. Prints every event with its time since the first one, then the
+ * number of calls, errors and min/avg/max cycles of each system call from
+ * entry to exit, the same for each IRQ handler, and the exception counts.
+ * -q leaves out the timeline. A system call's time includes the interrupts
+ * and other tasks that ran before it returned.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* events, as in student-distrib/trace.h */
+#define TRACE_SYSCALL_ENTER     1
+#define TRACE_SYSCALL_EXIT      2
+#define TRACE_IRQ_ENTER         3
+#define TRACE_IRQ_EXIT          4
+#define TRACE_EXCEPTION         5
+#define TRACE_PAGE_FAULT        6
+#define TRACE_SWITCH            7
+
+#define NUM_SYSCALLS    29          /* numbers 1 to 28 */
+#define NUM_IRQS        16
+#define NUM_VECTORS     256
+#define NUM_PIDS        65536       /* pid is 16 bits in a record */
+#define MAX_NESTING     16          /* IRQ handlers inside each other */
+#define PID_IDLE        0xFFFF
+
+static const char* syscall_names[NUM_SYSCALLS] = {
+    "?", "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "spawn", "waitpid",
+    "thread_create", "futex_wait", "futex_wake", "pipe", "shm_map",
+    "shm_unmap", "mmap", "munmap", "brk", "sbrk", "getdents", "stat",
+    "fstat", "create", "ftruncate", "lseek"
+};
+
+static const char* event_names[] = {
+    "?", "syscall", "return", "irq", "irq done", "exception", "page fault", "switch"
+};
+
+static const char* irq_names[NUM_IRQS] = {
+    "pit", "keyboard", "irq2", "irq3", "serial", "irq5", "irq6", "irq7",
+    "rtc", "irq9", "irq10", "irq11", "irq12", "irq13", "irq14", "irq15"
+};
+
+typedef struct latency {
+    unsigned long count;
+    unsigned long errors;
+    unsigned long long total, min, max;
+} latency_t;
+
+/* a system call a task has entered and not yet left */
+typedef struct open_call {
+    int open;
+    unsigned int num;
+    unsigned long long tsc;
+} open_call_t;
+
+static latency_t syscall_stats[NUM_SYSCALLS];
+static latency_t irq_stats[NUM_IRQS];
+static unsigned long exceptions[NUM_VECTORS];
+static unsigned long page_faults, switches, unmatched, lost, events;
+static open_call_t calls[NUM_PIDS];
+static struct { unsigned int irq; unsigned long long tsc; } irqs[MAX_NESTING];
+static int irq_depth;
+
+static void add_sample(latency_t* s, unsigned long long cycles) {
+    if (s->count == 0 || cycles < s->min)
+        s->min = cycles;
+    if (cycles > s->max)
+        s->max = cycles;
+    s->total += cycles;
+    s->count++;
+}
+
+static const char* syscall_name(unsigned int num) {
+    return num < NUM_SYSCALLS ? syscall_names[num] : "?";
+}
+
+/* decode
+ * DESCRIPTION: accounts for one record and prints its timeline line
+ * INPUTS: tsc, event, pid, arg -- fields of the record, first -- tsc of
+ *         the first record, prev -- tsc of the one before, timeline
+ * RETURN VALUE: none
+ */
+static void decode(unsigned long long tsc, unsigned int event, unsigned int pid, unsigned int arg,
+                   unsigned long long first, unsigned long long prev, int timeline) {
+    char what[64];
+    unsigned int irq = arg & (NUM_IRQS - 1);
+
+    pid &= NUM_PIDS - 1;
+    events++;
+    what[0] = '\0';
+    switch (event) {
+    case TRACE_SYSCALL_ENTER:
+        /* halt and a successful execute never come back to this task */
+        if (calls[pid].open)
+            unmatched++;
+        calls[pid].open = 1;
+        calls[pid].num = arg;
+        calls[pid].tsc = tsc;
+        snprintf(what, sizeof(what), "%s", syscall_name(arg));
+        break;
+    case TRACE_SYSCALL_EXIT:
+        if (calls[pid].open) {
+            calls[pid].open = 0;
+            if (calls[pid].num < NUM_SYSCALLS) {
+                add_sample(&syscall_stats[calls[pid].num], tsc - calls[pid].tsc);
+                if ((int)arg == -1)
+                    syscall_stats[calls[pid].num].errors++;
+            }
+            snprintf(what, sizeof(what), "%s = %d (%llu cycles)", syscall_name(calls[pid].num),
+                     (int)arg, tsc - calls[pid].tsc);
+        } else {
+            snprintf(what, sizeof(what), "? = %d", (int)arg);
+        }
+        break;
+    case TRACE_IRQ_ENTER:
+        if (irq_depth < MAX_NESTING) {
+            irqs[irq_depth].irq = irq;
+            irqs[irq_depth].tsc = tsc;
+        }
+        irq_depth++;
+        snprintf(what, sizeof(what), "%s", irq_names[irq]);
+        break;
+    case TRACE_IRQ_EXIT:
+        if (irq_depth > 0 && --irq_depth < MAX_NESTING && irqs[irq_depth].irq == irq) {
+            add_sample(&irq_stats[irq], tsc - irqs[irq_depth].tsc);
+            snprintf(what, sizeof(what), "%s (%llu cycles)", irq_names[irq], tsc - irqs[irq_depth].tsc);
+        } else {
+            irq_depth = 0;
+            snprintf(what, sizeof(what), "%s", irq_names[irq]);
+        }
+        break;
+    case TRACE_EXCEPTION:
+        exceptions[arg & (NUM_VECTORS - 1)]++;
+        snprintf(what, sizeof(what), "vector %u", arg);
+        break;
+    case TRACE_PAGE_FAULT:
+        page_faults++;
+        snprintf(what, sizeof(what), "at 0x%08x", arg);
+        break;
+    case TRACE_SWITCH:
+        switches++;
+        if ((arg & 0xFFFF) == PID_IDLE)
+            snprintf(what, sizeof(what), "to idle");
+        else
+            snprintf(what, sizeof(what), "to pid %u", arg);
+        break;
+    }
+
+    if (!timeline)
+        return;
+    printf("%14llu %+10lld  ", tsc - first, (long long)(tsc - prev));
+    if (pid == PID_IDLE)
+        printf("idle  ");
+    else
+        printf("%4u  ", pid);
+    printf("%-10s %s\n", event <= TRACE_SWITCH ? event_names[event] : "?", what);
+}
+
+static void print_stat(const char* name, const latency_t* s, int errors) {
+    if (s->count == 0)
+        return;
+    printf("%-14s %8lu", name, s->count);
+    if (errors)
+        printf(" %8lu", s->errors);
+    printf(" %10llu %10llu %10llu\n", s->min, s->total / s->count, s->max);
+}
+
+int main(int argc, char** argv) {
+    FILE* in = stdin;
+    char line[256];
+    unsigned long long tsc, first = 0, prev = 0;
+    unsigned int event, pid, arg, count, i;
+    int timeline = 1;
+
+    for (i = 1; i < (unsigned int)argc; i++) {
+        if (strcmp(argv[i], "-q") == 0)
+            timeline = 0;
+        else if (argv[i][0] != '-' && in == stdin) {
+            if ((in = fopen(argv[i], "r")) == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-q] [log]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (timeline)
+        printf("%14s %10s  %4s  %s\n", "cycles", "delta", "pid", "event");
+    while (fgets(line, sizeof(line), in) != NULL) {
+        /* other output can share a line with the start of a record */
+        char* p = strstr(line, "TRACE");
+
+        if (p == NULL)
+            continue;
+        if (sscanf(p, "TRACE_LOST %x", &count) == 1) {
+            lost += count;
+            continue;
+        }
+        if (sscanf(p, "TRACE %16llx %x %x %x", &tsc, &event, &pid, &arg) != 4)
+            continue;
+        if (events == 0)
+            first = prev = tsc;
+        decode(tsc, event, pid, arg, first, prev, timeline);
+        prev = tsc;
+    }
+
+    printf("\n%lu events over %llu cycles", events, prev - first);
+    if (lost)
+        printf(", %lu lost to overwriting", lost);
+    printf("\n\n%-14s %8s %8s %10s %10s %10s\n", "syscall", "calls", "errors", "min", "avg", "max");
+    for (i = 1; i < NUM_SYSCALLS; i++)
+        print_stat(syscall_names[i], &syscall_stats[i], 1);
+    if (unmatched)
+        printf("(%lu calls did not return, e.g. halt)\n", unmatched);
+    printf("\n%-14s %8s %10s %10s %10s\n", "irq", "count", "min", "avg", "max");
+    for (i = 0; i < NUM_IRQS; i++)
+        print_stat(irq_names[i], &irq_stats[i], 0);
+    printf("\n");
+    for (i = 0; i < NUM_VECTORS; i++)
+        if (exceptions[i])
+            printf("exception %3u: %lu\n", i, exceptions[i]);
+    printf("page faults: %lu, context switches: %lu\n", page_faults, switches);
+    return 0;
+}
@@ -0,0 +1,525 @@
+/* mkfs391.c - Builds a file system image for the OS from a flat directory
+ *
+ * The image follows the format in ../student-distrib/fsformat.h: a boot
+ * block with the directory, one block per inode, then the data blocks.
+ * Unlike the original createfs it marks the image with FS_MAGIC, uses
+ * indirect blocks, so files are not limited to 1021 blocks (~4MB), and
+ * stores every file in consecutive data blocks, which the kernel detects
+ * at mount and reads with one copy. The directory goes in data blocks with
+ * a hash index (FS_FEAT_DIRHASH), so there can be thousands of files.
+ *
+ * usage: mkfs391 [-o image] [-b spare_blocks] [-i spare_inodes] [-z] srcdir
+ *
+ * The spare blocks and inodes are left free for files the kernel creates
+ * or grows at run time. -z packs the data blocks with LZ4
+ * (FS_FEAT_COMPRESSED), which makes the image read-only.
+ */
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../student-distrib/fsformat.h"
+
+#define FILE_TYPE_RTC   0
+#define FILE_TYPE_DIR   1
+#define FILE_TYPE_FILE  2
+
+/* one entry of the image directory */
+typedef struct entry {
+    char name[FS_NAME_LEN + 1];
+    int32_t type;
+    uint32_t inode;
+    char* path;             /* host file, NULL for "." and "rtc" */
+    uint32_t length;
+} entry_t;
+
+/* the image being built, grown one block at a time */
+static uint8_t* image;
+static uint32_t image_blocks;
+static uint32_t inode_count;
+static uint32_t data_count;
+
+static entry_t* entries;
+static uint32_t entry_count;
+static uint32_t entry_space;
+
+/* die
+ * DESCRIPTION: prints an error and exits
+ * INPUTS: msg, arg -- printed as "mkfs391: msg arg"
+ * OUTPUTS: message on stderr
+ * RETURN VALUE: never returns
+ */
+static void die(const char* msg, const char* arg)
+{
+    fprintf(stderr, "mkfs391: %s%s%s\n", msg, arg ? " " : "", arg ? arg : "");
+    exit(1);
+}
+
+/* put32
+ * DESCRIPTION: stores a little-endian word in the image
+ * INPUTS: off -- byte offset, val -- value
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void put32(uint32_t off, uint32_t val)
+{
+    image[off] = val & 0xFF;
+    image[off + 1] = (val >> 8) & 0xFF;
+    image[off + 2] = (val >> 16) & 0xFF;
+    image[off + 3] = (val >> 24) & 0xFF;
+}
+
+/* data_block_off
+ * DESCRIPTION: byte offset of a data block in the image
+ * INPUTS: n -- data block number
+ * OUTPUTS: none
+ * RETURN VALUE: offset
+ */
+static uint32_t data_block_off(uint32_t n)
+{
+    return (1 + inode_count + n) * FS_BLOCK_SIZE;
+}
+
+/* new_data_block
+ * DESCRIPTION: appends a zeroed data block to the image
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: its data block number
+ */
+static uint32_t new_data_block(void)
+{
+    image = realloc(image, (size_t)(image_blocks + 1) * FS_BLOCK_SIZE);
+    if (image == NULL)
+        die("out of memory", NULL);
+    memset(image + (size_t)image_blocks * FS_BLOCK_SIZE, 0, FS_BLOCK_SIZE);
+    image_blocks++;
+    return data_count++;
+}
+
+/* set_file_block
+ * DESCRIPTION: records that block index of a file is data block n, making
+ *              the indirect blocks on the way when first needed
+ * INPUTS: inode_off -- offset of the inode, index -- block of the file,
+ *         n -- data block number
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void set_file_block(uint32_t inode_off, uint32_t index, uint32_t n)
+{
+    uint32_t slot, table;
+
+    if (index < FS_DIRECT_PTRS) {
+        put32(inode_off + 4 + 4 * index, n);
+        return;
+    }
+
+    index -= FS_DIRECT_PTRS;
+    if (index < FS_PTRS_PER_BLOCK) {
+        slot = inode_off + 4 + 4 * FS_SINGLE_INDIRECT;
+        if (index == 0)
+            put32(slot, new_data_block());
+        table = data_block_off(*(uint32_t*)(image + slot));
+        put32(table + 4 * index, n);
+        return;
+    }
+
+    index -= FS_PTRS_PER_BLOCK;
+    if (index >= FS_PTRS_PER_BLOCK * FS_PTRS_PER_BLOCK)
+        die("file too large", NULL);
+    slot = inode_off + 4 + 4 * FS_DOUBLE_INDIRECT;
+    if (index == 0)
+        put32(slot, new_data_block());
+    table = data_block_off(*(uint32_t*)(image + slot));
+    slot = table + 4 * (index / FS_PTRS_PER_BLOCK);
+    if (index % FS_PTRS_PER_BLOCK == 0)
+        put32(slot, new_data_block());
+    table = data_block_off(*(uint32_t*)(image + slot));
+    put32(table + 4 * (index % FS_PTRS_PER_BLOCK), n);
+}
+
+/* add_file
+ * DESCRIPTION: copies a host file into the image. All of its data blocks
+ *              are allocated first so the file is one extent; the indirect
+ *              blocks follow it
+ * INPUTS: e -- directory entry of the file
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void add_file(entry_t* e)
+{
+    uint32_t inode_off = (1 + e->inode) * FS_BLOCK_SIZE;
+    uint32_t index, first, blocks;
+    FILE* f;
+
+    if ((f = fopen(e->path, "rb")) == NULL)
+        die("cannot open", e->path);
+
+    blocks = ((uint64_t)e->length + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    first = data_count;
+    for (index = 0; index < blocks; index++)
+        new_data_block();
+    if (blocks && fread(image + data_block_off(first), 1, e->length, f) != e->length)
+        die("cannot read", e->path);
+    fclose(f);
+
+    put32(inode_off, e->length);
+    for (index = 0; index < blocks; index++)
+        set_file_block(inode_off, index, first + index);
+}
+
+/* add_entry
+ * DESCRIPTION: adds a name to the image directory
+ * INPUTS: name, type, path -- host file for FILE_TYPE_FILE
+ * OUTPUTS: none
+ * RETURN VALUE: the new entry
+ */
+static entry_t* add_entry(const char* name, int32_t type, char* path)
+{
+    entry_t* e;
+
+    if (entry_count == FS_MAX_DENTRIES)
+        die("too many files", NULL);
+    if (entry_count == entry_space) {
+        entry_space = entry_space ? 2 * entry_space : 64;
+        entries = realloc(entries, entry_space * sizeof(entry_t));
+        if (entries == NULL)
+            die("out of memory", NULL);
+    }
+    if (strlen(name) > FS_NAME_LEN)
+        fprintf(stderr, "mkfs391: warning: %s cut to %d characters\n", name, FS_NAME_LEN);
+
+    e = &entries[entry_count++];
+    memset(e, 0, sizeof(*e));
+    strncpy(e->name, name, FS_NAME_LEN);
+    e->type = type;
+    e->path = path;
+    return e;
+}
+
+/* put_dentry
+ * DESCRIPTION: writes a 64-byte dentry into the image
+ * INPUTS: off -- byte offset, e -- entry
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void put_dentry(uint32_t off, const entry_t* e)
+{
+    memcpy(image + off, e->name, strlen(e->name));
+    put32(off + FS_NAME_LEN, e->type);
+    put32(off + FS_NAME_LEN + 4, e->inode);
+}
+
+/* name_hash
+ * DESCRIPTION: FNV-1a of a name, the same as the kernel's dir_name_hash
+ * INPUTS: name -- at most FS_NAME_LEN characters
+ * OUTPUTS: none
+ * RETURN VALUE: 32-bit hash
+ */
+static uint32_t name_hash(const char* name)
+{
+    uint32_t hash = FS_FNV_BASIS;
+
+    while (*name != '\0')
+        hash = (hash ^ (uint8_t)*name++) * FS_FNV_PRIME;
+    return hash;
+}
+
+/* add_directory
+ * DESCRIPTION: writes the FS_FEAT_DIRHASH directory: the dentries in order
+ *              in consecutive blocks, then the hash table over them
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void add_directory(void)
+{
+    uint32_t dir_first, hash_first, hash_size, blocks, i, slot, table;
+
+    /* at least half empty, so probe chains stay short. The dentry blocks
+       have room for hash_size / 2 entries, the rest is for new files */
+    for (hash_size = FS_HASH_PER_BLOCK; hash_size < 2 * entry_count; hash_size *= 2)
+        ;
+    blocks = hash_size / 2 / FS_DENTRIES_PER_BLOCK;
+    dir_first = data_count;
+    for (i = 0; i < blocks; i++)
+        new_data_block();
+
+    hash_first = data_count;
+    for (i = 0; i < hash_size / FS_HASH_PER_BLOCK; i++)
+        new_data_block();
+
+    table = data_block_off(hash_first);
+    for (i = 0; i < entry_count; i++) {
+        put_dentry(data_block_off(dir_first) + FS_DENTRY_SIZE * i, &entries[i]);
+        slot = name_hash(entries[i].name) & (hash_size - 1);
+        while (*(uint32_t*)(image + table + 4 * slot) != 0)
+            slot = (slot + 1) & (hash_size - 1);
+        put32(table + 4 * slot, i + 1);
+    }
+
+    put32(FS_DIR_BLOCK_OFFSET, dir_first);
+    put32(FS_HASH_BLOCK_OFFSET, hash_first);
+    put32(FS_HASH_SIZE_OFFSET, hash_size);
+}
+
+#define LZ4_HASH_BITS   12
+#define LZ4_MIN_MATCH   4
+#define LZ4_LAST_LITERALS 5         /* a block ends with at least 5 literals */
+#define LZ4_MATCH_LIMIT 12          /* no match starts in the last 12 bytes */
+
+/* lz4_length
+ * DESCRIPTION: writes the 255-continued extra bytes of a length whose
+ *              nibble in the token was 15
+ * INPUTS: op -- output, len -- the part above 15
+ * OUTPUTS: bytes at op
+ * RETURN VALUE: output after them
+ */
+static uint8_t* lz4_length(uint8_t* op, uint32_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+/* lz4_sequence
+ * DESCRIPTION: writes one LZ4 sequence: literals then a match, or only
+ *              literals when mlen is 0 (the last sequence)
+ * INPUTS: op -- output, lit/nlit -- literals, offset, mlen -- match
+ * OUTPUTS: bytes at op
+ * RETURN VALUE: output after them
+ */
+static uint8_t* lz4_sequence(uint8_t* op, const uint8_t* lit, uint32_t nlit, uint32_t offset, uint32_t mlen)
+{
+    uint8_t* token = op++;
+
+    *token = (nlit < 15 ? nlit : 15) << 4;
+    if (nlit >= 15)
+        op = lz4_length(op, nlit - 15);
+    memcpy(op, lit, nlit);
+    op += nlit;
+    if (mlen == 0)
+        return op;
+
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    mlen -= LZ4_MIN_MATCH;
+    *token |= (mlen < 15 ? mlen : 15);
+    if (mlen >= 15)
+        op = lz4_length(op, mlen - 15);
+    return op;
+}
+
+/* lz4_compress
+ * DESCRIPTION: greedy LZ4 block compressor, the kernel's lz4_decompress
+ *              reads its output
+ * INPUTS: src, n -- input, dst -- room for n + n / 255 + 16 bytes
+ * OUTPUTS: compressed bytes in dst
+ * RETURN VALUE: compressed size
+ */
+static uint32_t lz4_compress(const uint8_t* src, uint32_t n, uint8_t* dst)
+{
+    int32_t table[1 << LZ4_HASH_BITS];
+    uint32_t ip = 0, anchor = 0, ref, h, seq, mlen;
+    uint8_t* op = dst;
+
+    memset(table, -1, sizeof(table));
+    while (n >= LZ4_MATCH_LIMIT && ip <= n - LZ4_MATCH_LIMIT) {
+        memcpy(&seq, src + ip, 4);
+        h = (seq * 2654435761u) >> (32 - LZ4_HASH_BITS);
+        ref = table[h];
+        table[h] = ip;
+        if (ref == (uint32_t)-1 || ip - ref > 0xFFFF || memcmp(src + ref, src + ip, 4) != 0) {
+            ip++;
+            continue;
+        }
+        mlen = LZ4_MIN_MATCH;
+        while (ip + mlen < n - LZ4_LAST_LITERALS && src[ref + mlen] == src[ip + mlen])
+            mlen++;
+        op = lz4_sequence(op, src + anchor, ip - anchor, ip - ref, mlen);
+        ip += mlen;
+        anchor = ip;
+    }
+    op = lz4_sequence(op, src + anchor, n - anchor, 0, 0);
+    return op - dst;
+}
+
+/* pack_image
+ * DESCRIPTION: turns the built image into a FS_FEAT_COMPRESSED one: data
+ *              blocks go through lz4_compress, and are kept raw if that
+ *              does not save anything or they belong to the directory
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: size of the packed image in bytes
+ * SIDE EFFECTS: replaces image
+ */
+static uint32_t pack_image(void)
+{
+    uint32_t meta = (1 + inode_count) * FS_BLOCK_SIZE;
+    uint32_t table_bytes, off, n, len, dir_first, dir_end, hash_first, hash_end, hash_size;
+    uint8_t packed[FS_BLOCK_SIZE + FS_BLOCK_SIZE / 255 + 16];
+    const uint8_t* block;
+    uint8_t* out;
+
+    hash_size = *(uint32_t*)(image + FS_HASH_SIZE_OFFSET);
+    dir_first = *(uint32_t*)(image + FS_DIR_BLOCK_OFFSET);
+    dir_end = dir_first + hash_size / 2 / FS_DENTRIES_PER_BLOCK;
+    hash_first = *(uint32_t*)(image + FS_HASH_BLOCK_OFFSET);
+    hash_end = hash_first + hash_size / FS_HASH_PER_BLOCK;
+
+    table_bytes = ((data_count + 1) * 4 + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE * FS_BLOCK_SIZE;
+    out = calloc(1, meta + table_bytes + (size_t)data_count * FS_BLOCK_SIZE);
+    if (out == NULL)
+        die("out of memory", NULL);
+    put32(FS_FEATURES_OFFSET, *(uint32_t*)(image + FS_FEATURES_OFFSET) | FS_FEAT_COMPRESSED);
+    memcpy(out, image, meta);
+
+    off = 0;
+    for (n = 0; n < data_count; n++) {
+        *(uint32_t*)(out + meta + 4 * n) = off;
+        block = image + data_block_off(n);
+        len = FS_BLOCK_SIZE;
+        if ((n < dir_first || n >= dir_end) && (n < hash_first || n >= hash_end))
+            len = lz4_compress(block, FS_BLOCK_SIZE, packed);
+        if (len >= FS_BLOCK_SIZE) {
+            len = FS_BLOCK_SIZE;
+            memcpy(out + meta + table_bytes + off, block, len);
+        } else {
+            memcpy(out + meta + table_bytes + off, packed, len);
+        }
+        off += len;
+    }
+    *(uint32_t*)(out + meta + 4 * data_count) = off;
+
+    free(image);
+    image = out;
+    return meta + table_bytes + off;
+}
+
+/* by_name
+ * DESCRIPTION: qsort order of the directory
+ */
+static int by_name(const void* a, const void* b)
+{
+    return strcmp(((const entry_t*)a)->name, ((const entry_t*)b)->name);
+}
+
+/* scan_dir
+ * DESCRIPTION: adds every regular file of srcdir to the directory
+ * INPUTS: srcdir
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void scan_dir(const char* srcdir)
+{
+    struct dirent* d;
+    struct stat st;
+    entry_t* e;
+    char* path;
+    DIR* dir;
+
+    if ((dir = opendir(srcdir)) == NULL)
+        die("cannot open directory", srcdir);
+    while ((d = readdir(dir)) != NULL) {
+        if (d->d_name[0] == '.')
+            continue;
+        path = malloc(strlen(srcdir) + strlen(d->d_name) + 2);
+        sprintf(path, "%s/%s", srcdir, d->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            free(path);
+            continue;
+        }
+        if (st.st_size > 0x7FFFFFFF)
+            die("file too large", path);
+        e = add_entry(d->d_name, FILE_TYPE_FILE, path);
+        e->length = st.st_size;
+    }
+    closedir(dir);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out = "filesys_img";
+    const char* srcdir = NULL;
+    uint32_t spare_blocks = 0, spare_inodes = 0, compress = 0;
+    uint32_t i, inode, size, raw_size;
+    FILE* f;
+
+    for (i = 1; i < (uint32_t)argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < (uint32_t)argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "-b") == 0 && i + 1 < (uint32_t)argc)
+            spare_blocks = strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < (uint32_t)argc)
+            spare_inodes = strtoul(argv[++i], NULL, 0);
+        else if (strcmp(argv[i], "-z") == 0)
+            compress = 1;
+        else if (argv[i][0] != '-' && srcdir == NULL)
+            srcdir = argv[i];
+        else
+            srcdir = NULL, i = argc;
+    }
+    if (srcdir == NULL) {
+        fprintf(stderr, "usage: %s [-o image] [-b spare_blocks] [-i spare_inodes] [-z] srcdir\n", argv[0]);
+        return 2;
+    }
+
+    /* "." and "rtc" come first like in the original images */
+    add_entry(".", FILE_TYPE_DIR, NULL);
+    add_entry("rtc", FILE_TYPE_RTC, NULL);
+    scan_dir(srcdir);
+    qsort(entries + 2, entry_count - 2, sizeof(entry_t), by_name);
+    for (i = 3; i < entry_count; i++) {
+        if (strcmp(entries[i - 1].name, entries[i].name) == 0)
+            die("two files share the name", entries[i].name);
+    }
+
+    /* inode 0 is shared by "." and "rtc", files get 1, 2, ... */
+    inode = 1;
+    for (i = 2; i < entry_count; i++)
+        entries[i].inode = inode++;
+    inode_count = inode + spare_inodes;
+
+    image_blocks = 1 + inode_count;
+    image = calloc(image_blocks, FS_BLOCK_SIZE);
+    if (image == NULL)
+        die("out of memory", NULL);
+    for (i = 0; i < entry_count; i++) {
+        if (entries[i].type == FILE_TYPE_FILE)
+            add_file(&entries[i]);
+    }
+    add_directory();
+    for (i = 0; i < spare_blocks; i++)
+        new_data_block();
+
+    /* boot block */
+    put32(0, entry_count);
+    put32(4, inode_count);
+    put32(8, data_count);
+    put32(FS_MAGIC_OFFSET, FS_MAGIC);
+    put32(FS_FEATURES_OFFSET, FS_FEAT_INDIRECT | FS_FEAT_DIRHASH);
+    for (i = 0; i < entry_count && i < FS_BOOT_DENTRIES; i++)
+        put_dentry(FS_DENTRY_SIZE * (i + 1), &entries[i]);
+
+    size = raw_size = image_blocks * FS_BLOCK_SIZE;
+    if (compress)
+        size = pack_image();
+
+    if ((f = fopen(out, "wb")) == NULL)
+        die("cannot create", out);
+    if (fwrite(image, 1, size, f) != size)
+        die("cannot write", out);
+    fclose(f);
+
+    printf("%s: %u entries, %u inodes, %u data blocks, %u bytes", out, entry_count, inode_count, data_count, size);
+    if (compress)
+        printf(" (%u raw, %u%%)", raw_size, (uint32_t)((uint64_t)size * 100 / raw_size));
+    printf("\n");
+    return 0;
+}
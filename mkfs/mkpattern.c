@@ -0,0 +1,38 @@
+/* mkpattern.c - Writes a test file whose contents give away their offset
+ *
+ * Every 32-bit little endian word of the file holds its own offset / 4, so
+ * a reader can tell which part of the file a block came from without a
+ * copy of the file. "make image-test" puts two of these in the image, long
+ * enough to need the single and the double indirect block.
+ *
+ * usage: mkpattern file bytes
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(int argc, char** argv)
+{
+    uint32_t bytes, offset, word;
+    FILE* f;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s file bytes\n", argv[0]);
+        return 2;
+    }
+    bytes = strtoul(argv[2], NULL, 0);
+    if ((f = fopen(argv[1], "wb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    for (offset = 0; offset < bytes; offset++) {
+        word = offset / 4;
+        if (fputc((word >> (8 * (offset % 4))) & 0xFF, f) == EOF)
+            break;
+    }
+    if (fclose(f) != 0 || offset != bytes) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#!/bin/bash
+# perfcheck.sh - boots the kernel headless in QEMU in benchmark mode and
+# compares the results with a stored baseline.
+#
+#   perfcheck.sh [-u] [-t percent] [-b baseline] [-k kernel]
+#
+#   -u          store this run as the baseline instead of comparing
+#   -t percent  default regression limit for results not in thresholds
+#   -b file     baseline (default perf/baseline.txt)
+#   -k file     kernel ELF (default student-distrib/bootimg)
+#
+# Needs qemu-system-i386, the kernel built with make, mkfs/mkfs391 and
+# syscalls/to_fsdir/perfbench (make -C syscalls perfbench). The image is
+# fsdir/ plus perfbench, built by mkfs391 into a scratch directory. Results
+# are cycles, so a baseline only means something on the machine that made
+# it. Exits 1 on a regression, a missing result or a run that did not
+# finish.
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BASELINE=$ROOT/perf/baseline.txt
+THRESHOLDS=$ROOT/perf/thresholds
+KERNEL=$ROOT/student-distrib/bootimg
+PERFBENCH=$ROOT/syscalls/to_fsdir/perfbench
+MKFS=$ROOT/mkfs/mkfs391
+LIMIT=10
+UPDATE=0
+TIMEOUT=${PERF_TIMEOUT:-300}
+
+while getopts "ut:b:k:" opt; do
+    case $opt in
+        u) UPDATE=1 ;;
+        t) LIMIT=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        k) KERNEL=$OPTARG ;;
+        *) sed -n '4,10p' "$0"; exit 2 ;;
+    esac
+done
+
+for f in "$KERNEL" "$PERFBENCH" "$MKFS"; do
+    if [ ! -f "$f" ]; then
+        echo "perfcheck: $f is missing, build it first" >&2
+        exit 2
+    fi
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+mkdir "$WORK/fsdir"
+cp "$ROOT"/fsdir/* "$PERFBENCH" "$WORK/fsdir/"
+"$MKFS" -b 256 -i 16 -o "$WORK/filesys_img" "$WORK/fsdir" > /dev/null || exit 2
+
+# isa-debug-exit lets the kernel end the run once perfbench is done
+timeout "$TIMEOUT" qemu-system-i386 -display none -no-reboot -m 128 \
+    -serial file:"$WORK/serial.log" \
+    -kernel "$KERNEL" -initrd "$WORK/filesys_img" -append perf \
+    -device isa-debug-exit,iobase=0xf4,iosize=0x04
+
+tr -d '\r' < "$WORK/serial.log" > "$WORK/console.log"
+if ! grep -q '^PERF_DONE' "$WORK/console.log"; then
+    echo "perfcheck: the run did not finish, last output:" >&2
+    tail -20 "$WORK/console.log" >&2
+    exit 1
+fi
+grep '^PERF_ERROR' "$WORK/console.log" >&2
+grep '^PERF ' "$WORK/console.log" > "$WORK/results.txt"
+
+if [ $UPDATE -eq 1 ]; then
+    cp "$WORK/results.txt" "$BASELINE"
+    echo "perfcheck: baseline stored in $BASELINE"
+    cat "$BASELINE"
+    exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+    echo "perfcheck: no baseline, run with -u first" >&2
+    cat "$WORK/results.txt"
+    exit 2
+fi
+
+# values are costs, a result regressed when it grew by more than its limit
+awk -v def="$LIMIT" '
+    FILENAME == ARGV[1] {
+        if ($1 !~ /^#/ && NF >= 2) limit[$1] = $2
+        next
+    }
+    FILENAME == ARGV[2] {
+        order[++count] = $2; base[$2] = $3; unit[$2] = $4
+        next
+    }
+    { now[$2] = $3 }
+    END {
+        printf "%-22s %10s %10s %8s %6s\n", "benchmark", "baseline", "now", "change", "limit"
+        for (i = 1; i <= count; i++) {
+            n = order[i]
+            lim = (n in limit) ? limit[n] : def
+            if (!(n in now)) {
+                printf "%-22s %10d %10s %8s %5d%%  MISSING\n", n, base[n], "-", "-", lim
+                bad++
+                continue
+            }
+            pct = base[n] ? (now[n] - base[n]) * 100 / base[n] : 0
+            printf "%-22s %10d %10d %+7.1f%% %5d%%  %s %s\n", n, base[n], now[n], pct, lim,
+                unit[n], (pct > lim) ? "REGRESSED" : ""
+            if (pct > lim)
+                bad++
+        }
+        for (n in now)
+            if (!(n in base))
+                printf "%-22s %10s %10d   (not in the baseline)\n", n, "-", now[n]
+        exit bad ? 1 : 0
+    }' "$THRESHOLDS" "$BASELINE" "$WORK/results.txt"
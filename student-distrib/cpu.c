@@ -0,0 +1,126 @@
+#include "cpu.h"
+#include "lib.h"
+
+#define EFLAGS_ID           0x00200000  /* writable only if there is CPUID */
+
+#define CPUID_TSC           (1 << 4)    /* leaf 1 EDX */
+#define CPUID_SSE           (1 << 25)
+#define CPUID_SSE2          (1 << 26)
+#define CPUID_ERMS          (1 << 9)    /* leaf 7 EBX */
+#define CPUID_FSRM          (1 << 4)    /* leaf 7 EDX */
+
+cpu_info_t cpu_info;
+const int8_t* cpu_feature_names[CPU_FEATURES] = {
+    "cpuid", "tsc", "sse", "sse2", "erms", "fsrm"
+};
+
+/* cpuid_present
+ * DESCRIPTION: tells whether the CPU has the CPUID instruction, which it
+ *              does if the ID bit of EFLAGS can be flipped
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if it does, 0 if not
+ * SIDE EFFECTS: none, EFLAGS is put back
+ */
+static int32_t cpuid_present(void) {
+    uint32_t before, after;
+
+    asm volatile ("                     \n\
+            pushfl                      \n\
+            popl    %0                  \n\
+            movl    %0, %1              \n\
+            xorl    %2, %1              \n\
+            pushl   %1                  \n\
+            popfl                       \n\
+            pushfl                      \n\
+            popl    %1                  \n\
+            pushl   %0                  \n\
+            popfl                       \n\
+            "
+            : "=&r"(before), "=&r"(after)
+            : "i"(EFLAGS_ID)
+            : "cc"
+    );
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+/* cpuid
+ * DESCRIPTION: runs CPUID for a leaf, subleaf 0
+ * INPUTS: leaf
+ * OUTPUTS: the registers it returns in regs[0..3] as EAX, EBX, ECX, EDX
+ * RETURN VALUE: none
+ */
+static void cpuid(uint32_t leaf, uint32_t regs[4]) {
+    asm volatile ("cpuid"
+            : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+            : "a"(leaf), "c"(0)
+    );
+}
+
+/* cpu_init
+ * DESCRIPTION: reads the vendor, model and features, and points mem_ops
+ *              at the memory routines for them: rep movsb/stosb where
+ *              ERMS makes them the fast ones, rep movsl/stosl elsewhere.
+ *              Run "perf" to see where each one wins on a machine
+ * INPUTS: none
+ * OUTPUTS: a line with what it found
+ * RETURN VALUE: none
+ * SIDE EFFECTS: sets cpu_info and mem_ops
+ */
+void cpu_init(void) {
+    uint32_t regs[4], max_leaf, i;
+
+    memset(&cpu_info, 0, sizeof(cpu_info));
+    strcpy(cpu_info.vendor, "unknown");
+    if (cpuid_present()) {
+        cpu_info.features = CPU_CPUID;
+        cpuid(0, regs);
+        max_leaf = regs[0];
+        memcpy(cpu_info.vendor, &regs[1], 4);       /* EBX, EDX, ECX */
+        memcpy(cpu_info.vendor + 4, &regs[3], 4);
+        memcpy(cpu_info.vendor + 8, &regs[2], 4);
+        cpu_info.vendor[CPU_VENDOR_LEN] = '\0';
+
+        if (max_leaf >= 1) {
+            cpuid(1, regs);
+            cpu_info.stepping = regs[0] & 0xF;
+            cpu_info.model = (regs[0] >> 4) & 0xF;
+            cpu_info.family = (regs[0] >> 8) & 0xF;
+            if (cpu_info.family == 0xF)
+                cpu_info.family += (regs[0] >> 20) & 0xFF;
+            if (cpu_info.family == 0x6 || cpu_info.family >= 0xF)
+                cpu_info.model |= ((regs[0] >> 16) & 0xF) << 4;
+            if (regs[3] & CPUID_TSC)
+                cpu_info.features |= CPU_TSC;
+            if (regs[3] & CPUID_SSE)
+                cpu_info.features |= CPU_SSE;
+            if (regs[3] & CPUID_SSE2)
+                cpu_info.features |= CPU_SSE2;
+        }
+        if (max_leaf >= 7) {
+            cpuid(7, regs);
+            if (regs[1] & CPUID_ERMS)
+                cpu_info.features |= CPU_ERMS;
+            if (regs[3] & CPUID_FSRM)
+                cpu_info.features |= CPU_FSRM;
+        }
+    }
+
+    mem_ops = &mem_variants[cpu_has(CPU_ERMS) ? MEM_MOVSB : MEM_MOVSL];
+
+    printf("CPU %s family %u model %u:", cpu_info.vendor, cpu_info.family, cpu_info.model);
+    for (i = 0; i < CPU_FEATURES; i++)
+        if (cpu_info.features & (1 << i))
+            printf(" %s", cpu_feature_names[i]);
+    printf(", memcpy %s\n", mem_ops->name);
+}
+
+/* cpu_has
+ * DESCRIPTION: tells whether cpu_init found a feature
+ * INPUTS: feature -- a CPU_* bit
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the CPU has it, 0 if not
+ */
+int32_t cpu_has(uint32_t feature) {
+    return (cpu_info.features & feature) != 0;
+}
@@ -0,0 +1,43 @@
+#ifndef CPU_H_
+#define CPU_H_
+
+#include "types.h"
+
+/* What CPUID says about the processor, read once at boot by cpu_init,
+ * which also picks the lib.c memory routines for it (see mem_ops in
+ * lib.h). A CPU without CPUID (some 486s) has no features and keeps the
+ * rep movsl routines. SSE and SSE2 are only reported: the kernel does not
+ * enable them in CR4 nor save XMM registers on a switch, so no kernel
+ * code may use them. "proc/cpu" shows all of it */
+
+/* bits of cpu_info.features */
+#define CPU_CPUID           0x01
+#define CPU_TSC             0x02        /* leaf 1 EDX bit 4 */
+#define CPU_SSE             0x04        /* leaf 1 EDX bit 25 */
+#define CPU_SSE2            0x08        /* leaf 1 EDX bit 26 */
+#define CPU_ERMS            0x10        /* leaf 7 EBX bit 9, fast rep movsb/stosb */
+#define CPU_FSRM            0x20        /* leaf 7 EDX bit 4, fast short rep movsb */
+#define CPU_FEATURES        6           /* names in cpu_feature_names */
+
+#define CPU_VENDOR_LEN      12
+
+#ifndef ASM
+
+typedef struct cpu_info_t {
+    int8_t vendor[CPU_VENDOR_LEN + 1];  /* "unknown" without CPUID */
+    uint32_t family;
+    uint32_t model;
+    uint32_t stepping;
+    uint32_t features;
+} cpu_info_t;
+
+extern cpu_info_t cpu_info;
+/* names of the feature bits, lowest first */
+extern const int8_t* cpu_feature_names[CPU_FEATURES];
+
+extern void cpu_init(void);
+extern int32_t cpu_has(uint32_t feature);
+
+#endif /* ASM */
+
+#endif
@@ -1,8 +1,29 @@
 #include "filesys.h"
 #include "syscalls.h"
+#include "pipe.h"
+#include "fscache.h"
+#include "serial.h"
+#include "trace.h"
+#include "sysstat.h"
+#include "proc.h"
+#include "profile.h"
+#include "klog.h"
 
 
 static uint8_t * fs_ptr;
+static uint32_t fs_features;   /* FS_FEAT_* of the mounted image */
+static uint8_t* inode_extent[FS_EXTENT_INODES];  /* first block of a contiguous file, else NULL */
+static dentry_t* dir_entries;  /* boot block or FS_FEAT_DIRHASH dentry blocks */
+static uint32_t dir_limit;     /* entries readable through dir_entries */
+static uint32_t* dir_hash;     /* FS_FEAT_DIRHASH table, NULL for a boot block directory */
+static uint32_t dir_hash_mask;
+
+/* allocation state, rebuilt from the image by filesys_init */
+static uint8_t block_used[FS_BITMAP_BLOCKS / 8];
+static uint8_t inode_used[FS_BITMAP_INODES / 8];
+static uint32_t block_limit;   /* data blocks the allocator may hand out */
+static uint32_t free_blocks;
+static uint8_t inode_maps[FS_BITMAP_INODES];  /* mmap mappings of each file */
 static file_t blank;
 
 /* OPERATION TABLE */
@@ -10,7 +31,47 @@ static int32_t terminal_ops[4] = { (int32_t) &terminal_open, (int32_t) &terminal
 static int32_t file_ops[4] = { (int32_t) &file_open, (int32_t) &file_read, (int32_t) &file_write, (int32_t) &file_close}; // open, read, write, close
 static int32_t directory_ops[4] = { (int32_t) &directory_open, (int32_t) &directory_read, (int32_t) &directory_write, (int32_t) &directory_close}; // open, read, write, close
 static int32_t rtc_ops[4] = { (int32_t) &rtc_open, (int32_t) &rtc_read, (int32_t) &rtc_write, (int32_t) &rtc_close}; // open, read, write, close
+static int32_t pipe_ops[4] = { (int32_t) &pipe_open, (int32_t) &pipe_read, (int32_t) &pipe_write, (int32_t) &pipe_close}; // open, read, write, close
+static int32_t serial_ops[4] = { (int32_t) &serial_open, (int32_t) &serial_read, (int32_t) &serial_write, (int32_t) &serial_close}; // open, read, write, close
+static int32_t trace_ops[4] = { (int32_t) &trace_open, (int32_t) &trace_read, (int32_t) &trace_write, (int32_t) &trace_close}; // open, read, write, close
+static int32_t sysstat_ops[4] = { (int32_t) &sysstat_open, (int32_t) &sysstat_read, (int32_t) &sysstat_write, (int32_t) &sysstat_close}; // open, read, write, close
+static int32_t proc_ops[4] = { (int32_t) &proc_open, (int32_t) &proc_read, (int32_t) &proc_write, (int32_t) &proc_close}; // open, read, write, close
+static int32_t profile_ops[4] = { (int32_t) &profile_open, (int32_t) &profile_read, (int32_t) &profile_write, (int32_t) &profile_close}; // open, read, write, close
+static int32_t klog_ops[4] = { (int32_t) &klog_open, (int32_t) &klog_read, (int32_t) &klog_write, (int32_t) &klog_close}; // open, read, write, close
 
+/* lookup_file
+ * DESCRIPTION: read_dentry_by_name, plus the device files that have no
+ *              entry in the image (the serial port, the trace, the system
+ *              call histograms, the profiler, the kernel log and the proc
+ *              files). A device name wins over an image file of the same
+ *              name, such as the sysstat and profile programs
+ * INPUTS: filename, dentry
+ * OUTPUTS: the entry in dentry
+ * RETURN VALUE: 0 on success, -1 if there is no such file
+ * SIDE EFFECTS: none
+ */
+int32_t lookup_file(const uint8_t* filename, dentry_t* dentry)
+{
+  memset(dentry, 0, sizeof(dentry_t));
+  if (strncmp((int8_t*)filename, SERIAL_FILENAME, FILENAME_LEN) == 0)
+    dentry->filetype = FILE_TYPE_SERIAL;
+  else if (strncmp((int8_t*)filename, TRACE_FILENAME, FILENAME_LEN) == 0)
+    dentry->filetype = FILE_TYPE_TRACE;
+  else if (strncmp((int8_t*)filename, SYSSTAT_FILENAME, FILENAME_LEN) == 0)
+    dentry->filetype = FILE_TYPE_SYSSTAT;
+  else if (strncmp((int8_t*)filename, PROFILE_FILENAME, FILENAME_LEN) == 0)
+    dentry->filetype = FILE_TYPE_PROFILE;
+  else if (strncmp((int8_t*)filename, KLOG_FILENAME, FILENAME_LEN) == 0)
+    dentry->filetype = FILE_TYPE_KMSG;
+  else if (read_dentry_by_name(filename, dentry) == 0)
+    return 0;
+  else if ((dentry->inode_num = proc_lookup(filename)) != -1)
+    dentry->filetype = FILE_TYPE_PROC;
+  else
+    return -1;
+  strncpy(dentry->filename, (int8_t*)filename, FILENAME_LEN);
+  return 0;
+}
 
 /* file_open
  * DESCRIPTION: opens the file by filename
@@ -21,14 +82,14 @@ static int32_t rtc_ops[4] = { (int32_t) &rtc_open, (int32_t) &rtc_read, (int32_t
  */
 int32_t file_open(const uint8_t* filename)
 {
-  file_t * file_array = getCurrentProcessPCB()->file_array;
+  file_t * file_array = getCurrentProcessPCB()->files;
   dentry_t new_dirent;
   int32_t idx;
 
   // see if file exists, and check for the file name 
   if (filename == NULL) return -1;
   if (strlen((int8_t*)filename) >= FILENAME_LEN) return -1;
-  if (read_dentry_by_name(filename, &new_dirent) == -1) return -1;
+  if (lookup_file(filename, &new_dirent) == -1) return -1;
 
   // next aval file name
   for (idx = 2; idx < NUM_MAX_OPEN_FILES; idx++) 
@@ -57,6 +118,42 @@ int32_t file_open(const uint8_t* filename)
     rtc_open(idx);
     return idx;
   }
+  else if (new_dirent.filetype == FILE_TYPE_SERIAL)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) serial_ops;
+    file_array[idx].inode_num = 0;
+    serial_open(filename);
+  }
+  else if (new_dirent.filetype == FILE_TYPE_TRACE)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) trace_ops;
+    file_array[idx].inode_num = 0;
+    trace_open(filename);
+  }
+  else if (new_dirent.filetype == FILE_TYPE_SYSSTAT)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) sysstat_ops;
+    file_array[idx].inode_num = 0;
+    sysstat_open(filename);
+  }
+  else if (new_dirent.filetype == FILE_TYPE_PROC)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) proc_ops;
+    file_array[idx].inode_num = new_dirent.inode_num;
+    proc_open(filename);
+  }
+  else if (new_dirent.filetype == FILE_TYPE_PROFILE)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) profile_ops;
+    file_array[idx].inode_num = 0;
+    profile_open(filename);
+  }
+  else if (new_dirent.filetype == FILE_TYPE_KMSG)
+  {
+    file_array[idx].file_ops_table_ptr = (int32_t) klog_ops;
+    file_array[idx].inode_num = 0;
+    klog_open(filename);
+  }
   else 
   {
     return -1;
@@ -78,7 +175,7 @@ int32_t file_open(const uint8_t* filename)
  */
 int32_t file_close(int32_t fd)
 {
-  file_t * file_array = getCurrentProcessPCB()->file_array;
+  file_t * file_array = getCurrentProcessPCB()->files;
   if (fd >= NUM_MAX_OPEN_FILES || fd < 0) /* out of bounds */
     return -1;
   else if (file_array[fd].flags == FILE_AVAIL) /*try to open closed files*/
@@ -97,7 +194,7 @@ int32_t file_close(int32_t fd)
  */
 int32_t file_read(int32_t fd, int8_t* buf, int32_t nbytes)
 {
-  file_t * file_array = getCurrentProcessPCB()->file_array;
+  file_t * file_array = getCurrentProcessPCB()->files;
   if (fd == 1 || fd == 0) /* stdin and out, don't do anything return -1*/
     return -1;
 
@@ -111,15 +208,73 @@ int32_t file_read(int32_t fd, int8_t* buf, int32_t nbytes)
 }
 
 /* file_write
- * DESCRIPTION: writes to the file, except it's a read only file system so nothing
+ * DESCRIPTION: writes to the file at its position, growing it as needed
  * INPUTS: fd, pointer to buf, nbytes
- * OUTPUTS: -1
- * RETURN VALUE: -1
- * SIDE EFFECTS: none
+ * OUTPUTS: data into the image
+ * RETURN VALUE: bytes written, fewer if the image fills up, -1 on failure
+ * SIDE EFFECTS: moves the position past the bytes written
  */
 int32_t file_write(int32_t fd, const int8_t* buf, int32_t nbytes)
 {
-  return -1; 
+  file_t * file_array = getCurrentProcessPCB()->files;
+  int32_t written;
+
+  /* fd 1 lands here when stdout was redirected to a file */
+  if (buf == NULL || nbytes < 0)
+    return -1;
+
+  written = write_data(file_array[fd].inode_num, file_array[fd].file_position, (const uint8_t*) buf, nbytes);
+  if (written > 0)
+    file_array[fd].file_position += written;
+  return written;
+}
+
+/* file_truncate
+ * DESCRIPTION: sets the length of an open file, its position is kept
+ * INPUTS: fd, new length in bytes
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if fd is not a file, the image is full or
+ *               the file is mapped and would get shorter
+ * SIDE EFFECTS: frees or allocates data blocks
+ */
+int32_t file_truncate(int32_t fd, uint32_t length)
+{
+  int32_t inode = file_fd_inode(fd);
+
+  if (inode < 0)
+    return -1;
+  return truncate_data(inode, length);
+}
+
+/* file_seek
+ * DESCRIPTION: moves the position of an open file. Going past the end is
+ *              allowed, a later write fills the gap with zeros
+ * INPUTS: fd, offset, whence -- SEEK_SET, SEEK_CUR or SEEK_END
+ * OUTPUTS: none
+ * RETURN VALUE: the new position, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t file_seek(int32_t fd, int32_t offset, int32_t whence)
+{
+  file_t * file_array = getCurrentProcessPCB()->files;
+  int32_t inode = file_fd_inode(fd);
+  int32_t base;
+
+  if (inode < 0)
+    return -1;
+  if (whence == SEEK_SET)
+    base = 0;
+  else if (whence == SEEK_CUR)
+    base = file_array[fd].file_position;
+  else if (whence == SEEK_END)
+    base = flength(inode);
+  else
+    return -1;
+
+  if ((offset > 0 && base + offset < base) || base + offset < 0)
+    return -1;
+  file_array[fd].file_position = base + offset;
+  return base + offset;
 }
 
 /*
@@ -177,10 +332,14 @@ int32_t directory_close(int32_t fd)
 int32_t directory_read(int32_t fd, int8_t* buf, int32_t nbytes)
 {
   /* get current pcb's file array */
-  file_t * file_array = getCurrentProcessPCB()->file_array;
+  file_t * file_array = getCurrentProcessPCB()->files;
   dentry_t new_dirent;
 
   int32_t i = 0;
+  /* end of the directory, whichever layout it has */
+  if (file_array[fd].file_position >= ((boot_block_t*) fs_ptr)->dir_count) {
+     return 0;
+  }
   if (read_dentry_by_index(file_array[fd].file_position, &new_dirent) == -1) {
      return -1;
   }
@@ -197,6 +356,59 @@ int32_t directory_read(int32_t fd, int8_t* buf, int32_t nbytes)
   return i;
 }
 
+/* directory_getdents
+ * DESCRIPTION: fills buf with as many dirent_t records as fit, starting at
+ *              the entry the fd is at
+ * INPUTS: int32_t fd, uint8_t* buf, int32_t nbytes
+ * OUTPUTS: packed records in buf
+ * RETURN VALUE: bytes filled, 0 at the end of the directory, -1 if fd is
+ *               not a directory or the next record does not fit
+ * SIDE EFFECTS: moves the fd past the entries returned
+ */
+int32_t directory_getdents(int32_t fd, uint8_t* buf, int32_t nbytes)
+{
+  file_t * file_array = getCurrentProcessPCB()->files;
+  boot_block_t * boot_block = (boot_block_t*) fs_ptr;
+  dentry_t dentry;
+  dirent_t * rec;
+  uint32_t namelen, reclen;
+  int32_t filled = 0;
+
+  if (fd >= NUM_MAX_OPEN_FILES || fd < 0) return -1;
+  if (file_array[fd].flags != FILE_AVAIL && file_array[fd].file_ops_table_ptr == (int32_t) proc_ops)
+    return proc_getdents(fd, buf, nbytes);
+  if (file_array[fd].flags == FILE_AVAIL || file_array[fd].file_ops_table_ptr != (int32_t) directory_ops)
+    return -1;
+  if (buf == NULL || nbytes < 0) return -1;
+
+  while (file_array[fd].file_position < boot_block->dir_count &&
+         read_dentry_by_index(file_array[fd].file_position, &dentry) == 0)
+  {
+    /* names fill all 32 bytes when they are that long */
+    for (namelen = 0; namelen < FILENAME_LEN && dentry.filename[namelen] != '\0'; namelen++);
+    reclen = (sizeof(dirent_t) + namelen + 1 + 3) & ~3;
+    if (filled + reclen > nbytes)
+      break;
+
+    rec = (dirent_t*) (buf + filled);
+    rec->inode_num = dentry.inode_num;
+    rec->size = (dentry.filetype == FILE_TYPE_FILE) ? flength(dentry.inode_num) : 0;
+    rec->reclen = reclen;
+    rec->filetype = dentry.filetype;
+    rec->namelen = namelen;
+    memcpy(rec->name, dentry.filename, namelen);
+    rec->name[namelen] = '\0';
+
+    filled += reclen;
+    file_array[fd].file_position++;
+  }
+
+  /* not even one record fit */
+  if (filled == 0 && file_array[fd].file_position < boot_block->dir_count)
+    return -1;
+  return filled;
+}
+
 /* directory_write
  * DESCRIPTION: does nothing
  * INPUTS: int32_t fd, const int8_t* buf, int32_t nbytes
@@ -209,17 +421,35 @@ int32_t directory_write(int32_t fd, const int8_t* buf, int32_t nbytes)
   return -1; /*does nothing */
 }
 
+/* dir_name_hash
+ * DESCRIPTION: FNV-1a hash of a name as FS_FEAT_DIRHASH images store it
+ * INPUTS: filename, read up to its NUL or FILENAME_LEN bytes
+ * OUTPUTS: none
+ * RETURN VALUE: 32-bit hash
+ */
+static uint32_t dir_name_hash(const uint8_t* fname)
+{
+  uint32_t hash = FS_FNV_BASIS;
+  uint32_t i;
+
+  for (i = 0; i < FILENAME_LEN && fname[i] != '\0'; i++){
+    hash = (hash ^ fname[i]) * FS_FNV_PRIME;
+  }
+  return hash;
+}
+
 /* read_dentry_by_name
- * DESCRIPTION: reads directory entry by name
+ * DESCRIPTION: reads directory entry by name. Hashed directories probe
+ *              their table, so the cost does not grow with the file count
  * INPUTS: filename
  * OUTPUTS: directory entry 
- * RETURN VALUE: none
+ * RETURN VALUE: 0 on success, -1 if there is no such name
  * SIDE EFFECTS: none
  */
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry)
 {
   /* search bootblock thru filename */
-  uint32_t index;
+  uint32_t index, slot, probes;
 
   if (fname == NULL){
     return -1;
@@ -230,13 +460,24 @@ int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry)
     return -1;
 
   /* locate dir entry */
-  for (index = 0; index < NUM_FILES; index++){
+  if (dir_hash == NULL){
+    for (index = 0; index < dir_limit; index++){
 
-    /* if no match go to nexgt file */
-    if (strncmp((int8_t*) fname, ((boot_block_t*) fs_ptr)->direntries[index].filename, FILENAME_LEN) == 0){
-      read_dentry_by_index(index, dentry);
-      return 0;
+      /* if no match go to nexgt file */
+      if (strncmp((int8_t*) fname, dir_entries[index].filename, FILENAME_LEN) == 0){
+        return read_dentry_by_index(index, dentry);
+      }
     }
+    return -1;
+  }
+
+  slot = dir_name_hash(fname) & dir_hash_mask;
+  for (probes = 0; probes <= dir_hash_mask && dir_hash[slot] != 0; probes++){
+    index = dir_hash[slot] - 1;
+    if (index < dir_limit && strncmp((int8_t*) fname, dir_entries[index].filename, FILENAME_LEN) == 0){
+      return read_dentry_by_index(index, dentry);
+    }
+    slot = (slot + 1) & dir_hash_mask;
   }
   return -1;
 }
@@ -250,27 +491,281 @@ int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry)
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry)
 {
   /* read if index is invalid */
-  if (index >= NUM_FILES || index < 0){
+  if (index >= dir_limit){
       return -1;
   }
 
   /* copy the directory entry */
-  *dentry = ((boot_block_t*) fs_ptr)->direntries[index];
+  *dentry = dir_entries[index];
 
   return 0;
 }
 
+/* data_block_addr
+ * DESCRIPTION: address of a data block of the image. In a compressed image
+ *              that is a cache slot unless the block is stored raw, see
+ *              file_blocks_stable
+ * INPUTS: number of the data block
+ * OUTPUTS: none
+ * RETURN VALUE: address of the block, NULL if the number is out of range
+ */
+static uint8_t* data_block_addr(uint32_t data_block_num)
+{
+  boot_block_t* boot_block = (boot_block_t*) fs_ptr;
+
+  if (data_block_num >= boot_block->data_count){
+    return NULL;
+  }
+  if (fs_features & FS_FEAT_COMPRESSED){
+    return fscache_block(data_block_num);
+  }
+  return fs_ptr + NUM_B_IN_FOUR_KB * (boot_block->inode_count + data_block_num + 1);
+}
+
+/* file_blocks_stable
+ * DESCRIPTION: tells whether addresses from file_block_addr stay valid.
+ *              They do, except in a compressed image where they point into
+ *              the decompression cache
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if they do, 0 if not
+ */
+int32_t file_blocks_stable(void)
+{
+  return !(fs_features & FS_FEAT_COMPRESSED);
+}
+
+/* file_map_ref, file_map_unref
+ * DESCRIPTION: count the mappings mmap has of a file. Mapped blocks are
+ *              the image itself, so truncate_data does not free them while
+ *              the count is not 0
+ * INPUTS: inode
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void file_map_ref(uint32_t inode)
+{
+  if (inode < FS_BITMAP_INODES){
+    inode_maps[inode]++;
+  }
+}
+
+void file_map_unref(uint32_t inode)
+{
+  if (inode < FS_BITMAP_INODES && inode_maps[inode] > 0){
+    inode_maps[inode]--;
+  }
+}
+
+/* bitmap_test, bitmap_set, bitmap_clear
+ * DESCRIPTION: one bit of block_used or inode_used
+ * INPUTS: map, bit number
+ * OUTPUTS: none
+ * RETURN VALUE: bitmap_test returns 1 if the bit is set
+ */
+static inline int32_t bitmap_test(const uint8_t* map, uint32_t n)
+{
+  return (map[n / 8] >> (n % 8)) & 1;
+}
+
+static inline void bitmap_set(uint8_t* map, uint32_t n)
+{
+  map[n / 8] |= 1 << (n % 8);
+}
+
+static inline void bitmap_clear(uint8_t* map, uint32_t n)
+{
+  map[n / 8] &= ~(1 << (n % 8));
+}
+
+/* block_take
+ * DESCRIPTION: marks a free data block used and zeroes it
+ * INPUTS: data block number, below block_limit
+ * OUTPUTS: none
+ * RETURN VALUE: the block number
+ */
+static int32_t block_take(uint32_t num)
+{
+  bitmap_set(block_used, num);
+  free_blocks--;
+  memset(data_block_addr(num), 0, NUM_B_IN_FOUR_KB);
+  return num;
+}
+
+/* block_alloc
+ * DESCRIPTION: allocates a data block for file contents. The goal block
+ *              (the one after the previous block of the file) wins if it
+ *              is free; otherwise the block starts the first free run long
+ *              enough for the rest of the write, or the longest free run
+ * INPUTS: goal -- preferred block, -1 for none; run -- blocks still wanted
+ * OUTPUTS: none
+ * RETURN VALUE: block number, -1 if the image is full
+ */
+static int32_t block_alloc(int32_t goal, uint32_t run)
+{
+  uint32_t num, start, best, best_len;
+
+  if (goal >= 0 && goal < block_limit && !bitmap_test(block_used, goal)){
+    return block_take(goal);
+  }
+
+  start = 0;
+  best = 0;
+  best_len = 0;
+  for (num = 0; num < block_limit; num++){
+    if (bitmap_test(block_used, num)){
+      start = num + 1;
+      continue;
+    }
+    if (num - start + 1 >= run){
+      return block_take(start);
+    }
+    if (num - start + 1 > best_len){
+      best = start;
+      best_len = num - start + 1;
+    }
+  }
+  return (best_len > 0) ? block_take(best) : -1;
+}
+
+/* block_alloc_meta
+ * DESCRIPTION: allocates an indirect block from the top of the image so it
+ *              does not split the runs file contents are placed in
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: block number, -1 if the image is full
+ */
+static int32_t block_alloc_meta(void)
+{
+  uint32_t num;
+
+  for (num = block_limit; num-- > 0; ){
+    if (!bitmap_test(block_used, num)){
+      return block_take(num);
+    }
+  }
+  return -1;
+}
+
+/* block_free
+ * DESCRIPTION: gives a data block back to the allocator
+ * INPUTS: data block number
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void block_free(uint32_t num)
+{
+  if (num < block_limit && bitmap_test(block_used, num)){
+    bitmap_clear(block_used, num);
+    free_blocks++;
+  }
+}
+
+/* block_mark
+ * DESCRIPTION: records at mount time that the image uses a data block
+ * INPUTS: data block number
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void block_mark(uint32_t num)
+{
+  if (num < block_limit && !bitmap_test(block_used, num)){
+    bitmap_set(block_used, num);
+    free_blocks--;
+  }
+}
+
+/* index_table
+ * DESCRIPTION: the indirect block a slot of an inode or of another
+ *              indirect block points to
+ * INPUTS: slot, create -- 1 to allocate a fresh zeroed block first
+ * OUTPUTS: none
+ * RETURN VALUE: the indirect block, NULL if out of range or none is free
+ */
+static int32_t* index_table(int32_t* slot, int32_t create)
+{
+  int32_t num;
+
+  if (create){
+    if ((num = block_alloc_meta()) < 0){
+      return NULL;
+    }
+    *slot = num;
+  }
+  return (int32_t*) data_block_addr(*slot);
+}
+
+/* block_slot
+ * DESCRIPTION: finds the word holding the number of a block of a file.
+ *              With FS_FEAT_INDIRECT it goes through at most two indirect
+ *              blocks, so any offset resolves in O(1)
+ * INPUTS: inode block, index of the block within the file, create -- 1 to
+ *         allocate the indirect blocks that start covering at index (files
+ *         grow one block at a time, in order)
+ * OUTPUTS: none
+ * RETURN VALUE: pointer into the inode or an indirect block, NULL if the
+ *               format cannot address the index or a block is out of range
+ */
+static int32_t* block_slot(inode_block_t* inode_block, uint32_t index, int32_t create)
+{
+  int32_t* table;
+
+  if (!(fs_features & FS_FEAT_INDIRECT)){
+    return (index < NUM_DATA_BLOCKS_IN_INODE) ? &inode_block->data_block_num[index] : NULL;
+  }
+
+  if (index < FS_DIRECT_PTRS){
+    return &inode_block->data_block_num[index];
+  }
+
+  index -= FS_DIRECT_PTRS;
+  if (index < FS_PTRS_PER_BLOCK){
+    table = index_table(&inode_block->data_block_num[FS_SINGLE_INDIRECT], create && index == 0);
+    return (table == NULL) ? NULL : &table[index];
+  }
+
+  index -= FS_PTRS_PER_BLOCK;
+  if (index < FS_PTRS_PER_BLOCK * FS_PTRS_PER_BLOCK){
+    table = index_table(&inode_block->data_block_num[FS_DOUBLE_INDIRECT], create && index == 0);
+    if (table == NULL){
+      return NULL;
+    }
+    table = index_table(&table[index / FS_PTRS_PER_BLOCK], create && index % FS_PTRS_PER_BLOCK == 0);
+    return (table == NULL) ? NULL : &table[index % FS_PTRS_PER_BLOCK];
+  }
+  return NULL;
+}
+
+/* file_block_addr
+ * DESCRIPTION: finds where a block of a file sits in the image
+ * INPUTS: inode, index of the block within the file
+ * OUTPUTS: none
+ * RETURN VALUE: address of the 4KB data block, NULL if the inode or a
+ *               block number on the way is out of range
+ */
+uint8_t* file_block_addr(uint32_t inode, uint32_t index)
+{
+  int32_t* slot;
+
+  if (inode >= ((boot_block_t*) fs_ptr)->inode_count){
+    return NULL;
+  }
+  slot = block_slot((inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1)), index, 0);
+  return (slot == NULL) ? NULL : data_block_addr(*slot);
+}
+
 /* read_data
- * DESCRIPTION: read data
+ * DESCRIPTION: copies bytes of a file into buf. A file found contiguous at
+ *              mount time is one memcpy; otherwise each run of physically
+ *              consecutive blocks is copied in one go
  * INPUTS: inode , offset, buffer, length
- * OUTPUTS: daata into buf
- * RETURN VALUE: nbytes
+ * OUTPUTS: data into buf
+ * RETURN VALUE: nbytes, 0 at the end of the file, -1 on a bad inode or block
  */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length)
 {
   /* local variables */
-  int32_t count, index_in_inode, index_in_data_block, data_block_num, done;
-  inode_block_t* inode_block;
+  uint32_t count, index_in_inode, index_in_data_block, run, file_length, flags;
   uint8_t* data_block;
 
   /* check in range */
@@ -278,47 +773,556 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
     return -1;
   }
 
-// /* how many files open? */
-  count = 0;
+  file_length = flength(inode);
+  if (offset >= file_length){
+    return 0;
+  }
+  if (length > file_length - offset){
+    length = file_length - offset;
+  }
 
-  /* get inode block */
-  inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1));
+  /* whole file in one extent */
+  if (inode < FS_EXTENT_INODES && inode_extent[inode] != NULL){
+    memcpy(buf, inode_extent[inode] + offset, length);
+    return length;
+  }
 
-  if (offset >= inode_block->length){
+  /* a cached block is copied before anyone can evict it, one at a time */
+  if (fs_features & FS_FEAT_COMPRESSED){
+    for (count = 0; count < length; count += run){
+      index_in_data_block = offset % NUM_B_IN_FOUR_KB;
+      run = NUM_B_IN_FOUR_KB - index_in_data_block;
+      if (run > length - count){
+        run = length - count;
+      }
+      cli_and_save(flags);
+      data_block = file_block_addr(inode, offset / NUM_B_IN_FOUR_KB);
+      if (data_block != NULL){
+        memcpy(buf + count, data_block + index_in_data_block, run);
+      }
+      restore_flags(flags);
+      if (data_block == NULL){
+        return -1;
+      }
+      offset += run;
+    }
     return count;
   }
 
-  /* calculate the index_in_inode */
-  index_in_inode = offset / NUM_B_IN_FOUR_KB;
-  index_in_data_block = offset % NUM_B_IN_FOUR_KB;
-  done = 0;
-
-  /* if not done reading into buf, get data block number, and get data block */
-  while (done == 0){
-    data_block_num = inode_block->data_block_num[index_in_inode];
-    if (data_block_num >= ((boot_block_t*) fs_ptr)->data_count){
+  count = 0;
+  while (count < length){
+    index_in_inode = offset / NUM_B_IN_FOUR_KB;
+    index_in_data_block = offset % NUM_B_IN_FOUR_KB;
+    data_block = file_block_addr(inode, index_in_inode);
+    if (data_block == NULL){
       return -1;
     }
-    data_block = (uint8_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (((boot_block_t*) fs_ptr)->inode_count + data_block_num + 1));
 
-   /* read into buf */
-    while (count < length && index_in_data_block < NUM_B_IN_FOUR_KB && offset < inode_block->length){
-      buf[count] = data_block[index_in_data_block];
-      index_in_data_block++;
-      offset++;
-      count++;
+    /* grow the run while the next block follows this one in the image */
+    run = NUM_B_IN_FOUR_KB - index_in_data_block;
+    while (run < length - count &&
+           file_block_addr(inode, ++index_in_inode) == data_block + index_in_data_block + run){
+      run += NUM_B_IN_FOUR_KB;
+    }
+    if (run > length - count){
+      run = length - count;
+    }
+
+    memcpy(buf + count, data_block + index_in_data_block, run);
+    count += run;
+    offset += run;
+  }
+  return count;
+}
+
+/* file_blocks, meta_blocks, max_file_blocks
+ * DESCRIPTION: data blocks a length needs, indirect blocks a file of that
+ *              many data blocks needs, and the most data blocks an inode
+ *              can address in the mounted format
+ */
+static uint32_t file_blocks(uint32_t length)
+{
+  return length / NUM_B_IN_FOUR_KB + (length % NUM_B_IN_FOUR_KB != 0);
+}
+
+static uint32_t meta_blocks(uint32_t blocks)
+{
+  if (!(fs_features & FS_FEAT_INDIRECT) || blocks <= FS_DIRECT_PTRS){
+    return 0;
+  }
+  if (blocks <= FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK){
+    return 1;
+  }
+  blocks -= FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK;
+  return 2 + blocks / FS_PTRS_PER_BLOCK + (blocks % FS_PTRS_PER_BLOCK != 0);
+}
+
+static uint32_t max_file_blocks(void)
+{
+  if (!(fs_features & FS_FEAT_INDIRECT)){
+    return NUM_DATA_BLOCKS_IN_INODE;
+  }
+  return FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK + FS_PTRS_PER_BLOCK * FS_PTRS_PER_BLOCK;
+}
+
+/* blocks_fit
+ * DESCRIPTION: cuts a wanted block count down to what the free blocks of
+ *              the image can hold, indirect blocks included
+ * INPUTS: blocks the file has, blocks wanted
+ * OUTPUTS: none
+ * RETURN VALUE: block count between have and want
+ */
+static uint32_t blocks_fit(uint32_t have, uint32_t want)
+{
+  if (want > max_file_blocks()){
+    want = max_file_blocks();
+  }
+  while (want > have && want - have + meta_blocks(want) - meta_blocks(have) > free_blocks){
+    want--;
+  }
+  return want;
+}
+
+/* file_grow
+ * DESCRIPTION: gives a file more data blocks, each placed right after the
+ *              previous one when possible. The caller checked with
+ *              blocks_fit that they are free
+ * INPUTS: inode, blocks the file has, blocks it gets
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: keeps inode_extent up to date
+ */
+static void file_grow(uint32_t inode, uint32_t have, uint32_t want)
+{
+  inode_block_t* inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1));
+  int32_t goal, num;
+  uint8_t* block;
+  uint32_t index;
+
+  for (index = have; index < want; index++){
+    goal = (index > 0) ? *block_slot(inode_block, index - 1, 0) + 1 : -1;
+    num = block_alloc(goal, want - index);
+    *block_slot(inode_block, index, 1) = num;
+
+    if (inode < FS_EXTENT_INODES){
+      block = data_block_addr(num);
+      if (index == 0){
+        inode_extent[inode] = block;
+      } else if (block != inode_extent[inode] + index * NUM_B_IN_FOUR_KB){
+        inode_extent[inode] = NULL;
+      }
+    }
+  }
+}
+
+/* file_shrink
+ * DESCRIPTION: frees the data blocks of a file from index want on, and the
+ *              indirect blocks that no longer cover any of the rest
+ * INPUTS: inode, blocks the file has, blocks it keeps
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void file_shrink(uint32_t inode, uint32_t have, uint32_t want)
+{
+  inode_block_t* inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1));
+  int32_t* table;
+  uint32_t index, rest;
+
+  for (index = have; index-- > want; ){
+    block_free(*block_slot(inode_block, index, 0));
+    if (!(fs_features & FS_FEAT_INDIRECT) || index < FS_DIRECT_PTRS){
+      continue;
+    }
+    if (index == FS_DIRECT_PTRS){
+      block_free(inode_block->data_block_num[FS_SINGLE_INDIRECT]);
+      continue;
+    }
+    rest = index - FS_DIRECT_PTRS - FS_PTRS_PER_BLOCK;
+    if (index >= FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK && rest % FS_PTRS_PER_BLOCK == 0){
+      table = (int32_t*) data_block_addr(inode_block->data_block_num[FS_DOUBLE_INDIRECT]);
+      block_free(table[rest / FS_PTRS_PER_BLOCK]);
+      if (rest == 0){
+        block_free(inode_block->data_block_num[FS_DOUBLE_INDIRECT]);
+      }
     }
+  }
+  if (want == 0 && inode < FS_EXTENT_INODES){
+    inode_extent[inode] = NULL;
+  }
+}
 
-    /* if maximum bytes reached then put flag back */
-    if (count >= length || offset >= inode_block->length){
-      done = 1;
+/* zero_tail
+ * DESCRIPTION: clears the bytes of the last block past the end of a file,
+ *              so growing it later reads back zeros
+ * INPUTS: inode, length of the file
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void zero_tail(uint32_t inode, uint32_t length)
+{
+  uint8_t* block;
+
+  if (length % NUM_B_IN_FOUR_KB == 0){
+    return;
+  }
+  block = file_block_addr(inode, length / NUM_B_IN_FOUR_KB);
+  if (block != NULL){
+    memset(block + length % NUM_B_IN_FOUR_KB, 0, NUM_B_IN_FOUR_KB - length % NUM_B_IN_FOUR_KB);
+  }
+}
+
+/* file_writable
+ * DESCRIPTION: checks that an inode belongs to a file that can be written
+ * INPUTS: inode
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if it can, 0 if not
+ */
+static int32_t file_writable(uint32_t inode)
+{
+  return !(fs_features & FS_FEAT_COMPRESSED) &&
+         inode != 0 && inode < ((boot_block_t*) fs_ptr)->inode_count &&
+         inode < FS_BITMAP_INODES && bitmap_test(inode_used, inode);
+}
+
+/* write_data
+ * DESCRIPTION: copies buf into a file at offset, growing it if the write
+ *              goes past the end. A gap before offset reads back as zeros
+ * INPUTS: inode, offset, buffer, length
+ * OUTPUTS: data into the image
+ * RETURN VALUE: bytes written, fewer than length if the image fills up,
+ *               -1 if the inode is not a file or nothing fits
+ * SIDE EFFECTS: allocates data blocks
+ */
+int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length)
+{
+  inode_block_t* inode_block;
+  uint32_t flags, end, count, run, have, want;
+  uint8_t* block;
+
+  if (!file_writable(inode) || buf == NULL){
+    return -1;
+  }
+  if (length == 0){
+    return 0;
+  }
+  end = offset + length;
+  if (end < offset){
+    return -1;
+  }
+
+  cli_and_save(flags);
+  inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1));
+
+  if (end > (uint32_t) inode_block->length){
+    have = file_blocks(inode_block->length);
+    want = blocks_fit(have, file_blocks(end));
+    if (want < file_blocks(end)){
+      end = want * NUM_B_IN_FOUR_KB;
+    }
+    if (end <= offset){
+      restore_flags(flags);
+      return -1;
     }
-    index_in_data_block = 0;
-    index_in_inode++;
+    zero_tail(inode, inode_block->length);
+    file_grow(inode, have, want);
+    if (end > (uint32_t) inode_block->length){
+      inode_block->length = end;
+    }
+  }
+
+  for (count = 0; offset + count < end; count += run){
+    block = file_block_addr(inode, (offset + count) / NUM_B_IN_FOUR_KB);
+    run = NUM_B_IN_FOUR_KB - (offset + count) % NUM_B_IN_FOUR_KB;
+    if (run > end - offset - count){
+      run = end - offset - count;
+    }
+    memcpy(block + (offset + count) % NUM_B_IN_FOUR_KB, buf + count, run);
   }
+
+  restore_flags(flags);
   return count;
 }
 
+/* truncate_data
+ * DESCRIPTION: sets the length of a file, freeing blocks past the new end
+ *              or adding zeroed ones
+ * INPUTS: inode, new length
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the inode is not a file, the image
+ *               has no room, or the file would get shorter while it is
+ *               mapped
+ */
+int32_t truncate_data(uint32_t inode, uint32_t length)
+{
+  inode_block_t* inode_block;
+  uint32_t flags, have, want;
+
+  if (!file_writable(inode)){
+    return -1;
+  }
+
+  cli_and_save(flags);
+  inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1));
+  have = file_blocks(inode_block->length);
+  want = file_blocks(length);
+
+  /* a mapping would keep reading blocks the next write may hand out */
+  if (length < (uint32_t) inode_block->length && inode_maps[inode] > 0){
+    restore_flags(flags);
+    return -1;
+  }
+  if (want > have && blocks_fit(have, want) != want){
+    restore_flags(flags);
+    return -1;
+  }
+
+  /* past the shorter of the two lengths everything reads back as zeros */
+  zero_tail(inode, (length < (uint32_t) inode_block->length) ? length : (uint32_t) inode_block->length);
+  if (want > have){
+    file_grow(inode, have, want);
+  } else {
+    file_shrink(inode, have, want);
+  }
+  inode_block->length = length;
+
+  restore_flags(flags);
+  return 0;
+}
+
+/* create_file
+ * DESCRIPTION: adds an empty regular file to the directory
+ * INPUTS: filename, shorter than FILENAME_LEN
+ * OUTPUTS: none
+ * RETURN VALUE: inode of the new file, -1 if the name is bad or taken, or
+ *               the directory or the inodes are full
+ * SIDE EFFECTS: takes an inode and a directory entry
+ */
+int32_t create_file(const uint8_t* filename)
+{
+  boot_block_t* boot_block = (boot_block_t*) fs_ptr;
+  dentry_t existing;
+  dentry_t* dentry;
+  uint32_t flags, inode, inodes, slot, len;
+
+  if (filename == NULL){
+    return -1;
+  }
+  len = strlen((int8_t*) filename);
+  if (len == 0 || len >= FILENAME_LEN || (fs_features & FS_FEAT_COMPRESSED)){
+    return -1;
+  }
+
+  cli_and_save(flags);
+  if (lookup_file(filename, &existing) == 0 ||
+      boot_block->dir_count >= ((dir_hash == NULL) ? NUM_FILES : (dir_hash_mask + 1) / 2)){
+    restore_flags(flags);
+    return -1;
+  }
+
+  inodes = boot_block->inode_count;
+  if (inodes > FS_BITMAP_INODES){
+    inodes = FS_BITMAP_INODES;
+  }
+  for (inode = 1; inode < inodes && bitmap_test(inode_used, inode); inode++);
+  if (inode >= inodes){
+    restore_flags(flags);
+    return -1;
+  }
+  bitmap_set(inode_used, inode);
+  ((inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (inode + 1)))->length = 0;
+  if (inode < FS_EXTENT_INODES){
+    inode_extent[inode] = NULL;
+  }
+
+  dentry = &dir_entries[boot_block->dir_count];
+  memset(dentry, 0, sizeof(dentry_t));
+  strncpy(dentry->filename, (int8_t*) filename, FILENAME_LEN);
+  dentry->filetype = FILE_TYPE_FILE;
+  dentry->inode_num = inode;
+
+  if (dir_hash != NULL){
+    slot = dir_name_hash(filename) & dir_hash_mask;
+    while (dir_hash[slot] != 0){
+      slot = (slot + 1) & dir_hash_mask;
+    }
+    dir_hash[slot] = boot_block->dir_count + 1;
+    dir_limit++;
+  }
+  boot_block->dir_count++;
+
+  restore_flags(flags);
+  return inode;
+}
+
+/* dir_init
+ * DESCRIPTION: finds the directory of the mounted image. Hashed ones are
+ *              used only if all of their blocks lie inside the image
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: sets dir_entries, dir_limit, dir_hash and dir_hash_mask
+ */
+static void dir_init(void)
+{
+  boot_block_t* boot_block = (boot_block_t*) fs_ptr;
+  uint32_t dir_blocks, hash_blocks, i;
+
+  /* the boot block holds NUM_FILES entries, used or not */
+  dir_entries = boot_block->direntries;
+  dir_limit = NUM_FILES;
+  dir_hash = NULL;
+  dir_hash_mask = 0;
+
+  if (!(fs_features & FS_FEAT_DIRHASH)){
+    return;
+  }
+  if (boot_block->dir_count <= 0 || boot_block->dir_count > FS_MAX_DENTRIES ||
+      boot_block->hash_size < 2 * (uint32_t) boot_block->dir_count ||
+      (boot_block->hash_size & (boot_block->hash_size - 1)) != 0){
+    return;
+  }
+  /* the dentry blocks have room for hash_size / 2 entries */
+  dir_blocks = (boot_block->hash_size / 2 + FS_DENTRIES_PER_BLOCK - 1) / FS_DENTRIES_PER_BLOCK;
+  hash_blocks = (boot_block->hash_size + FS_HASH_PER_BLOCK - 1) / FS_HASH_PER_BLOCK;
+  if (data_block_addr(boot_block->dir_block) == NULL ||
+      data_block_addr(boot_block->dir_block + dir_blocks - 1) == NULL ||
+      data_block_addr(boot_block->hash_block) == NULL ||
+      data_block_addr(boot_block->hash_block + hash_blocks - 1) == NULL){
+    return;
+  }
+
+  /* compressed images keep these blocks raw, so they stay in place */
+  for (i = 1; i < dir_blocks; i++){
+    if (data_block_addr(boot_block->dir_block + i) != data_block_addr(boot_block->dir_block) + i * NUM_B_IN_FOUR_KB){
+      return;
+    }
+  }
+  for (i = 1; i < hash_blocks; i++){
+    if (data_block_addr(boot_block->hash_block + i) != data_block_addr(boot_block->hash_block) + i * NUM_B_IN_FOUR_KB){
+      return;
+    }
+  }
+
+  dir_entries = (dentry_t*) data_block_addr(boot_block->dir_block);
+  dir_limit = boot_block->dir_count;
+  dir_hash = (uint32_t*) data_block_addr(boot_block->hash_block);
+  dir_hash_mask = boot_block->hash_size - 1;
+}
+
+/* mark_used
+ * DESCRIPTION: builds the free block and inode bitmaps from the image:
+ *              the inodes the directory names, the data and indirect blocks
+ *              of their files and the blocks of a hashed directory
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: fills block_used, inode_used, block_limit and free_blocks
+ */
+static void mark_used(void)
+{
+  boot_block_t* boot_block = (boot_block_t*) fs_ptr;
+  inode_block_t* inode_block;
+  int32_t* table;
+  uint32_t i, index, blocks;
+  dentry_t dentry;
+
+  memset(block_used, 0, sizeof(block_used));
+  memset(inode_used, 0, sizeof(inode_used));
+  block_limit = (boot_block->data_count < FS_BITMAP_BLOCKS) ? boot_block->data_count : FS_BITMAP_BLOCKS;
+  free_blocks = block_limit;
+
+  /* compressed images are read-only */
+  if (fs_features & FS_FEAT_COMPRESSED){
+    block_limit = 0;
+    free_blocks = 0;
+    return;
+  }
+
+  /* "." and "rtc" share inode 0 */
+  bitmap_set(inode_used, 0);
+
+  if (dir_hash != NULL){
+    blocks = (dir_hash_mask + 1) / 2 / FS_DENTRIES_PER_BLOCK;
+    for (i = 0; i < blocks; i++){
+      block_mark(boot_block->dir_block + i);
+    }
+    blocks = (dir_hash_mask + 1) / FS_HASH_PER_BLOCK;
+    for (i = 0; i < blocks; i++){
+      block_mark(boot_block->hash_block + i);
+    }
+  }
+
+  for (i = 0; i < boot_block->dir_count && read_dentry_by_index(i, &dentry) == 0; i++){
+    if (dentry.inode_num >= boot_block->inode_count || dentry.inode_num >= FS_BITMAP_INODES){
+      continue;
+    }
+    bitmap_set(inode_used, dentry.inode_num);
+    if (dentry.filetype != FILE_TYPE_FILE){
+      continue;
+    }
+
+    inode_block = (inode_block_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (dentry.inode_num + 1));
+    blocks = file_blocks(inode_block->length);
+    if (blocks > max_file_blocks()){
+      blocks = max_file_blocks();
+    }
+    for (index = 0; index < blocks; index++){
+      block_mark(*block_slot(inode_block, index, 0));
+    }
+    if (blocks > FS_DIRECT_PTRS && (fs_features & FS_FEAT_INDIRECT)){
+      block_mark(inode_block->data_block_num[FS_SINGLE_INDIRECT]);
+    }
+    if (blocks > FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK && (fs_features & FS_FEAT_INDIRECT)){
+      block_mark(inode_block->data_block_num[FS_DOUBLE_INDIRECT]);
+      table = (int32_t*) data_block_addr(inode_block->data_block_num[FS_DOUBLE_INDIRECT]);
+      for (index = 0; index < meta_blocks(blocks) - 2; index++){
+        block_mark(table[index]);
+      }
+    }
+  }
+}
+
+/* find_extents
+ * DESCRIPTION: records which files sit in consecutive data blocks, so
+ *              read_data can copy them without walking the block list
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: fills inode_extent
+ */
+static void find_extents(void)
+{
+  uint32_t inode, index, blocks, inodes;
+  uint8_t* first;
+
+  inodes = ((boot_block_t*) fs_ptr)->inode_count;
+  if (inodes > FS_EXTENT_INODES){
+    inodes = FS_EXTENT_INODES;
+  }
+
+  for (inode = 0; inode < FS_EXTENT_INODES; inode++){
+    inode_extent[inode] = NULL;
+  }
+  if (!file_blocks_stable()){
+    return;
+  }
+  for (inode = 0; inode < inodes; inode++){
+    blocks = (flength(inode) + NUM_B_IN_FOUR_KB - 1) / NUM_B_IN_FOUR_KB;
+    first = file_block_addr(inode, 0);
+    if (blocks == 0 || first == NULL){
+      continue;
+    }
+    for (index = 1; index < blocks; index++){
+      if (file_block_addr(inode, index) != first + index * NUM_B_IN_FOUR_KB){
+        break;
+      }
+    }
+    if (index == blocks){
+      inode_extent[inode] = first;
+    }
+  }
+}
+
 /* filesys_init
  * DESCRIPTION: initializes the filesystem
  * INPUTS: ptr
@@ -328,7 +1332,19 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
  */
 void filesys_init(uint32_t ptr)
 {
+  uint32_t* table;
+  uint32_t table_blocks;
+
   fs_ptr = (uint8_t *) ptr;
+  fs_features = (((boot_block_t*) fs_ptr)->magic == FS_MAGIC) ? ((boot_block_t*) fs_ptr)->features : 0;
+  if (fs_features & FS_FEAT_COMPRESSED){
+    table = (uint32_t*) (fs_ptr + NUM_B_IN_FOUR_KB * (((boot_block_t*) fs_ptr)->inode_count + 1));
+    table_blocks = ((((boot_block_t*) fs_ptr)->data_count + 1) * 4 + NUM_B_IN_FOUR_KB - 1) / NUM_B_IN_FOUR_KB;
+    fscache_init(table, (uint8_t*) table + table_blocks * NUM_B_IN_FOUR_KB, ((boot_block_t*) fs_ptr)->data_count);
+  }
+  dir_init();
+  find_extents();
+  mark_used();
 
   /* initialize the ptrs */
   blank.file_ops_table_ptr = 0;
@@ -365,3 +1381,151 @@ void init_file_array(file_t * file_array)
   file_array[1].file_position = 0;
   file_array[1].flags = FILE_OCCUP;
 }
+
+/* pipe_fd_open
+ * DESCRIPTION: puts one end of a pipe in the next free entry of the
+ *              current file array
+ * INPUTS: pipe -- pipe index, end -- PIPE_READ_END or PIPE_WRITE_END
+ * OUTPUTS: int fd on success, -1 on failure
+ * RETURN VALUE: int fd on success, -1 if the file array is full
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_fd_open(uint32_t pipe, uint32_t end)
+{
+  file_t * file_array = getCurrentProcessPCB()->files;
+  int32_t idx;
+
+  for (idx = 2; idx < NUM_MAX_OPEN_FILES; idx++)
+  {
+    if (file_array[idx].flags == FILE_AVAIL)
+      break;
+  }
+  if (idx >= NUM_MAX_OPEN_FILES) return -1;
+
+  file_array[idx].file_ops_table_ptr = (int32_t) pipe_ops;
+  file_array[idx].inode_num = pipe;
+  file_array[idx].file_position = end;   /* which end, pipes do not seek */
+  file_array[idx].flags = FILE_OCCUP;
+  return idx;
+}
+
+/* file_inherit
+ * DESCRIPTION: copies an open file into another process' file array
+ * INPUTS: dst -- entry to fill, src -- open file to copy
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: a copied pipe end keeps the pipe open until both close
+ */
+void file_inherit(file_t * dst, const file_t * src)
+{
+  *dst = *src;
+  if (src->file_ops_table_ptr == (int32_t) pipe_ops)
+    pipe_ref(src->inode_num, src->file_position);
+}
+
+/* file_fd_inode
+ * DESCRIPTION: inode behind an fd of the current process, if it is a file
+ * INPUTS: fd
+ * OUTPUTS: none
+ * RETURN VALUE: inode number, -1 if fd is not an open regular file
+ * SIDE EFFECTS: none
+ */
+int32_t file_fd_inode(int32_t fd)
+{
+  file_t * file_array = getCurrentProcessPCB()->files;
+
+  if (fd >= NUM_MAX_OPEN_FILES || fd < 0)
+    return -1;
+  if (file_array[fd].flags == FILE_AVAIL || file_array[fd].file_ops_table_ptr != (int32_t) file_ops)
+    return -1;
+  return file_array[fd].inode_num;
+}
+
+/* fill_stat
+ * DESCRIPTION: fills a stat_t for a file of the image
+ * INPUTS: type, inode, st
+ * OUTPUTS: st
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void fill_stat(uint32_t type, uint32_t inode, stat_t * st)
+{
+  st->filetype = type;
+  st->inode_num = inode;
+  st->length = (type == FILE_TYPE_FILE) ? flength(inode) : 0;
+  st->blocks = (st->length + NUM_B_IN_FOUR_KB - 1) / NUM_B_IN_FOUR_KB;
+}
+
+/* file_stat
+ * DESCRIPTION: looks up a file by name without opening it
+ * INPUTS: filename, st
+ * OUTPUTS: type, inode, length and block count in st
+ * RETURN VALUE: 0 on success, -1 if there is no such file
+ * SIDE EFFECTS: none
+ */
+int32_t file_stat(const uint8_t* filename, stat_t * st)
+{
+  dentry_t dentry;
+
+  if (filename == NULL || strlen((int8_t*)filename) > FILENAME_LEN) return -1;
+  if (lookup_file(filename, &dentry) == -1) return -1;
+  fill_stat(dentry.filetype, dentry.inode_num, st);
+  return 0;
+}
+
+/* file_type_of
+ * DESCRIPTION: what kind of file an open file is, told by its ops table
+ * INPUTS: file -- an entry of a file array that is in use
+ * OUTPUTS: none
+ * RETURN VALUE: FILE_TYPE_*
+ * SIDE EFFECTS: none
+ */
+int32_t file_type_of(const file_t * file)
+{
+  int32_t ops = file->file_ops_table_ptr;
+
+  if (ops == (int32_t) file_ops)
+    return FILE_TYPE_FILE;
+  if (ops == (int32_t) directory_ops)
+    return FILE_TYPE_DIR;
+  if (ops == (int32_t) rtc_ops)
+    return FILE_TYPE_RTC;
+  if (ops == (int32_t) pipe_ops)
+    return FILE_TYPE_PIPE;
+  if (ops == (int32_t) serial_ops)
+    return FILE_TYPE_SERIAL;
+  if (ops == (int32_t) trace_ops)
+    return FILE_TYPE_TRACE;
+  if (ops == (int32_t) sysstat_ops)
+    return FILE_TYPE_SYSSTAT;
+  if (ops == (int32_t) proc_ops)
+    return FILE_TYPE_PROC;
+  if (ops == (int32_t) profile_ops)
+    return FILE_TYPE_PROFILE;
+  if (ops == (int32_t) klog_ops)
+    return FILE_TYPE_KMSG;
+  return FILE_TYPE_TERMINAL;
+}
+
+/* file_fstat
+ * DESCRIPTION: describes an open fd of the current process
+ * INPUTS: fd, st
+ * OUTPUTS: type, inode, length and block count in st
+ * RETURN VALUE: 0 on success, -1 if fd is not open
+ * SIDE EFFECTS: none
+ */
+int32_t file_fstat(int32_t fd, stat_t * st)
+{
+  file_t * file_array = getCurrentProcessPCB()->files;
+  int32_t type;
+
+  if (fd >= NUM_MAX_OPEN_FILES || fd < 0) return -1;
+  if (file_array[fd].flags == FILE_AVAIL) return -1;
+
+  type = file_type_of(&file_array[fd]);
+  if (type == FILE_TYPE_FILE || type == FILE_TYPE_DIR || type == FILE_TYPE_RTC)
+    fill_stat(type, file_array[fd].inode_num, st);
+  else
+    fill_stat(type, 0, st);
+  return 0;
+}
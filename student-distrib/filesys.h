@@ -5,16 +5,34 @@
 #include "lib.h"
 #include "rtc.h"
 #include "pcb.h"
+#include "fsformat.h"
 
 #define FILENAME_LEN 32
 #define NUM_FILES 63
 #define NUM_B_IN_FOUR_KB 4096
+#define NUM_DATA_BLOCKS_IN_INODE 1023
+#define FS_EXTENT_INODES 1024     /* inodes checked for contiguity at mount */
+#define FS_BITMAP_BLOCKS 16384    /* data blocks the allocator tracks (64MB) */
+#define FS_BITMAP_INODES 4096     /* inodes the allocator tracks */
+
+/* whence of file_seek */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
 #define FILE_AVAIL 1
 #define FILE_OCCUP 0
 
 #define FILE_TYPE_RTC 0
 #define FILE_TYPE_DIR 1
 #define FILE_TYPE_FILE 2
+#define FILE_TYPE_PIPE 3      /* only reported by fstat */
+#define FILE_TYPE_TERMINAL 4  /* only reported by fstat */
+#define FILE_TYPE_SERIAL 5    /* not in the image, see lookup_file */
+#define FILE_TYPE_TRACE 6     /* not in the image, see lookup_file */
+#define FILE_TYPE_SYSSTAT 7   /* not in the image, see lookup_file */
+#define FILE_TYPE_PROC 8      /* not in the image, see lookup_file */
+#define FILE_TYPE_PROFILE 9   /* not in the image, see lookup_file */
+#define FILE_TYPE_KMSG 10     /* not in the image, see lookup_file */
 
 extern int32_t file_open(const uint8_t* filename);
 
@@ -24,6 +42,10 @@ extern int32_t file_read(int32_t fd, int8_t* buf, int32_t nbytes);
 
 extern int32_t file_write(int32_t fd, const int8_t* buf, int32_t nbytes);
 
+extern int32_t file_truncate(int32_t fd, uint32_t length);
+
+extern int32_t file_seek(int32_t fd, int32_t offset, int32_t whence);
+
 extern int32_t flength(uint32_t inode);
 
 extern int32_t directory_open(const uint8_t* filename);
@@ -34,6 +56,8 @@ extern int32_t directory_read(int32_t fd, int8_t* buf, int32_t nbytes);
 
 extern int32_t directory_write(int32_t fd, const int8_t* buf, int32_t nbytes);
 
+extern int32_t directory_getdents(int32_t fd, uint8_t* buf, int32_t nbytes);
+
 //struct field names taken from lecture notes
 //64 bytes total
 typedef struct dentry_t{
@@ -43,31 +67,83 @@ typedef struct dentry_t{
 	int8_t reserved[24];
 } dentry_t;
 
+//record filled in by getdents, reclen bytes long including the name
+typedef struct dirent_t{
+	uint32_t inode_num;
+	uint32_t size;          // file length in bytes, 0 if not a regular file
+	uint16_t reclen;        // offset of the next record, multiple of 4
+	uint8_t filetype;
+	uint8_t namelen;        // name length without the NUL
+	int8_t name[];          // NUL terminated
+} dirent_t;
+
+//filled in by stat and fstat
+typedef struct stat_t{
+	uint32_t filetype;      // FILE_TYPE_*
+	uint32_t inode_num;     // 0 if the file has no inode
+	uint32_t length;        // bytes, 0 if not a regular file
+	uint32_t blocks;        // 4KB data blocks holding the file
+} stat_t;
+
 //4096 bytes total
 typedef struct boot_block_t{
 	int32_t dir_count;
 	int32_t inode_count;
 	int32_t data_count;
-	int8_t reserved[52];
+	uint32_t magic;         // FS_MAGIC on images made by mkfs391
+	uint32_t features;      // FS_FEAT_* mask, valid when magic is set
+	uint32_t dir_block;     // FS_FEAT_DIRHASH: first data block of the dentries
+	uint32_t hash_block;    // FS_FEAT_DIRHASH: first data block of the hash table
+	uint32_t hash_size;     // FS_FEAT_DIRHASH: slots in the hash table
+	int8_t reserved[32];
 	dentry_t direntries[63];
 } boot_block_t;
 
 //4096 bytes total
 typedef struct inode_t{
 	int32_t length;
-	int32_t data_block_num[1023];
+	int32_t data_block_num[NUM_DATA_BLOCKS_IN_INODE];
 } inode_block_t;
 
 extern int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 
+/* read_dentry_by_name that also finds the device files */
+extern int32_t lookup_file(const uint8_t* filename, dentry_t* dentry);
+
 extern int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 
+extern uint8_t* file_block_addr(uint32_t inode, uint32_t index);
+
+extern int32_t file_blocks_stable(void);
+
+/* count the mmap mappings of a file, see truncate_data */
+extern void file_map_ref(uint32_t inode);
+extern void file_map_unref(uint32_t inode);
+
 extern int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 
+extern int32_t write_data(uint32_t inode, uint32_t offset, const uint8_t* buf, uint32_t length);
+
+extern int32_t truncate_data(uint32_t inode, uint32_t length);
+
+extern int32_t create_file(const uint8_t* filename);
+
 extern void filesys_init(uint32_t ptr);
 
 extern int32_t load_program(const uint8_t* filename, uint8_t * ptr);
 
 extern void init_file_array(file_t *file_array);
 
+extern int32_t pipe_fd_open(uint32_t pipe, uint32_t end);
+
+extern void file_inherit(file_t * dst, const file_t * src);
+
+extern int32_t file_fd_inode(int32_t fd);
+
+extern int32_t file_stat(const uint8_t* filename, stat_t* st);
+
+extern int32_t file_fstat(int32_t fd, stat_t* st);
+
+extern int32_t file_type_of(const file_t* file);
+
 #endif
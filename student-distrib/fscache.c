@@ -0,0 +1,224 @@
+#include "fscache.h"
+#include "fsformat.h"
+#include "lib.h"
+#include "paging.h"
+
+#define SLOT_NONE   (-1)
+#define BLOCK_NONE  0xFFFFFFFF
+
+/* One decompressed block. Slots sit on an LRU list (most recent at the
+ * head) and, while they hold a block, on the chain of its hash bucket */
+typedef struct cache_slot_t {
+    uint32_t block;                 /* data block number, BLOCK_NONE if empty */
+    uint8_t* data;                  /* frame from the pool, NULL until first use */
+    int16_t prev, next;             /* LRU list */
+    int16_t hnext;                  /* bucket chain */
+} cache_slot_t;
+
+static cache_slot_t slots[FS_CACHE_BLOCKS];
+static int16_t buckets[FS_CACHE_BUCKETS];
+static int16_t lru_head, lru_tail;
+
+static const uint32_t* block_table;
+static const uint8_t* block_payload;
+static uint32_t block_count;
+static fscache_stats_t stats;
+
+/* lru_unlink, lru_push
+ * DESCRIPTION: take a slot off the LRU list / put it at the head
+ */
+static void lru_unlink(int16_t s) {
+    if (slots[s].prev != SLOT_NONE)
+        slots[slots[s].prev].next = slots[s].next;
+    else
+        lru_head = slots[s].next;
+    if (slots[s].next != SLOT_NONE)
+        slots[slots[s].next].prev = slots[s].prev;
+    else
+        lru_tail = slots[s].prev;
+}
+
+static void lru_push(int16_t s) {
+    slots[s].prev = SLOT_NONE;
+    slots[s].next = lru_head;
+    if (lru_head != SLOT_NONE)
+        slots[lru_head].prev = s;
+    lru_head = s;
+    if (lru_tail == SLOT_NONE)
+        lru_tail = s;
+}
+
+/* bucket_remove
+ * DESCRIPTION: takes a slot off the chain of the bucket of its block
+ * INPUTS: s -- slot holding a block
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+static void bucket_remove(int16_t s) {
+    int16_t* link = &buckets[slots[s].block & (FS_CACHE_BUCKETS - 1)];
+
+    while (*link != SLOT_NONE && *link != s)
+        link = &slots[*link].hnext;
+    if (*link == s)
+        *link = slots[s].hnext;
+}
+
+/* fscache_init
+ * DESCRIPTION: empties the cache and points it at a compressed image.
+ *              Frames for the slots are taken on first use
+ * INPUTS: table -- data_count + 1 payload offsets, payload, data_count
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: resets the counters
+ */
+void fscache_init(const uint32_t* table, const uint8_t* payload, uint32_t data_count) {
+    int16_t s;
+
+    block_table = table;
+    block_payload = payload;
+    block_count = data_count;
+    memset(&stats, 0, sizeof(stats));
+
+    for (s = 0; s < FS_CACHE_BUCKETS; s++)
+        buckets[s] = SLOT_NONE;
+    lru_head = lru_tail = SLOT_NONE;
+    for (s = 0; s < FS_CACHE_BLOCKS; s++) {
+        slots[s].block = BLOCK_NONE;
+        slots[s].hnext = SLOT_NONE;
+        lru_push(s);
+    }
+}
+
+/* fscache_block
+ * DESCRIPTION: finds the contents of a data block. Blocks stored raw are
+ *              served in place; others come from the cache, decompressing
+ *              into the least recently used slot on a miss
+ * INPUTS: num -- data block number
+ * OUTPUTS: none
+ * RETURN VALUE: the 4KB block, NULL if num is out of range or the block is
+ *               corrupt or no frame is left for the cache
+ * SIDE EFFECTS: may evict another block
+ */
+uint8_t* fscache_block(uint32_t num) {
+    uint32_t start, len;
+    int16_t s;
+
+    if (num >= block_count)
+        return NULL;
+    start = block_table[num];
+    if (block_table[num + 1] < start || (len = block_table[num + 1] - start) > FS_BLOCK_SIZE) {
+        stats.errors++;
+        return NULL;
+    }
+    if (len == FS_BLOCK_SIZE) {
+        stats.raw++;
+        return (uint8_t*)block_payload + start;
+    }
+
+    for (s = buckets[num & (FS_CACHE_BUCKETS - 1)]; s != SLOT_NONE; s = slots[s].hnext) {
+        if (slots[s].block == num) {
+            stats.hits++;
+            lru_unlink(s);
+            lru_push(s);
+            return slots[s].data;
+        }
+    }
+
+    /* miss, reuse the least recently used slot */
+    s = lru_tail;
+    if (slots[s].data == NULL && (slots[s].data = (uint8_t*)frame_alloc()) == NULL)
+        return NULL;
+    if (slots[s].block != BLOCK_NONE) {
+        bucket_remove(s);
+        slots[s].block = BLOCK_NONE;
+    }
+    if (lz4_decompress(block_payload + start, len, slots[s].data, FS_BLOCK_SIZE) != FS_BLOCK_SIZE) {
+        stats.errors++;
+        return NULL;
+    }
+    stats.misses++;
+
+    slots[s].block = num;
+    slots[s].hnext = buckets[num & (FS_CACHE_BUCKETS - 1)];
+    buckets[num & (FS_CACHE_BUCKETS - 1)] = s;
+    lru_unlink(s);
+    lru_push(s);
+    return slots[s].data;
+}
+
+/* fscache_get_stats
+ * DESCRIPTION: copies the counters
+ * INPUTS: out -- where to put them
+ * OUTPUTS: *out
+ * RETURN VALUE: none
+ */
+void fscache_get_stats(fscache_stats_t* out) {
+    *out = stats;
+}
+
+/* lz4_decompress
+ * DESCRIPTION: decodes an LZ4 block: sequences of a token (literal count
+ *              high nibble, match length - 4 low nibble, 15 meaning more
+ *              bytes follow), the literals, then a 2-byte little-endian
+ *              offset back into the output. The last sequence has only
+ *              literals
+ * INPUTS: src, src_len, dst, dst_cap
+ * OUTPUTS: decoded bytes in dst
+ * RETURN VALUE: bytes decoded, -1 if src is malformed or dst too small
+ */
+int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_cap;
+    const uint8_t* match;
+    uint32_t token, len, offset, b;
+
+    while (ip < iend) {
+        token = *ip++;
+
+        /* literals */
+        len = token >> 4;
+        if (len == 15) {
+            do {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        if (len > (uint32_t)(iend - ip) || len > (uint32_t)(oend - op))
+            return -1;
+        memcpy(op, ip, len);
+        ip += len;
+        op += len;
+        if (ip == iend)
+            break;
+
+        /* match */
+        if (iend - ip < 2)
+            return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst))
+            return -1;
+        len = token & 0xF;
+        if (len == 15) {
+            do {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                len += b;
+            } while (b == 255);
+        }
+        len += 4;
+        if (len > (uint32_t)(oend - op))
+            return -1;
+
+        /* byte by byte, the match may overlap what it produces */
+        match = op - offset;
+        while (len--)
+            *op++ = *match++;
+    }
+    return op - dst;
+}
@@ -0,0 +1,30 @@
+#ifndef FSCACHE_H_
+#define FSCACHE_H_
+
+#include "types.h"
+
+#define FS_CACHE_BLOCKS     64      /* decompressed 4KB blocks kept at once */
+#define FS_CACHE_BUCKETS    128     /* hash buckets over block numbers, power of 2 */
+
+/* counters for benchmarks, since fscache_init */
+typedef struct fscache_stats_t {
+    uint32_t hits;                  /* found decompressed in the cache */
+    uint32_t misses;                /* decompressed on the way */
+    uint32_t raw;                   /* stored uncompressed, served in place */
+    uint32_t errors;                /* bad table entry or corrupt block */
+} fscache_stats_t;
+
+/* serve the data blocks of a FS_FEAT_COMPRESSED image: table holds
+ * data_count + 1 payload offsets, block n is payload[table[n]..table[n+1]) */
+extern void fscache_init(const uint32_t* table, const uint8_t* payload, uint32_t data_count);
+/* the 4KB contents of data block num, NULL if out of range or corrupt.
+ * Unless the block is stored raw the pointer is only good until the next
+ * call, so use it with interrupts off */
+extern uint8_t* fscache_block(uint32_t num);
+extern void fscache_get_stats(fscache_stats_t* stats);
+
+/* decodes one LZ4 block (no frame header), -1 if it is malformed or does
+ * not fit in dst_cap bytes */
+extern int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap);
+
+#endif
@@ -0,0 +1,61 @@
+/* fsformat.h - On-disk layout of the file system image, shared by the
+ * kernel (filesys.c) and the host image builder (mkfs/mkfs391.c). Only
+ * plain defines here, the host side has no types.h.
+ */
+#ifndef FSFORMAT_H_
+#define FSFORMAT_H_
+
+#define FS_BLOCK_SIZE       4096
+#define FS_NAME_LEN         32
+#define FS_BOOT_DENTRIES    63          /* dentries in the boot block */
+
+/* An image made by mkfs391 stores FS_MAGIC and a feature mask in the first
+ * reserved words of the boot block (offsets 12 and 16). Images from the
+ * original createfs have zeros there and use none of the features */
+#define FS_MAGIC            0x46313933  /* "391F" */
+#define FS_MAGIC_OFFSET     12
+#define FS_FEATURES_OFFSET  16
+
+/* FS_FEAT_INDIRECT: the last two block numbers of an inode point to a
+ * single indirect block (FS_PTRS_PER_BLOCK data block numbers) and a double
+ * indirect block (FS_PTRS_PER_BLOCK single indirect block numbers) */
+#define FS_FEAT_INDIRECT    0x1
+
+/* FS_FEAT_DIRHASH: the directory lives in data blocks rather than in the
+ * boot block, so it is not limited to 63 entries. The boot block word at
+ * FS_DIR_BLOCK_OFFSET is the first of the consecutive data blocks with
+ * room for hash_size / 2 dentries, FS_DENTRIES_PER_BLOCK per block; the
+ * first dir_count are in use, in order. The word at
+ * FS_HASH_BLOCK_OFFSET is the first block of a hash table with the slot
+ * count at FS_HASH_SIZE_OFFSET (a power of two, at least twice dir_count).
+ * A slot holds a dentry index plus one, 0 when empty; a name hashes with
+ * 32-bit FNV-1a over at most FS_NAME_LEN bytes and collisions move on to
+ * the next slot. The builder also copies the first 63 entries into the
+ * boot block */
+#define FS_FEAT_DIRHASH         0x2
+#define FS_DIR_BLOCK_OFFSET     20
+#define FS_HASH_BLOCK_OFFSET    24
+#define FS_HASH_SIZE_OFFSET     28
+#define FS_DENTRY_SIZE          64
+#define FS_DENTRIES_PER_BLOCK   64
+#define FS_HASH_PER_BLOCK       1024
+#define FS_MAX_DENTRIES         65536
+#define FS_FNV_BASIS            2166136261u
+#define FS_FNV_PRIME            16777619u
+
+/* FS_FEAT_COMPRESSED: boot block and inodes are as usual, but the data
+ * blocks are packed. Right after the inodes comes a table of data_count + 1
+ * byte offsets (padded to whole blocks), then the payload: data block n is
+ * payload[table[n]..table[n+1]). A block of exactly FS_BLOCK_SIZE bytes is
+ * stored raw, anything shorter is one LZ4 block (no frame) that decodes to
+ * FS_BLOCK_SIZE bytes. The blocks of a hashed directory are always raw.
+ * Such an image is read-only */
+#define FS_FEAT_COMPRESSED      0x4
+
+#define FS_PTRS_PER_BLOCK   1024        /* block numbers in one 4KB block */
+#define FS_INODE_PTRS       1023        /* block numbers after the length */
+#define FS_DIRECT_PTRS      1021        /* direct ones with FS_FEAT_INDIRECT */
+#define FS_SINGLE_INDIRECT  1021        /* inode slot of the single indirect block */
+#define FS_DOUBLE_INDIRECT  1022        /* inode slot of the double indirect block */
+
+#endif
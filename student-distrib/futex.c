@@ -0,0 +1,75 @@
+#include "futex.h"
+#include "syscalls.h"
+#include "scheduler.h"
+#include "paging.h"
+
+/* Sleeping tasks hang off the bucket of their word's physical address, so
+ * threads and processes mapping the same memory meet in the same queue */
+static wait_queue_t futex_table[FUTEX_HASH_SIZE];
+
+/* futex_key
+ * DESCRIPTION: translates a user word to the key the wait queues use
+ * INPUTS: addr -- user virtual address of the word
+ * OUTPUTS: none
+ * RETURN VALUE: physical address of the word, 0 if it is not a mapped,
+                 aligned user word
+ * SIDE EFFECTS: none
+ */
+static uint32_t futex_key(int32_t* addr) {
+    if ((uint32_t)addr & (C_4B - 1))
+        return 0;
+    return paging_virt_to_phys(getCurrentProcessPCB()->page_dir, (uint32_t)addr);
+}
+
+/* futex_bucket
+ * DESCRIPTION: hashes a key into futex_table
+ * INPUTS: key -- physical address of the word
+ * OUTPUTS: none
+ * RETURN VALUE: wait queue of the bucket
+ * SIDE EFFECTS: none
+ */
+static wait_queue_t* futex_bucket(uint32_t key) {
+    /* words are aligned, drop the low bits and fold the page number in */
+    return &futex_table[((key >> 2) ^ (key >> BITS_4KB_ALIGN)) & (FUTEX_HASH_SIZE - 1)];
+}
+
+/* futex_wait
+ * DESCRIPTION: system call for futex wait. Blocks the caller if the word at
+                addr still holds expected; the check and the sleep happen
+                with interrupts off so a wake in between cannot be lost
+ * INPUTS: addr -- user word, expected -- value the caller saw
+ * OUTPUTS: none
+ * RETURN VALUE: 0 after being woken, -1 if the word changed or addr is bad
+ * SIDE EFFECTS: may block the caller
+ */
+int32_t futex_wait(int32_t* addr, int32_t expected) {
+    uint32_t flags;
+    uint32_t key = futex_key(addr);
+
+    if (key == 0)
+        return -1;
+
+    cli_and_save(flags);
+    if (*addr != expected) {
+        restore_flags(flags);
+        return -1;
+    }
+    wait_queue_sleep(futex_bucket(key), key);
+    restore_flags(flags);
+    return 0;
+}
+
+/* futex_wake
+ * DESCRIPTION: system call for futex wake, wakes tasks sleeping on addr
+ * INPUTS: addr -- user word, n -- most tasks to wake
+ * OUTPUTS: none
+ * RETURN VALUE: number of tasks woken, -1 if addr is bad
+ * SIDE EFFECTS: woken tasks run on a later schedule
+ */
+int32_t futex_wake(int32_t* addr, int32_t n) {
+    uint32_t key = futex_key(addr);
+
+    if (key == 0 || n < 0)
+        return -1;
+    return wait_queue_wake(futex_bucket(key), key, n);
+}
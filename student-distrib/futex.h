@@ -0,0 +1,13 @@
+#ifndef FUTEX_H_
+#define FUTEX_H_
+
+#include "types.h"
+
+#define FUTEX_HASH_SIZE 64      /* buckets in the wait queue table, power of 2 */
+
+/* sleeps while *addr == expected, until futex_wake on the same word */
+extern int32_t futex_wait(int32_t* addr, int32_t expected);
+/* wakes up to n tasks sleeping on addr */
+extern int32_t futex_wake(int32_t* addr, int32_t n);
+
+#endif
@@ -0,0 +1,134 @@
+#include "heap.h"
+#include "syscalls.h"
+#include "paging.h"
+#include "trace.h"
+
+/* heap_page_up
+ * DESCRIPTION: rounds an address up to a page boundary
+ * INPUTS: addr
+ * OUTPUTS: none
+ * RETURN VALUE: first page boundary at or above addr
+ * SIDE EFFECTS: none
+ */
+static uint32_t heap_page_up(uint32_t addr) {
+    return (addr + PAGE_SIZE - 1) & PAGE_ADDR_MASK;
+}
+
+/* heap_set_brk
+ * DESCRIPTION: moves the break of a process. Growing only moves the
+                break, frames are attached on first touch by
+                page_fault_resolve. Shrinking frees the pages past the
+                new break right away
+ * INPUTS: owner -- PCB of the process, new_brk -- new end of the heap
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if new_brk is outside the heap region
+ * SIDE EFFECTS: none
+ */
+static int32_t heap_set_brk(pcb_t* owner, uint32_t new_brk) {
+    uint32_t page;
+
+    if (new_brk < HEAP_START || new_brk > HEAP_END)
+        return -1;
+
+    for (page = heap_page_up(new_brk); page < heap_page_up(owner->heap_brk); page += PAGE_SIZE)
+        frame_free(paging_unmap_page(owner->page_dir, page));
+    owner->heap_brk = new_brk;
+    return 0;
+}
+
+/* brk
+ * DESCRIPTION: system call for brk, sets the end of the caller's heap
+ * INPUTS: addr -- new end, between HEAP_START and HEAP_END
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: may free heap pages
+ */
+int32_t brk(void* addr) {
+    uint32_t flags;
+    int32_t ret;
+
+    cli_and_save(flags);
+    ret = heap_set_brk(getProcessPCB(getCurrentProcessPCB()->owner), (uint32_t)addr);
+    restore_flags(flags);
+    return ret;
+}
+
+/* sbrk
+ * DESCRIPTION: system call for sbrk, grows (or shrinks) the caller's heap
+ * INPUTS: increment -- bytes to add to the heap, may be negative
+ * OUTPUTS: none
+ * RETURN VALUE: the old end of the heap (start of the new memory), -1 if
+ *               the heap cannot grow that far
+ * SIDE EFFECTS: may free heap pages
+ */
+int32_t sbrk(int32_t increment) {
+    pcb_t* owner;
+    uint32_t flags;
+    uint32_t old_brk;
+
+    cli_and_save(flags);
+    owner = getProcessPCB(getCurrentProcessPCB()->owner);
+    old_brk = owner->heap_brk;
+    if ((increment > 0 && (uint32_t)increment > HEAP_END - old_brk) ||
+        (increment < 0 && (uint32_t)-increment > old_brk - HEAP_START) ||
+        heap_set_brk(owner, old_brk + increment) == -1) {
+        restore_flags(flags);
+        return -1;
+    }
+    restore_flags(flags);
+    return old_brk;
+}
+
+/* heap_init_process
+ * DESCRIPTION: gives a new process an empty heap
+ * INPUTS: pcb -- new process
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void heap_init_process(pcb_t* pcb) {
+    pcb->heap_brk = HEAP_START;
+}
+
+/* heap_exit
+ * DESCRIPTION: frees every heap page of a process
+ * INPUTS: pcb -- process that is going away (not a thread)
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void heap_exit(pcb_t* pcb) {
+    heap_set_brk(pcb, HEAP_START);
+}
+
+/* page_fault_resolve
+ * DESCRIPTION: called by the page fault stub. A fault on a page that is
+                not present below the break of the running process gets
+                a zeroed frame, whether user code or a system call
+                touched it first
+ * INPUTS: error -- error code pushed by the CPU
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the access can be restarted, -1 for a real fault
+ * SIDE EFFECTS: maps a heap page
+ */
+int32_t page_fault_resolve(uint32_t error) {
+    pcb_t* owner;
+    uint32_t addr, frame;
+
+    asm volatile("movl %%cr2, %0" : "=r"(addr));
+    trace_event(TRACE_PAGE_FAULT, addr);
+
+    if (curr_process == PID_NONE || (error & PF_PRESENT))
+        return -1;
+    owner = getProcessPCB(getProcessPCB(curr_process)->owner);
+    if (addr < HEAP_START || addr >= owner->heap_brk)
+        return -1;
+
+    if ((frame = frame_alloc()) == 0)
+        return -1;
+    if (paging_map_page(owner->page_dir, addr & PAGE_ADDR_MASK, frame, USER_PTE_RW) == -1) {
+        frame_free(frame);
+        return -1;
+    }
+    return 0;
+}
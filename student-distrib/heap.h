@@ -0,0 +1,25 @@
+#ifndef HEAP_H_
+#define HEAP_H_
+
+#include "types.h"
+#include "pcb.h"
+
+#define HEAP_START  0x08800000  /* first page above the vidmap page */
+#define HEAP_END    0x0C000000  /* 192MB, where shared memory starts */
+
+/* page fault error code bits */
+#define PF_PRESENT  0x1         /* protection fault on a present page */
+
+/* brk system call: moves the end of the heap to addr */
+extern int32_t brk(void* addr);
+/* sbrk system call: moves the end of the heap by increment bytes */
+extern int32_t sbrk(int32_t increment);
+
+/* starts a new process with an empty heap */
+extern void heap_init_process(pcb_t* pcb);
+/* frees the heap of a process that is going away */
+extern void heap_exit(pcb_t* pcb);
+/* called on page faults, backs heap pages on first touch */
+extern int32_t page_fault_resolve(uint32_t error);
+
+#endif
@@ -9,6 +9,22 @@
 uint8_t master_mask = PIC_IRQ_MASK; /* IRQs 0-7  */
 uint8_t slave_mask = PIC_IRQ_MASK;  /* IRQs 8-15 */
 
+/* Interrupts taken on each line, the cycles their handlers ran for and
+ * the longest single run, kept by irq_enter and irq_exit */
+uint32_t irq_counts[NUM_IRQ_LINES];
+uint64_t irq_cycles[NUM_IRQ_LINES];
+uint32_t irq_max_cycles[NUM_IRQ_LINES];
+static uint64_t irq_start[NUM_IRQ_LINES];
+
+/* Longest section between a cli_and_save that masked interrupts and the
+ * restore_flags that unmasked them, and where it began */
+uint32_t irqoff_max_cycles;
+const int8_t* irqoff_max_file;
+uint32_t irqoff_max_line;
+static uint64_t irqoff_start;		/* 0 while interrupts are not masked */
+static const int8_t* irqoff_file;
+static uint32_t irqoff_line;
+
 
 /* i8259_init()
  * DESCRIPTION: Initializes master and slave PICs on the 8259 chips by
@@ -145,4 +161,92 @@ void send_eoi(uint32_t irq_num) {
 	}
 }
 
+/* irq_enter()
+ * DESCRIPTION: counts an interrupt and starts timing its handler, called
+ 				by the stubs in interr.S as they come in
+ * INPUTS: irq_num - line that fired
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void irq_enter(uint32_t irq_num) {
+	irq_counts[irq_num]++;
+	rdtsc(irq_start[irq_num]);
+}
+
+/* irq_exit()
+ * DESCRIPTION: charges the cycles since irq_enter to the line. The PIT
+ 				calls it before it schedules, so a switch to another task
+ 				is not counted as handler time
+ * INPUTS: irq_num - line that fired
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void irq_exit(uint32_t irq_num) {
+	uint64_t now, cycles;
+
+	rdtsc(now);
+	cycles = now - irq_start[irq_num];
+	irq_cycles[irq_num] += cycles;
+	if (cycles > irq_max_cycles[irq_num])
+		irq_max_cycles[irq_num] = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : cycles;
+}
+
+/* irq_avg_cycles()
+ * DESCRIPTION: average handler run of a line
+ * INPUTS: irq_num - line
+ * OUTPUTS: none
+ * RETURN VALUE: cycles, 0 if it never fired
+ * SIDE EFFECTS: none
+ */
+uint32_t irq_avg_cycles(uint32_t irq_num) {
+	uint32_t avg, rem, flags;
+	uint64_t total;
+
+	cli_and_save(flags);
+	total = irq_cycles[irq_num];
+	avg = irq_counts[irq_num];
+	restore_flags(flags);
+	if (avg == 0)
+		return 0;
+	/* every run is under 2^32 cycles, so the quotient fits in divl */
+	asm ("divl %3" : "=a"(avg), "=d"(rem) : "A"(total), "rm"(avg));
+	return avg;
+}
 
+/* irqoff_begin()
+ * DESCRIPTION: cli_and_save just masked interrupts, start timing
+ * INPUTS: file, line - of the cli_and_save
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void irqoff_begin(const int8_t* file, uint32_t line) {
+	rdtsc(irqoff_start);
+	irqoff_file = file;
+	irqoff_line = line;
+}
+
+/* irqoff_end()
+ * DESCRIPTION: restore_flags is about to unmask interrupts, keep the
+ 				section if it is the longest so far
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void irqoff_end(void) {
+	uint64_t now, cycles;
+
+	if (irqoff_start == 0)
+		return;
+	rdtsc(now);
+	cycles = now - irqoff_start;
+	irqoff_start = 0;
+	if (cycles > irqoff_max_cycles) {
+		irqoff_max_cycles = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : cycles;
+		irqoff_max_file = irqoff_file;
+		irqoff_max_line = irqoff_line;
+	}
+}
@@ -27,6 +27,7 @@
 #define SLAVE_8259_DATA_PORT	0xA1
 #define NUM_IRQ					0X0F
 #define PIC_IRQ_MASK 			0xFF
+#define NUM_IRQ_LINES			16
 /* ==================================================== */
 
 /* End-of-interrupt byte.  This gets OR'd with
@@ -34,6 +35,17 @@
  * to declare the interrupt finished */
 #define EOI                 0x60
 
+/* Interrupts taken on each line since boot, the cycles spent in their
+ * handlers and the longest handler run */
+extern uint32_t irq_counts[NUM_IRQ_LINES];
+extern uint64_t irq_cycles[NUM_IRQ_LINES];
+extern uint32_t irq_max_cycles[NUM_IRQ_LINES];
+
+/* Longest time cli_and_save kept interrupts masked, and where */
+extern uint32_t irqoff_max_cycles;
+extern const int8_t* irqoff_max_file;
+extern uint32_t irqoff_max_line;
+
 /* Externally-visible functions */
 
 /* Initialize both PICs */
@@ -44,5 +56,10 @@ void enable_irq(uint32_t irq_num);
 void disable_irq(uint32_t irq_num);
 /* Send end-of-interrupt signal for the specified IRQ */
 void send_eoi(uint32_t irq_num);
+/* Count an interrupt and time its handler, see interr.S */
+void irq_enter(uint32_t irq_num);
+void irq_exit(uint32_t irq_num);
+/* Average cycles of a handler run */
+uint32_t irq_avg_cycles(uint32_t irq_num);
 
 #endif /* _I8259_H */
@@ -1,8 +1,10 @@
 #include "idt.h"
 #include "lib.h"
 #include "x86_desc.h"
+#include "trace.h"
 
 #define num_interrupt 0x20 /* 32 defined IDT entries*/
+#define VEC_GENERIC 0xFF   /* generic_error serves many vectors, traced as this */
 
 /*
  * stop
@@ -10,10 +12,12 @@
  *   INPUTS: none
  *   OUTPUT: none
  *   RETURN VALUE: none
- *   SIDE EFFECTS: turning off interrupts and not returning back into the function
+ *   SIDE EFFECTS: turning off interrupts and not returning back into the function,
+ *                 sends what is left of the trace to COM1
  */
 void stop(void){
     cli();                                /* turn off interrupts */
+    trace_dump();                         /* the events leading up to this */
     while(1);                             /* keep spinning, make everything stop */
 }
 
@@ -40,7 +44,7 @@ void init_idt(void){
     SET_IDT_ENTRY(idt[11], &segment_not_present);    //IDT 11
     SET_IDT_ENTRY(idt[12], &stack_segment);          //IDT 12
     SET_IDT_ENTRY(idt[13], &general_protection);     //IDT 13
-    SET_IDT_ENTRY(idt[14], &page_fault);             //IDT 14
+    SET_IDT_ENTRY(idt[14], &page_fault_handler);     //IDT 14: heap pages, else page_fault
     SET_IDT_ENTRY(idt[15], &generic_error);          //IDT 15: Reserved
     SET_IDT_ENTRY(idt[16], &fp);                     //IDT 16
     SET_IDT_ENTRY(idt[17], &alignment_check);        //IDT 17
@@ -65,6 +69,7 @@ void init_idt(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void divide_error(void){
+    trace_event(TRACE_EXCEPTION, 0);
     blue_screen();
     printf("Division by 0");
     stop();
@@ -79,6 +84,7 @@ void divide_error(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void debug(void){
+    trace_event(TRACE_EXCEPTION, 1);
     blue_screen();
     printf("Debug Exception");
     stop();
@@ -93,6 +99,7 @@ void debug(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void nmi(void){
+    trace_event(TRACE_EXCEPTION, 2);
     blue_screen();
     printf("Non-Maskable Interrupt");
     stop();
@@ -107,6 +114,7 @@ void nmi(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void breakpoint(void){
+    trace_event(TRACE_EXCEPTION, 3);
     blue_screen();
     printf("Breakpoint (INT3)");
     stop();
@@ -121,6 +129,7 @@ void breakpoint(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void overflow(void){
+    trace_event(TRACE_EXCEPTION, 4);
     blue_screen();
     printf("Overflow with EFLAGS[OF] Set");
     stop();
@@ -135,6 +144,7 @@ void overflow(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void bounds(void){
+    trace_event(TRACE_EXCEPTION, 5);
     blue_screen();
     printf("Debug Exception");
     stop();
@@ -149,6 +159,7 @@ void bounds(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void invalid_op(void){
+    trace_event(TRACE_EXCEPTION, 6);
     blue_screen();
     printf("Invalid Opcode");
     stop();
@@ -163,6 +174,7 @@ void invalid_op(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void device_not_available(void){
+    trace_event(TRACE_EXCEPTION, 7);
     blue_screen();
     printf("Floating Point Unit Missing");
     stop();
@@ -177,6 +189,7 @@ void device_not_available(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void double_fault(void){
+    trace_event(TRACE_EXCEPTION, 8);
     blue_screen();
     printf("Double Fault");
     stop();
@@ -191,6 +204,7 @@ void double_fault(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void segment_overrun(void){
+    trace_event(TRACE_EXCEPTION, 9);
     blue_screen();
     printf("Coprocessor Segment Overrun");
     stop();
@@ -205,6 +219,7 @@ void segment_overrun(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void invalid_TSS(void){
+    trace_event(TRACE_EXCEPTION, 10);
     blue_screen();
     printf("Invalid TSS");
     stop();
@@ -219,6 +234,7 @@ void invalid_TSS(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void segment_not_present(void){
+    trace_event(TRACE_EXCEPTION, 11);
     blue_screen();
     printf("Segment Not Present");
     stop();
@@ -233,6 +249,7 @@ void segment_not_present(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void stack_segment(void){
+    trace_event(TRACE_EXCEPTION, 12);
     blue_screen();
     printf("Stack Exception");
     stop();
@@ -247,6 +264,7 @@ void stack_segment(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void general_protection(void){
+    trace_event(TRACE_EXCEPTION, 13);
     blue_screen();
     printf("General Protection Exception");
     stop();
@@ -261,6 +279,7 @@ void general_protection(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void page_fault(void){
+    trace_event(TRACE_EXCEPTION, 14);
     blue_screen();
     printf("Page Fault");
     stop();
@@ -275,6 +294,7 @@ void page_fault(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void generic_error(void){
+    trace_event(TRACE_EXCEPTION, VEC_GENERIC);
     blue_screen();
     printf("Undefined Exception");
     stop();
@@ -289,6 +309,7 @@ void generic_error(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void fp(void){
+    trace_event(TRACE_EXCEPTION, 16);
     blue_screen();
     printf("Floating Point Error");
     stop();
@@ -303,6 +324,7 @@ void fp(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void alignment_check(void){
+    trace_event(TRACE_EXCEPTION, 17);
     blue_screen();
     printf("Alignment Check");
     stop();
@@ -317,6 +339,7 @@ void alignment_check(void){
  *   SIDE EFFECTS: calls blue_screen to kernel panic and stop
  */
 void machine_check(void){
+    trace_event(TRACE_EXCEPTION, 18);
     blue_screen();
     printf("Machine Check Exception");
     stop();
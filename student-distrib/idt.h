@@ -19,6 +19,8 @@ void segment_not_present(void);
 void stack_segment(void);
 void general_protection(void);
 void page_fault(void);
+/* asm stub in interr.S in front of page_fault */
+extern void page_fault_handler(void);
 void generic_error(void);
 void fp(void);
 void alignment_check(void);
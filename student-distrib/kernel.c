@@ -13,8 +13,15 @@
 #include "paging.h"
 #include "rtc.h"
 #include "idt.h"
+#include "pit.h"
 //#include "filesys.h"
 #include "syscalls.h"
+#include "perf.h"
+#include "serial.h"
+#include "trace.h"
+#include "profile.h"
+#include "klog.h"
+#include "cpu.h"
 //#include "interr.h"
 extern void system_call_handler(void);
 
@@ -26,16 +33,23 @@ extern void system_call_handler(void);
 #define CHECK_FLAG(flags, bit)   ((flags) & (1 << (bit)))
 
 uint32_t bootBlock_addr;
+uint32_t bootBlock_end;
 
 /* Check if MAGIC is valid and print the Multiboot information structure
    pointed by ADDR. */
 void entry(unsigned long magic, unsigned long addr) {
 
     multiboot_info_t *mbi;
+    uint64_t boot_start, boot_end;
+
+    rdtsc(boot_start);
 
     /* Clear the screen. */
     clear();
 
+    /* COM1 polls until its IRQ is set up, so "serial" mirrors the whole boot */
+    serial_init();
+
     /* Am I booted by a Multiboot-compliant boot loader? */
     if (magic != MULTIBOOT_BOOTLOADER_MAGIC) {
         printf("Invalid magic number: 0x%#x\n", (unsigned)magic);
@@ -45,6 +59,14 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Set MBI to the address of the Multiboot information structure. */
     mbi = (multiboot_info_t *) addr;
 
+    /* "quiet" before anything is printed: the boot messages only go to
+     * the kernel log, dmesg shows them */
+    if (CHECK_FLAG(mbi->flags, 2) && cmdline_has((int8_t *)mbi->cmdline, "quiet"))
+        klog_quiet = 1;
+
+    /* pick the memory routines for this CPU before the bulk copies start */
+    cpu_init();
+
     /* Print out the flags. */
     printf("flags = 0x%#x\n", (unsigned)mbi->flags);
 
@@ -57,8 +79,16 @@ void entry(unsigned long magic, unsigned long addr) {
         printf("boot_device = 0x%#x\n", (unsigned)mbi->boot_device);
 
     /* Is the command line passed? */
-    if (CHECK_FLAG(mbi->flags, 2))
+    if (CHECK_FLAG(mbi->flags, 2)) {
+        if (cmdline_has((int8_t *)mbi->cmdline, "serial"))
+            serial_mirror = 1;
+        if (cmdline_has((int8_t *)mbi->cmdline, "trace"))
+            trace_on = 1;
+        if (cmdline_has((int8_t *)mbi->cmdline, "profile"))
+            profile_start();
+        perf_init((int8_t *)mbi->cmdline);
         printf("cmdline = %s\n", (char *)mbi->cmdline);
+    }
 
     if (CHECK_FLAG(mbi->flags, 3)) {
         int mod_count = 0;
@@ -67,6 +97,7 @@ void entry(unsigned long magic, unsigned long addr) {
         while (mod_count < mbi->mods_count) {
             printf("Module %d loaded at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_start);
             bootBlock_addr = mod->mod_start; //load filesys starting addr
+            bootBlock_end = mod->mod_end;
             printf("Module %d ends at address: 0x%#x\n", mod_count, (unsigned int)mod->mod_end);
             printf("First few bytes of module:\n");
             for (i = 0; i < 16; i++) {
@@ -167,6 +198,8 @@ void entry(unsigned long magic, unsigned long addr) {
     /* Set up interrupt handlers */
     SET_IDT_ENTRY(idt[0x28], &rtc_handler);            /* RTC entry is 0x28 */
     SET_IDT_ENTRY(idt[0x21], &key_handler);            /* Keyboard entry at 0x21 */
+    SET_IDT_ENTRY(idt[0x20], &pit_handler);            /* PIT entry at 0x20 */
+    SET_IDT_ENTRY(idt[0x24], &serial_handler);         /* COM1 entry at 0x24 */
 
     /* system trap in the IDT */
     // idt_desc_t trap = idt[SYSTEM_TRAP];
@@ -178,13 +211,20 @@ void entry(unsigned long magic, unsigned long addr) {
     rtc_init();
     enable_irq(1); 
     enable_irq(8);      // Enable IRQ interrupts
+    enable_irq(SERIAL_IRQ);
     
 
     /* Start up paging, see function for details */
-    paging_init();
+    if (paging_init(bootBlock_end) != 0) {
+        printf("File system image ends at 0x%#x, too high to map, not mounted\n", bootBlock_end);
+        bootBlock_addr = 0;
+    }
+    if (CHECK_FLAG(mbi->flags, 0))
+        frame_pool_limit((mbi->mem_upper + 1024) * 1024);   /* mem_upper counts KB from 1MB */
 
     /* Init file system */
-    filesys_init(bootBlock_addr);
+    if (bootBlock_addr != 0)
+        filesys_init(bootBlock_addr);
 
     /* Enable interrupts */
     /* Do not enable the following until after you have set up your
@@ -200,13 +240,30 @@ void entry(unsigned long magic, unsigned long addr) {
     //enable_irq(1);
     //sti();                      /* enable interrupts */
 #endif
+    if (perf_enabled())
+        perf_kernel_bench();
+
+    rdtsc(boot_end);
+    printf("Boot took %u Kcycles\n", (uint32_t)((boot_end - boot_start) >> 10));
+    klog_quiet = 0;
+
+    /* Start preempting, the boot context becomes the idle loop */
+    pit_init();
+
    /* Execute the first program ("shell") ... */
     //terminal(); /* fake shell */
     while(1)
     {
-        execute((uint8_t*)"shell  1  2  3  4  5  6");
+        /* slot 0 belongs to the root shell, restart it when it exits */
+        if (pid_array[0] == PROG_NOT_ACTIVE) {
+            uint8_t command[] = "shell";
+            if (perf_enabled())
+                perf_root();
+            else
+                spawn_process(command);
+        }
+
+        /* Spin (nicely, so we don't chew up cycles) */
+        asm volatile ("hlt");
     }
-    
-    /* Spin (nicely, so we don't chew up cycles) */
-    asm volatile (".1: hlt; jmp .1;");
 }
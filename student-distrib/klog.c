@@ -0,0 +1,89 @@
+#include "klog.h"
+#include "lib.h"
+#include "syscalls.h"
+
+/* head counts every byte ever logged; the ring keeps the last KLOG_SIZE
+ * of them, so byte i is at klog_ring[i % KLOG_SIZE] while
+ * head - KLOG_SIZE <= i < head */
+int32_t klog_quiet = 0;
+static int8_t klog_ring[KLOG_SIZE];
+static uint32_t klog_head;
+
+/* klog_append
+ * DESCRIPTION: appends to the log, dropping its oldest bytes if full
+ * INPUTS: s, n -- bytes to append
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void klog_append(const int8_t* s, uint32_t n) {
+    uint32_t flags, i;
+
+    cli_and_save(flags);
+    for (i = 0; i < n; i++)
+        klog_ring[klog_head++ % KLOG_SIZE] = s[i];
+    restore_flags(flags);
+}
+
+/* klog_open, klog_close
+ * DESCRIPTION: every opener reads the log from its oldest byte; close
+ *              gives the fd back
+ * RETURN VALUE: 0, -1 from close if fd is not open
+ */
+int32_t klog_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t klog_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* klog_text
+ * DESCRIPTION: copies the log from byte *pos, counted since boot; bytes
+ *              dropped before they were read are skipped
+ * INPUTS: pos, buf, n -- room in buf
+ * OUTPUTS: log text in buf, *pos moved past it
+ * RETURN VALUE: bytes copied, 0 once *pos caught up with the log
+ * SIDE EFFECTS: none
+ */
+uint32_t klog_text(uint32_t* pos, int8_t* buf, uint32_t n) {
+    uint32_t i, flags;
+
+    cli_and_save(flags);
+    if (klog_head > KLOG_SIZE && *pos < klog_head - KLOG_SIZE)
+        *pos = klog_head - KLOG_SIZE;
+    if (n > klog_head - *pos)
+        n = klog_head - *pos;
+    for (i = 0; i < n; i++)
+        buf[i] = klog_ring[(*pos + i) % KLOG_SIZE];
+    *pos += n;
+    restore_flags(flags);
+    return n;
+}
+
+/* klog_read
+ * DESCRIPTION: reads the log from the file position, see klog_text
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: log text in buf
+ * RETURN VALUE: bytes read, 0 once the reader caught up, -1 if buf is NULL
+ *               or nbytes negative
+ * SIDE EFFECTS: advances the file position
+ */
+int32_t klog_read(int32_t fd, void* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    uint32_t pos = file->file_position, n;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+    n = klog_text(&pos, buf, nbytes);
+    file->file_position = pos;
+    return n;
+}
+
+/* klog_write
+ * DESCRIPTION: the log is only written by the kernel
+ * RETURN VALUE: -1
+ */
+int32_t klog_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
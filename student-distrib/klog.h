@@ -0,0 +1,27 @@
+#ifndef KLOG_H_
+#define KLOG_H_
+
+#include "types.h"
+
+/* Kernel message log. Everything printf writes is also kept here, the
+ * last KLOG_SIZE bytes of it, so boot and diagnostic messages can be read
+ * back after they scrolled off the screen. The "kmsg" device file reads
+ * it from the oldest byte still kept; the dmesg program prints it.
+ * "quiet" on the multiboot command line keeps printf off the screen until
+ * the first program starts, the log still gets everything */
+#define KLOG_SIZE           16384       /* power of 2 */
+#define KLOG_FILENAME       "kmsg"      /* device file name for open */
+
+/* nonzero while printf only goes to the log (and COM1 if mirrored) */
+extern int32_t klog_quiet;
+
+extern void klog_append(const int8_t* s, uint32_t n);
+extern uint32_t klog_text(uint32_t* pos, int8_t* buf, uint32_t n);
+
+/* ops of the "kmsg" device file, see klog_ops in filesys.c */
+extern int32_t klog_open(const uint8_t* filename);
+extern int32_t klog_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t klog_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t klog_close(int32_t fd);
+
+#endif
@@ -4,6 +4,8 @@
 #include "lib.h"
 #include "rtc.h"
 #include "i8259.h"
+#include "serial.h"
+#include "klog.h"
 
 #define VIDEO       0xB8000                 /* video memory statrt location */
 #define NUM_COLS    80                      /* number of columns of terminal screen */
@@ -13,6 +15,9 @@
 #define BLUE_SCREEN_TEXT_ATTRIB 0x17        /* attribute for text for blue screen */
 #define BLUE_SCREEN_BACKGROUND_ATTRIB 0x11  /* attribute for background of blue screen */
 
+/* nonzero if one of the four bytes of dword w is 0 */
+#define HAS_ZERO_BYTE(w)    (((w) - 0x01010101) & ~(w) & 0x80808080)
+
 static int screen_x;                        /* holds the x location to putc and set cursor */
 static int screen_y;                        /* holds the y location to putc and set cursor */
 static char* video_mem = (char *)VIDEO;     /* converts the Vid Mem location to a pointer */
@@ -74,7 +79,191 @@ void blue_screen(void) {
     set_cursor(screen_x, screen_y);
 }
 
+/* Where format_to puts its output: the caller's buffer and, for printf,
+ * a way to empty it when it is full. total counts every character, also
+ * those that did not fit */
+typedef struct fmt_out_t {
+    int8_t* buf;
+    uint32_t size;
+    uint32_t len;
+    uint32_t total;
+    void (*flush)(struct fmt_out_t* out);
+} fmt_out_t;
+
+/* void fmt_putc(fmt_out_t* out, int8_t c);
+ *   Inputs: out = output, c = character
+ *   Return Value: none
+ *   Function: Appends a character, flushing a full buffer if it can */
+static void fmt_putc(fmt_out_t* out, int8_t c) {
+    if (out->len == out->size && out->flush != NULL)
+        out->flush(out);
+    if (out->len < out->size)
+        out->buf[out->len++] = c;
+    out->total++;
+}
+
+/* void fmt_field(fmt_out_t* out, const int8_t* s, int32_t width, int32_t left, int8_t pad);
+ *   Inputs: out = output, s = text of the field, width = minimum width,
+ *           left = nonzero to pad on the right, pad = ' ' or '0'
+ *   Return Value: none
+ *   Function: Appends a field; zero padding goes after a leading '-' */
+static void fmt_field(fmt_out_t* out, const int8_t* s, int32_t width, int32_t left, int8_t pad) {
+    int32_t len = strlen(s);
+
+    if (pad == '0' && *s == '-') {
+        fmt_putc(out, *s++);
+        width--;
+        len--;
+    }
+    if (!left)
+        for (; width > len; width--)
+            fmt_putc(out, pad);
+    while (*s != '\0')
+        fmt_putc(out, *s++);
+    if (left)
+        for (; width > len; width--)
+            fmt_putc(out, ' ');
+}
+
+/* void format_to(fmt_out_t* out, const int8_t* format, va_list ap);
+ *   Inputs: out = output, format = see printf, ap = its arguments
+ *   Return Value: none
+ *   Function: The formatting of printf, snprintf and vsnprintf */
+static void format_to(fmt_out_t* out, const int8_t* format, va_list ap) {
+    int8_t conv_buf[36];
+    int32_t alternate, left, width, value;
+    int8_t pad;
+    const int8_t* str;
+
+    for (; *format != '\0'; format++) {
+        if (*format != '%') {
+            fmt_putc(out, *format);
+            continue;
+        }
+
+        alternate = left = width = 0;
+        pad = ' ';
+        for (format++; ; format++) {
+            if (*format == '#')
+                alternate = 1;
+            else if (*format == '-')
+                left = 1;
+            else if (*format == '0')
+                pad = '0';
+            else
+                break;
+        }
+        for (; *format >= '0' && *format <= '9'; format++)
+            width = width * 10 + *format - '0';
+
+        /* Conversion specifiers */
+        switch (*format) {
+            /* Print a literal '%' character */
+            case '%':
+                fmt_putc(out, '%');
+                break;
+
+            /* Print a number in hexadecimal form, %#x as 8 digits */
+            case 'x':
+                itoa(va_arg(ap, uint32_t), conv_buf, 16);
+                if (alternate) {
+                    width = 8;
+                    pad = '0';
+                }
+                fmt_field(out, conv_buf, width, left, left ? ' ' : pad);
+                break;
+
+            /* Print a number in unsigned int form */
+            case 'u':
+                itoa(va_arg(ap, uint32_t), conv_buf, 10);
+                fmt_field(out, conv_buf, width, left, left ? ' ' : pad);
+                break;
+
+            /* Print a number in signed int form */
+            case 'd':
+                value = va_arg(ap, int32_t);
+                if (value < 0) {
+                    conv_buf[0] = '-';
+                    itoa(-value, &conv_buf[1], 10);
+                } else {
+                    itoa(value, conv_buf, 10);
+                }
+                fmt_field(out, conv_buf, width, left, left ? ' ' : pad);
+                break;
+
+            /* Print a single character */
+            case 'c':
+                conv_buf[0] = (int8_t)va_arg(ap, int32_t);
+                conv_buf[1] = '\0';
+                fmt_field(out, conv_buf, width, left, ' ');
+                break;
+
+            /* Print a NULL-terminated string */
+            case 's':
+                str = va_arg(ap, const int8_t*);
+                fmt_field(out, str != NULL ? str : "(null)", width, left, ' ');
+                break;
+
+            /* A '%' ending the format */
+            case '\0':
+                return;
+
+            default:
+                break;
+        }
+    }
+}
+
+/* int32_t vsnprintf(int8_t* buf, uint32_t size, const int8_t* format, va_list ap);
+ *   Inputs: buf = where the text goes, size = its size,
+ *           format = see printf, ap = the arguments
+ *   Return Value: length of the whole text; size or more means it was cut
+ *   Function: Formats into buf, always NUL terminated if size > 0 */
+int32_t vsnprintf(int8_t* buf, uint32_t size, const int8_t* format, va_list ap) {
+    fmt_out_t out;
+
+    out.buf = buf;
+    out.size = size > 0 ? size - 1 : 0;
+    out.len = 0;
+    out.total = 0;
+    out.flush = NULL;
+    format_to(&out, format, ap);
+    if (size > 0)
+        buf[out.len] = '\0';
+    return out.total;
+}
+
+/* int32_t snprintf(int8_t* buf, uint32_t size, const int8_t* format, ...);
+ *   Function: vsnprintf with the arguments in place */
+int32_t snprintf(int8_t* buf, uint32_t size, const int8_t* format, ...) {
+    va_list ap;
+    int32_t len;
+
+    va_start(ap, format);
+    len = vsnprintf(buf, size, format, ap);
+    va_end(ap);
+    return len;
+}
+
+/* void printf_flush(fmt_out_t* out);
+ *   Function: Hands what printf formatted so far to the kernel log and,
+ *             unless the boot is quiet, to the console */
+static void printf_flush(fmt_out_t* out) {
+    uint32_t i;
+
+    klog_append(out->buf, out->len);
+    if (!klog_quiet)
+        console_write(out->buf, out->len);
+    else if (serial_mirror)
+        for (i = 0; i < out->len; i++)
+            serial_putc(out->buf[i]);
+    out->len = 0;
+}
+
 /* Standard printf().
+ * Formats into a buffer on the stack and writes it to the kernel log and
+ * the console in pieces of PRINTF_BUF_SIZE, so the cursor moves once per
+ * piece rather than once per character.
  * Only supports the following format strings:
  * %%  - print a literal '%' character
  * %x  - print a number in hexadecimal
@@ -90,114 +279,25 @@ void blue_screen(void) {
  *       for the "#" modifier (this implementation doesn't add a "0x" at
  *       the beginning), but I think it's more flexible this way.
  *       Also note: %x is the only conversion specifier that can use
- *       the "#" modifier to alter output. */
+ *       the "#" modifier to alter output.
+ * A minimum field width may come before the conversion, with a '-' flag
+ * to pad on the right or a '0' flag to pad numbers with zeros: "%-8s",
+ * "%5u", "%08x". */
 int32_t printf(int8_t *format, ...) {
-
-    /* Pointer to the format string */
-    int8_t* buf = format;
-
-    /* Stack pointer for the other parameters */
-    int32_t* esp = (void *)&format;
-    esp++;
-
-    while (*buf != '\0') {
-        switch (*buf) {
-            case '%':
-                {
-                    int32_t alternate = 0;
-                    buf++;
-
-format_char_switch:
-                    /* Conversion specifiers */
-                    switch (*buf) {
-                        /* Print a literal '%' character */
-                        case '%':
-                            putc('%');
-                            break;
-
-                        /* Use alternate formatting */
-                        case '#':
-                            alternate = 1;
-                            buf++;
-                            /* Yes, I know gotos are bad.  This is the
-                             * most elegant and general way to do this,
-                             * IMHO. */
-                            goto format_char_switch;
-
-                        /* Print a number in hexadecimal form */
-                        case 'x':
-                            {
-                                int8_t conv_buf[64];
-                                if (alternate == 0) {
-                                    itoa(*((uint32_t *)esp), conv_buf, 16);
-                                    puts(conv_buf);
-                                } else {
-                                    int32_t starting_index;
-                                    int32_t i;
-                                    itoa(*((uint32_t *)esp), &conv_buf[8], 16);
-                                    i = starting_index = strlen(&conv_buf[8]);
-                                    while(i < 8) {
-                                        conv_buf[i] = '0';
-                                        i++;
-                                    }
-                                    puts(&conv_buf[starting_index]);
-                                }
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a number in unsigned int form */
-                        case 'u':
-                            {
-                                int8_t conv_buf[36];
-                                itoa(*((uint32_t *)esp), conv_buf, 10);
-                                puts(conv_buf);
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a number in signed int form */
-                        case 'd':
-                            {
-                                int8_t conv_buf[36];
-                                int32_t value = *((int32_t *)esp);
-                                if(value < 0) {
-                                    conv_buf[0] = '-';
-                                    itoa(-value, &conv_buf[1], 10);
-                                } else {
-                                    itoa(value, conv_buf, 10);
-                                }
-                                puts(conv_buf);
-                                esp++;
-                            }
-                            break;
-
-                        /* Print a single character */
-                        case 'c':
-                            putc((uint8_t) *((int32_t *)esp));
-                            esp++;
-                            break;
-
-                        /* Print a NULL-terminated string */
-                        case 's':
-                            puts(*((int8_t **)esp));
-                            esp++;
-                            break;
-
-                        default:
-                            break;
-                    }
-
-                }
-                break;
-
-            default:
-                putc(*buf);
-                break;
-        }
-        buf++;
-    }
-    return (buf - format);
+    int8_t buf[PRINTF_BUF_SIZE];
+    fmt_out_t out;
+    va_list ap;
+
+    out.buf = buf;
+    out.size = sizeof(buf);
+    out.len = 0;
+    out.total = 0;
+    out.flush = printf_flush;
+    va_start(ap, format);
+    format_to(&out, format, ap);
+    va_end(ap);
+    printf_flush(&out);
+    return out.total;
 }
 
 /* int32_t puts(int8_t* s);
@@ -205,19 +305,18 @@ format_char_switch:
  *   Return Value: Number of bytes written
  *    Function: Output a string to the console */
 int32_t puts(int8_t* s) {
-    register int32_t index = 0;
-    while (s[index] != '\0') {
-        putc(s[index]);
-        index++;
-    }
-    return index;
+    uint32_t len = strlen(s);
+
+    console_write(s, len);
+    return len;
 }
 
-/* void putc(uint8_t c);
+/* void console_char(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- *  Function: Output a character to the console */
-void putc(uint8_t c) {
+ *  Function: Puts a character on the screen, scrolling if it has to; the
+ *            caller moves the cursor */
+static void console_char(uint8_t c) {
     if(c == '\n' || c == '\r') {
         screen_y++;
         screen_x = 0;
@@ -261,11 +360,36 @@ void putc(uint8_t c) {
         /* Set y as last line */
         screen_y = NUM_ROWS - 1;
     }
+}
+
+/* void console_write(const int8_t* s, uint32_t n);
+ * Inputs: s = characters to print, n = how many
+ * Return Value: void
+ *  Function: Output n characters to the console (and COM1 if mirrored),
+ *            moving the cursor once at the end */
+void console_write(const int8_t* s, uint32_t n) {
+    uint32_t i;
+
+    if (n == 0)
+        return;
+    for (i = 0; i < n; i++) {
+        if (serial_mirror)
+            serial_putc(s[i]);
+        console_char(s[i]);
+    }
 
     /* Set new cursor position */
     set_cursor(screen_x, screen_y);
 }
 
+/* void putc(uint8_t c);
+ * Inputs: uint_8* c = character to print
+ * Return Value: void
+ *  Function: Output a character to the console */
+void putc(uint8_t c) {
+    console_write((int8_t*)&c, 1);
+}
+
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
  * Inputs: uint32_t value = number to convert
  *            int8_t* buf = allocated buffer to place string in
@@ -326,21 +450,158 @@ int8_t* strrev(int8_t* s) {
 /* uint32_t strlen(const int8_t* s);
  * Inputs: const int8_t* s = string to take length of
  * Return Value: length of string s
- * Function: return length of string s */
+ * Function: return length of string s. Once s is aligned it looks at a
+ *           dword at a time; an aligned dword never crosses into the next
+ *           page, so reading past the NUL cannot fault */
 uint32_t strlen(const int8_t* s) {
-    register uint32_t len = 0;
-    while (s[len] != '\0')
-        len++;
-    return len;
+    const int8_t* p = s;
+    const uint32_t* w;
+
+    while (((uint32_t)p & 0x3) != 0) {
+        if (*p == '\0')
+            return p - s;
+        p++;
+    }
+    for (w = (const uint32_t*)p; !HAS_ZERO_BYTE(*w); w++)
+        ;
+    for (p = (const int8_t*)w; *p != '\0'; p++)
+        ;
+    return p - s;
 }
 
-/* void* memset(void* s, int32_t c, uint32_t n);
+/* void* memcpy_loop(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of bytes to copy
+ * Return Value: pointer to dest
+ * Function: MEM_LOOP memcpy: copy n bytes of src to dest a dword at a time
+ *           with plain moves, then the last bytes one at a time */
+static void* memcpy_loop(void* dest, const void* src, uint32_t n) {
+    void* d = dest;
+    uint32_t count = n >> 2, tail = n & 0x3;
+
+    asm volatile ("                     \n\
+            testl   %%ecx, %%ecx        \n\
+            jz      .memcpy_loop_tail   \n\
+            .memcpy_loop_top:           \n\
+            movl    (%%esi), %%eax      \n\
+            movl    %%eax, (%%edi)      \n\
+            addl    $4, %%esi           \n\
+            addl    $4, %%edi           \n\
+            subl    $1, %%ecx           \n\
+            jnz     .memcpy_loop_top    \n\
+            .memcpy_loop_tail:          \n\
+            testl   %%edx, %%edx        \n\
+            jz      .memcpy_loop_done   \n\
+            movb    (%%esi), %%al       \n\
+            movb    %%al, (%%edi)       \n\
+            addl    $1, %%esi           \n\
+            addl    $1, %%edi           \n\
+            subl    $1, %%edx           \n\
+            jmp     .memcpy_loop_tail   \n\
+            .memcpy_loop_done:          \n\
+            "
+            : "+S"(src), "+D"(d), "+c"(count), "+d"(tail)
+            :
+            : "eax", "memory", "cc"
+    );
+    return dest;
+}
+
+/* void* memset_loop(void* s, int32_t c, uint32_t n);
  * Inputs:    void* s = pointer to memory
  *          int32_t c = value to set memory to
  *         uint32_t n = number of bytes to set
- * Return Value: new string
- * Function: set n consecutive bytes of pointer s to value c */
-void* memset(void* s, int32_t c, uint32_t n) {
+ * Return Value: s
+ * Function: MEM_LOOP memset: set n bytes of s to c a dword at a time with
+ *           plain moves, then the last bytes one at a time */
+static void* memset_loop(void* s, int32_t c, uint32_t n) {
+    void* d = s;
+    uint32_t count = n >> 2, tail = n & 0x3;
+
+    c &= 0xFF;
+    asm volatile ("                     \n\
+            testl   %%ecx, %%ecx        \n\
+            jz      .memset_loop_tail   \n\
+            .memset_loop_top:           \n\
+            movl    %%eax, (%%edi)      \n\
+            addl    $4, %%edi           \n\
+            subl    $1, %%ecx           \n\
+            jnz     .memset_loop_top    \n\
+            .memset_loop_tail:          \n\
+            testl   %%edx, %%edx        \n\
+            jz      .memset_loop_done   \n\
+            movb    %%al, (%%edi)       \n\
+            addl    $1, %%edi           \n\
+            subl    $1, %%edx           \n\
+            jmp     .memset_loop_tail   \n\
+            .memset_loop_done:          \n\
+            "
+            : "+D"(d), "+c"(count), "+d"(tail)
+            : "a"(c << 24 | c << 16 | c << 8 | c)
+            : "memory", "cc"
+    );
+    return s;
+}
+
+/* void* memcpy_movsl(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of byets to copy
+ * Return Value: pointer to dest
+ * Function: MEM_MOVSL memcpy: copy bytes until dest is aligned, then rep
+ *           movsl, then the last bytes */
+static void* memcpy_movsl(void* dest, const void* src, uint32_t n) {
+    void* d = dest;
+
+    asm volatile ("                 \n\
+            .memcpy_top:            \n\
+            testl   %%ecx, %%ecx    \n\
+            jz      .memcpy_done    \n\
+            testl   $0x3, %%edi     \n\
+            jz      .memcpy_aligned \n\
+            movb    (%%esi), %%al   \n\
+            movb    %%al, (%%edi)   \n\
+            addl    $1, %%edi       \n\
+            addl    $1, %%esi       \n\
+            subl    $1, %%ecx       \n\
+            jmp     .memcpy_top     \n\
+            .memcpy_aligned:        \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            movl    %%ecx, %%edx    \n\
+            shrl    $2, %%ecx       \n\
+            andl    $0x3, %%edx     \n\
+            cld                     \n\
+            rep     movsl           \n\
+            .memcpy_bottom:         \n\
+            testl   %%edx, %%edx    \n\
+            jz      .memcpy_done    \n\
+            movb    (%%esi), %%al   \n\
+            movb    %%al, (%%edi)   \n\
+            addl    $1, %%edi       \n\
+            addl    $1, %%esi       \n\
+            subl    $1, %%edx       \n\
+            jmp     .memcpy_bottom  \n\
+            .memcpy_done:           \n\
+            "
+            : "+S"(src), "+D"(d), "+c"(n)
+            :
+            : "eax", "edx", "memory", "cc"
+    );
+    return dest;
+}
+
+/* void* memset_stosl(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: s
+ * Function: MEM_MOVSL memset: set bytes until s is aligned, then rep
+ *           stosl, then the last bytes */
+static void* memset_stosl(void* s, int32_t c, uint32_t n) {
+    void* d = s;
+
     c &= 0xFF;
     asm volatile ("                 \n\
             .memset_top:            \n\
@@ -369,13 +630,79 @@ void* memset(void* s, int32_t c, uint32_t n) {
             jmp     .memset_bottom  \n\
             .memset_done:           \n\
             "
+            : "+D"(d), "+c"(n)
+            : "a"(c << 24 | c << 16 | c << 8 | c)
+            : "edx", "memory", "cc"
+    );
+    return s;
+}
+
+/* void* memcpy_movsb(void* dest, const void* src, uint32_t n);
+ * Inputs:      void* dest = destination of copy
+ *         const void* src = source of copy
+ *              uint32_t n = number of bytes to copy
+ * Return Value: pointer to dest
+ * Function: MEM_MOVSB memcpy: a single rep movsb. With ERMS the CPU moves
+ *           whole cache lines for it whatever the alignment */
+static void* memcpy_movsb(void* dest, const void* src, uint32_t n) {
+    void* d = dest;
+
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     movsb           \n\
+            "
+            : "+S"(src), "+D"(d), "+c"(n)
             :
-            : "a"(c << 24 | c << 16 | c << 8 | c), "D"(s), "c"(n)
+            : "edx", "memory", "cc"
+    );
+    return dest;
+}
+
+/* void* memset_stosb(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: s
+ * Function: MEM_MOVSB memset: a single rep stosb */
+static void* memset_stosb(void* s, int32_t c, uint32_t n) {
+    void* d = s;
+
+    asm volatile ("                 \n\
+            movw    %%ds, %%dx      \n\
+            movw    %%dx, %%es      \n\
+            cld                     \n\
+            rep     stosb           \n\
+            "
+            : "+D"(d), "+c"(n)
+            : "a"(c)
             : "edx", "memory", "cc"
     );
     return s;
 }
 
+/* by MEM_* number; perf.c times each of them */
+const mem_ops_t mem_variants[MEM_VARIANTS] = {
+    { "loop", memcpy_loop, memset_loop },
+    { "movsl", memcpy_movsl, memset_stosl },
+    { "movsb", memcpy_movsb, memset_stosb },
+};
+const mem_ops_t* mem_ops = &mem_variants[MEM_MOVSL];
+
+/* void* memset(void* s, int32_t c, uint32_t n);
+ * Inputs:    void* s = pointer to memory
+ *          int32_t c = value to set memory to
+ *         uint32_t n = number of bytes to set
+ * Return Value: new string
+ * Function: set n consecutive bytes of pointer s to value c, the way
+ *           mem_ops does it */
+void* memset(void* s, int32_t c, uint32_t n) {
+    if (n < MEM_SMALL)
+        return memset_loop(s, c, n);
+    return mem_ops->set(s, c, n);
+}
+
 /* void* memset_word(void* s, int32_t c, uint32_t n);
  * Description: Optimized memset_word
  * Inputs:    void* s = pointer to memory
@@ -422,44 +749,11 @@ void* memset_dword(void* s, int32_t c, uint32_t n) {
  *         const void* src = source of copy
  *              uint32_t n = number of byets to copy
  * Return Value: pointer to dest
- * Function: copy n bytes of src to dest */
+ * Function: copy n bytes of src to dest, the way mem_ops does it */
 void* memcpy(void* dest, const void* src, uint32_t n) {
-    asm volatile ("                 \n\
-            .memcpy_top:            \n\
-            testl   %%ecx, %%ecx    \n\
-            jz      .memcpy_done    \n\
-            testl   $0x3, %%edi     \n\
-            jz      .memcpy_aligned \n\
-            movb    (%%esi), %%al   \n\
-            movb    %%al, (%%edi)   \n\
-            addl    $1, %%edi       \n\
-            addl    $1, %%esi       \n\
-            subl    $1, %%ecx       \n\
-            jmp     .memcpy_top     \n\
-            .memcpy_aligned:        \n\
-            movw    %%ds, %%dx      \n\
-            movw    %%dx, %%es      \n\
-            movl    %%ecx, %%edx    \n\
-            shrl    $2, %%ecx       \n\
-            andl    $0x3, %%edx     \n\
-            cld                     \n\
-            rep     movsl           \n\
-            .memcpy_bottom:         \n\
-            testl   %%edx, %%edx    \n\
-            jz      .memcpy_done    \n\
-            movb    (%%esi), %%al   \n\
-            movb    %%al, (%%edi)   \n\
-            addl    $1, %%edi       \n\
-            addl    $1, %%esi       \n\
-            subl    $1, %%edx       \n\
-            jmp     .memcpy_bottom  \n\
-            .memcpy_done:           \n\
-            "
-            :
-            : "S"(src), "D"(dest), "c"(n)
-            : "eax", "edx", "memory", "cc"
-    );
-    return dest;
+    if (n < MEM_SMALL)
+        return memcpy_loop(dest, src, n);
+    return mem_ops->copy(dest, src, n);
 }
 
 /* void* memmove(void* dest, const void* src, uint32_t n);
@@ -468,22 +762,26 @@ void* memcpy(void* dest, const void* src, uint32_t n) {
  *         const void* src = source of move
  *              uint32_t n = number of byets to move
  * Return Value: pointer to dest
- * Function: move n bytes of src to dest */
+ * Function: move n bytes of src to dest. Unless dest overlaps the end of
+ *           src a forward copy is right, so only that case goes backwards */
 void* memmove(void* dest, const void* src, uint32_t n) {
+    const void* s;
+    void* d;
+
+    if ((uint32_t)dest <= (uint32_t)src || (uint32_t)dest >= (uint32_t)src + n)
+        return memcpy(dest, src, n);
+
+    s = (const uint8_t*)src + n - 1;
+    d = (uint8_t*)dest + n - 1;
     asm volatile ("                             \n\
             movw    %%ds, %%dx                  \n\
             movw    %%dx, %%es                  \n\
-            cld                                 \n\
-            cmp     %%edi, %%esi                \n\
-            jae     .memmove_go                 \n\
-            leal    -1(%%esi, %%ecx), %%esi     \n\
-            leal    -1(%%edi, %%ecx), %%edi     \n\
             std                                 \n\
-            .memmove_go:                        \n\
             rep     movsb                       \n\
+            cld                                 \n\
             "
+            : "+S"(s), "+D"(d), "+c"(n)
             :
-            : "D"(dest), "S"(src), "c"(n)
             : "edx", "memory", "cc"
     );
     return dest;
@@ -499,10 +797,23 @@ void* memmove(void* dest, const void* src, uint32_t n) {
  *               character that does not match has a greater value
  *               in str1 than in str2; And a value less than zero
  *               indicates the opposite.
- * Function: compares string 1 and string 2 for equality */
+ * Function: compares string 1 and string 2 for equality. When both are
+ *           equally aligned it skips equal dwords without a NUL, then
+ *           finds the difference a byte at a time */
 int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
-    int32_t i;
-    for (i = 0; i < n; i++) {
+    uint32_t i = 0, w;
+
+    if ((((uint32_t)s1 ^ (uint32_t)s2) & 0x3) == 0) {
+        for (; i < n && ((uint32_t)(s1 + i) & 0x3) != 0; i++)
+            if ((s1[i] != s2[i]) || (s1[i] == '\0'))
+                return s1[i] - s2[i];
+        for (; n - i >= 4; i += 4) {
+            w = *(const uint32_t*)(s1 + i);
+            if (w != *(const uint32_t*)(s2 + i) || HAS_ZERO_BYTE(w))
+                break;
+        }
+    }
+    for (; i < n; i++) {
         if ((s1[i] != s2[i]) || (s1[i] == '\0') /* || s2[i] == '\0' */) {
 
             /* The s2[i] == '\0' is unnecessary because of the short-circuit
@@ -522,12 +833,7 @@ int32_t strncmp(const int8_t* s1, const int8_t* s2, uint32_t n) {
  * Return Value: pointer to dest
  * Function: copy the source string into the destination string */
 int8_t* strcpy(int8_t* dest, const int8_t* src) {
-    int32_t i = 0;
-    while (src[i] != '\0') {
-        dest[i] = src[i];
-        i++;
-    }
-    dest[i] = '\0';
+    memcpy(dest, src, strlen(src) + 1);
     return dest;
 }
 
@@ -603,6 +909,25 @@ cont:
     /* NOTREACHED */
 }
 
+/* int32_t cmdline_has(const int8_t* cmdline, const int8_t* word);
+ * Inputs: const int8_t* cmdline = multiboot command line
+ *         const int8_t* word = boot option to look for
+ * Return Value: 1 if word is one of its blank separated words, else 0
+ * Function: Check for a boot option */
+int32_t cmdline_has(const int8_t* cmdline, const int8_t* word) {
+    uint32_t len = strlen(word);
+
+    while (*cmdline != '\0') {
+        while (*cmdline == ' ')
+            cmdline++;
+        if (strncmp(cmdline, word, len) == 0 && (cmdline[len] == ' ' || cmdline[len] == '\0'))
+            return 1;
+        while (*cmdline != ' ' && *cmdline != '\0')
+            cmdline++;
+    }
+    return 0;
+}
+
 /* void test_interrupts(void)
  * Inputs: void
  * Return Value: void
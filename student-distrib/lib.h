@@ -7,7 +7,19 @@
 
 #include "types.h"
 
+/* variable arguments, without the C library's stdarg.h */
+typedef __builtin_va_list va_list;
+#define va_start(ap, last)  __builtin_va_start(ap, last)
+#define va_arg(ap, type)    __builtin_va_arg(ap, type)
+#define va_end(ap)          __builtin_va_end(ap)
+
+#define PRINTF_BUF_SIZE     128     /* printf formats this much at a time */
+
 int32_t printf(int8_t *format, ...);
+int32_t snprintf(int8_t* buf, uint32_t size, const int8_t* format, ...);
+int32_t vsnprintf(int8_t* buf, uint32_t size, const int8_t* format, va_list ap);
+/* writes n characters to the console, moving the cursor once */
+void console_write(const int8_t* s, uint32_t n);
 /* modified putc to support scrolling for terminal */
 void putc(uint8_t c);
 int32_t puts(int8_t *s);
@@ -22,6 +34,26 @@ void set_cursor(uint16_t x, uint16_t y);
 /*Display kernel panic message */
 void blue_screen(void);
 
+/* One way of doing memcpy and memset. memcpy, memset and the forward case
+ * of memmove call through mem_ops, which cpu_init in cpu.c points at the
+ * fastest one for the CPU; until then it is MEM_MOVSL. Below MEM_SMALL
+ * bytes the start-up cost of a rep instruction is more than the whole
+ * MEM_LOOP copy, so those always take MEM_LOOP */
+typedef struct mem_ops_t {
+    const int8_t* name;
+    void* (*copy)(void* dest, const void* src, uint32_t n);
+    void* (*set)(void* s, int32_t c, uint32_t n);
+} mem_ops_t;
+
+#define MEM_LOOP        0   /* a dword move at a time, no string instructions */
+#define MEM_MOVSL       1   /* rep movsl/stosl once the destination is aligned */
+#define MEM_MOVSB       2   /* rep movsb/stosb, fast on CPUs with ERMS */
+#define MEM_VARIANTS    3
+#define MEM_SMALL       32
+
+extern const mem_ops_t mem_variants[MEM_VARIANTS];
+extern const mem_ops_t* mem_ops;
+
 void* memset(void* s, int32_t c, uint32_t n);
 void* memset_word(void* s, int32_t c, uint32_t n);
 void* memset_dword(void* s, int32_t c, uint32_t n);
@@ -32,13 +64,16 @@ int8_t* strcpy(int8_t* dest, const int8_t*src);
 int8_t* strncpy(int8_t* dest, const int8_t*src, uint32_t n);
 /*parse string helper function for execute*/
 int8_t* strtok(int8_t *s, const int8_t *delim);
+/* 1 if word is one of the blank separated words of cmdline */
+int32_t cmdline_has(const int8_t* cmdline, const int8_t* word);
 void test_interrupts(void);
 
 
-/* Userspace address-check functions */
-int32_t bad_userspace_addr(const void* addr, int32_t len);
+/* Userspace address-check functions, bad_userspace_addr is in syscalls.h */
 int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
 
+#ifndef HOST_BUILD
+
 /* Port read functions */
 /* Inb reads a byte and returns its value as a zero-extended 32-bit
  * unsigned int */
@@ -123,6 +158,12 @@ do {                                    \
     );                                  \
 } while (0)
 
+#define EFLAGS_IF                       0x200   /* interrupts enabled */
+
+/* Time the sections that cli_and_save masks interrupts for, see i8259.c */
+void irqoff_begin(const int8_t* file, uint32_t line);
+void irqoff_end(void);
+
 /* Save flags and then clear interrupt flag
  * Saves the EFLAGS register into the variable "flags", and then
  * disables interrupts on this processor */
@@ -137,6 +178,8 @@ do {                                    \
             :                           \
             : "memory", "cc"            \
     );                                  \
+    if ((flags) & EFLAGS_IF)            \
+        irqoff_begin(__FILE__, __LINE__); \
 } while (0)
 
 /* Set interrupt flag - enable interrupts on this processor */
@@ -154,6 +197,8 @@ do {                                    \
  * after a cli_and_save_flags(flags) */
 #define restore_flags(flags)            \
 do {                                    \
+    if ((flags) & EFLAGS_IF)            \
+        irqoff_end();                   \
     asm volatile ("                   \n\
             pushl %0                  \n\
             popfl                     \n\
@@ -164,4 +209,43 @@ do {                                    \
     );                                  \
 } while (0)
 
+/* Reads the time stamp counter into the uint64_t variable "val" */
+#define rdtsc(val)                      \
+do {                                    \
+    asm volatile ("rdtsc"               \
+            : "=A"(val)                 \
+            :                           \
+            : "memory"                  \
+    );                                  \
+} while (0)
+
+#else /* HOST_BUILD */
+
+/* Built into a host program by host/Makefile: there are no ports to talk
+ * to and a user process may not touch the interrupt flag, so port I/O goes
+ * to the fake devices in host/stubs.c and the flag macros do nothing */
+uint32_t host_inb(uint32_t port);
+void host_outb(uint32_t data, uint32_t port);
+
+#define inb(port)               host_inb(port)
+#define outb(data, port)        host_outb((data), (port))
+#define cli()                   do { } while (0)
+#define sti()                   do { } while (0)
+#define cli_and_save(flags)     do { (flags) = 0; } while (0)
+#define restore_flags(flags)    do { (void)(flags); } while (0)
+
+/* "=A" is only edx:eax on 32-bit builds */
+#define rdtsc(val)                      \
+do {                                    \
+    uint32_t lo_, hi_;                  \
+    asm volatile ("rdtsc"               \
+            : "=a"(lo_), "=d"(hi_)      \
+            :                           \
+            : "memory"                  \
+    );                                  \
+    (val) = ((uint64_t)hi_ << 32) | lo_; \
+} while (0)
+
+#endif /* HOST_BUILD */
+
 #endif /* _LIB_H */
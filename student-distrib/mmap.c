@@ -0,0 +1,160 @@
+#include "mmap.h"
+#include "syscalls.h"
+#include "filesys.h"
+#include "paging.h"
+
+/* mmap_detach
+ * DESCRIPTION: unmaps entry idx of owner's mmaps from directory. Pages
+                that were private copies go back to the frame pool,
+                pages of the image are simply dropped, and the file may
+                be truncated again once nothing else maps it
+ * INPUTS: owner -- PCB of the process, directory -- its page directory,
+ *         idx -- entry of owner->mmaps
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void mmap_detach(pcb_t* owner, uint32_t* directory, uint32_t idx) {
+    uint32_t i;
+
+    /* frame_free ignores addresses outside the pool, i.e. the image */
+    for (i = 0; i < owner->mmaps[idx].npages; i++)
+        frame_free(paging_unmap_page(directory, owner->mmaps[idx].addr + i * PAGE_SIZE));
+    file_map_unref(owner->mmaps[idx].inode);
+    owner->mmaps[idx].addr = 0;
+}
+
+/* mmap
+ * DESCRIPTION: system call for mmap, maps the first len bytes of an open
+                file read-only into the caller. Full blocks map straight to
+                the data blocks of the file system image, so reading them
+                costs no copy. The block holding the end of the file is
+                copied to a private frame so the bytes past the end read
+                as 0. Blocks are copied too if the image itself is not page
+                aligned, or is compressed (they then live in the cache).
+                While mapped the file cannot be truncated shorter, which
+                would free image blocks the mapping still shows
+ * INPUTS: fd -- open regular file, len -- bytes to map (at most its length)
+ * OUTPUTS: none
+ * RETURN VALUE: address of the mapping, -1 on failure
+ * SIDE EFFECTS: allocates page tables, and frames for the copies
+ */
+int32_t mmap(int32_t fd, uint32_t len) {
+    pcb_t* owner;
+    uint32_t* directory;
+    int32_t inode;
+    uint32_t length, npages, virt, phys, flags, i;
+    int32_t slot;
+    uint8_t* block;
+
+    if (fd < 2 || fd >= NUM_MAX_OPEN_FILES || len == 0)
+        return -1;
+    if ((inode = file_fd_inode(fd)) == -1)
+        return -1;
+    length = flength(inode);
+    if (len > length)
+        return -1;
+    npages = (len + PAGE_SIZE - 1) >> BITS_4KB_ALIGN;
+
+    cli_and_save(flags);
+    owner = getProcessPCB(getCurrentProcessPCB()->owner);
+    directory = owner->page_dir;
+
+    for (slot = 0; slot < MMAP_PER_PROCESS; slot++) {
+        if (owner->mmaps[slot].addr == 0)
+            break;
+    }
+    if (slot == MMAP_PER_PROCESS ||
+        (virt = paging_find_free(directory, MMAP_REGION_START, MMAP_REGION_END, npages)) == 0) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    owner->mmaps[slot].addr = virt;
+    owner->mmaps[slot].npages = 0;
+    owner->mmaps[slot].inode = inode;
+    file_map_ref(inode);
+    for (i = 0; i < npages; i++) {
+        if ((block = file_block_addr(inode, i)) == NULL)
+            break;
+
+        phys = (uint32_t)block;
+        if ((phys & (PAGE_SIZE - 1)) || (i + 1) * PAGE_SIZE > length || !file_blocks_stable()) {
+            /* private copy, zero past the end of the file */
+            if ((phys = frame_alloc()) == 0)
+                break;
+            memcpy((void*)phys, block, ((i + 1) * PAGE_SIZE > length) ? length - i * PAGE_SIZE : PAGE_SIZE);
+        }
+        if (paging_map_page(directory, virt + i * PAGE_SIZE, phys, USER_PTE_RO) == -1) {
+            frame_free(phys);
+            break;
+        }
+        owner->mmaps[slot].npages++;
+    }
+
+    if (i < npages) {
+        mmap_detach(owner, directory, slot);
+        restore_flags(flags);
+        return -1;
+    }
+    restore_flags(flags);
+    return virt;
+}
+
+/* munmap
+ * DESCRIPTION: system call for munmap, removes a mapping made by mmap
+ * INPUTS: addr -- address mmap returned
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if nothing is mapped at addr
+ * SIDE EFFECTS: none
+ */
+int32_t munmap(void* addr) {
+    pcb_t* owner;
+    uint32_t flags;
+    uint32_t i;
+
+    if ((uint32_t)addr == 0 || ((uint32_t)addr & (PAGE_SIZE - 1)))
+        return -1;
+
+    cli_and_save(flags);
+    owner = getProcessPCB(getCurrentProcessPCB()->owner);
+    for (i = 0; i < MMAP_PER_PROCESS; i++) {
+        if (owner->mmaps[i].addr == (uint32_t)addr) {
+            mmap_detach(owner, owner->page_dir, i);
+            restore_flags(flags);
+            return 0;
+        }
+    }
+    restore_flags(flags);
+    return -1;
+}
+
+/* mmap_init_process
+ * DESCRIPTION: marks every mmaps entry of a new process unused
+ * INPUTS: pcb -- new process
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void mmap_init_process(pcb_t* pcb) {
+    uint32_t i;
+
+    for (i = 0; i < MMAP_PER_PROCESS; i++)
+        pcb->mmaps[i].addr = 0;
+}
+
+/* mmap_exit
+ * DESCRIPTION: unmaps every file a process still has mapped
+ * INPUTS: pcb -- process that is going away (not a thread)
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: frees the private copies
+ */
+void mmap_exit(pcb_t* pcb) {
+    uint32_t i;
+
+    for (i = 0; i < MMAP_PER_PROCESS; i++) {
+        if (pcb->mmaps[i].addr != 0)
+            mmap_detach(pcb, pcb->page_dir, i);
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef MMAP_H_
+#define MMAP_H_
+
+#include "types.h"
+#include "pcb.h"
+
+#define MMAP_REGION_START   0x10000000  /* 256MB, files are mapped from here */
+#define MMAP_REGION_END     0x20000000  /* 512MB */
+
+/* mmap system call: maps the first len bytes of a file read-only */
+extern int32_t mmap(int32_t fd, uint32_t len);
+/* munmap system call: unmaps what mmap mapped at addr */
+extern int32_t munmap(void* addr);
+
+/* marks every mmaps entry of a new process unused */
+extern void mmap_init_process(pcb_t* pcb);
+/* unmaps every file of a process that is going away */
+extern void mmap_exit(pcb_t* pcb);
+
+#endif
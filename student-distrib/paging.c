@@ -1,4 +1,5 @@
 #include "paging.h"
+#include "syscalls.h"
 
 
 /* arr for page directory, aligned to 4KB memory */
@@ -10,21 +11,46 @@ uint32_t page_table[NUM_ENTRIES] __attribute__((aligned(ALIGN_BITS)));
 /* array for video memroy pages. 128-132MB page tabley, align each to 4kB */
 uint32_t video_pages[NUM_ENTRIES] __attribute__((aligned(4096)));
 
+/* one page directory per process slot, loaded into CR3 by the scheduler */
+static uint32_t process_page_directory[NUM_MAX_PROCESSES][NUM_ENTRIES] __attribute__((aligned(ALIGN_BITS)));
+
+/* first 4MB user page of the process slots, and the frame pool after them.
+ * Both move up when the file system image runs past the kernel page */
+static uint32_t user_frames_start = USER_FRAMES_MIN;
+static uint32_t frame_pool_start = USER_FRAMES_MIN + NUM_MAX_PROCESSES * C_4MB;
+static uint32_t frame_pool_end = USER_FRAMES_MIN + NUM_MAX_PROCESSES * C_4MB + FRAME_POOL_SIZE;
+
+/* one bit per frame of the pool, set while the frame is in use */
+static uint32_t frame_bitmap[NUM_FRAMES / 32];
+/* frames past the end of physical memory are never handed out */
+static uint32_t frame_count = NUM_FRAMES;
+/* where the next search for a free frame starts */
+static uint32_t frame_hint;
+/* frames handed out and not freed yet */
+static uint32_t frame_used;
+
 /* paging_init
  *   DESCRIPTION: Called by kernel.c to initialize paging. 
  * 	 			  Sets up 4kb pages for first 4MB including video memory, and 
  * 				  Sets up one page of 4MB for kernel, location defined in makefile. 
- *   INPUT: none
+ * 				  The file system image is loaded after the kernel; the part of
+ * 				  it past the kernel page gets 4MB kernel pages of its own, and
+ * 				  the process pages and the frame pool are placed after it.
+ *   INPUT: image_end -- first address past the file system image, 0 if none
  *   OUTPUT: none
- *   RETURN VALUE: none
+ *   RETURN VALUE: 0 on success, -1 if the image ends too close to
+ *                 USER_PAGE_VIRT to fit; it is then not mapped past the
+ *                 kernel page and must not be mounted
  *   SIDE EFFECT: Arrays for page_directory and page_table is declared and initialized.
  * 				  Bits for each pages initialized to 0, sttribute bits marked present correspondingly.
  * 				  Change the control registers bits to enable paging.
  */
-void paging_init()
+int32_t paging_init(uint32_t image_end)
 {
  	// 	printf(" Paging Initialization! \n");
 	unsigned int i;
+	uint32_t image_top;
+	int32_t ret = 0;
   
   	/* 0x02 = 10 mark each page tables in directory as read/write & not present
   	 * NOTE: only kernel-mode can access them (supervisor) from os dev */
@@ -52,6 +78,25 @@ void paging_init()
 	 */
 	page_directory[1] = 0x00400083;
 
+	/* the rest of the image, rounded up to whole 4MB pages */
+	if (image_end > USER_PAGE_VIRT - NUM_MAX_PROCESSES * C_4MB - FRAME_POOL_SIZE) {
+		ret = -1;
+	} else if (image_end > USER_FRAMES_MIN) {
+		image_top = (image_end + C_4MB - 1) & PDE_4MB_ADDR_MASK;
+		for (i = USER_FRAMES_MIN >> PDE_IDX_SHIFT; i < image_top >> PDE_IDX_SHIFT; i++) {
+			page_directory[i] = (i << PDE_IDX_SHIFT) | KERNEL_PDE_4MB;
+		}
+		user_frames_start = image_top;
+		frame_pool_start = image_top + NUM_MAX_PROCESSES * C_4MB;
+		frame_pool_end = frame_pool_start + FRAME_POOL_SIZE;
+	}
+
+	/* identity map the frame pool for the kernel only, so page tables and
+	 * frames can be reached whatever directory is loaded */
+	for (i = frame_pool_start >> PDE_IDX_SHIFT; i < frame_pool_end >> PDE_IDX_SHIFT; i++) {
+		page_directory[i] = (i << PDE_IDX_SHIFT) | KERNEL_PDE_4MB;
+	}
+
 	/* set control registers to initialize paging */
     __asm__ (
         /* load page_directory address to cr3 */
@@ -72,6 +117,7 @@ void paging_init()
         : "a"(page_directory)
         : "%ebx", "cc"
     ); 
+	return ret;
 }
 
 /*
@@ -109,4 +155,267 @@ void flush_tlb(void){
     );
 }
 
+/* paging_setup_process
+ *   DESCRIPTION: Builds the page directory for process slot pid. The kernel
+ *                entries (kernel, image and frame pool) are shared with the
+ *                boot page directory, the 4MB page at 128MB points at
+ *                user_phys, everything else is not present.
+ *   INPUT: pid -- process slot, user_phys -- physical address of its 4MB page
+ *   OUTPUT: none
+ *   RETURN VALUE: pointer to the page directory, ready to be loaded into CR3
+ *   SIDE EFFECT: overwrites the previous directory of this slot
+ */
+uint32_t* paging_setup_process(uint32_t pid, uint32_t user_phys) {
+	uint32_t* directory = process_page_directory[pid];
+	unsigned int i;
+
+	/* the boot directory only holds kernel mappings */
+	for (i = 0; i < NUM_ENTRIES; i++) {
+		directory[i] = page_directory[i];
+	}
+	directory[USER_PAGE_VIRT >> PDE_IDX_SHIFT] = user_phys | USER_PDE_4MB;
+
+	return directory;
+}
+
+/*
+ * Physical address of the 4MB user page of process slot pid, after the
+ * kernel and the file system image
+ */
+uint32_t paging_user_frame(uint32_t pid) {
+	return user_frames_start + pid * C_4MB;
+}
+
+/*
+ * Switch to another address space. Reloading CR3 also flushes the TLB.
+ */
+void load_page_directory(uint32_t* directory) {
+    asm volatile("movl %0, %%cr3"
+        : /* no outputs */
+        : "r"(directory)
+        : "memory"
+    );
+}
+
+/* paging_virt_to_phys
+ *   DESCRIPTION: Walks directory (4MB pages and 4KB page tables) to find the
+ *                physical address a user virtual address is mapped to.
+ *   INPUT: directory -- page directory, virt_address -- address to translate
+ *   OUTPUT: none
+ *   RETURN VALUE: physical address, 0 if it is not mapped for user access
+ *   SIDE EFFECT: none
+ */
+uint32_t paging_virt_to_phys(uint32_t* directory, uint32_t virt_address) {
+	uint32_t pde = directory[virt_address >> PDE_IDX_SHIFT];
+	uint32_t pte;
+
+	if ((pde & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER))
+		return 0;
+	if (pde & PAGE_SIZE_4MB)
+		return (pde & PDE_4MB_ADDR_MASK) | (virt_address & ~PDE_4MB_ADDR_MASK);
+
+	/* page tables live in identity mapped kernel memory */
+	pte = ((uint32_t*)(pde & PAGE_ADDR_MASK))[(virt_address >> BITS_4KB_ALIGN) & PTE_IDX_MASK];
+	if ((pte & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER))
+		return 0;
+	return (pte & PAGE_ADDR_MASK) | (virt_address & ~PAGE_ADDR_MASK);
+}
+
+/* frame_pool_limit
+ *   DESCRIPTION: Shrinks the frame pool when the machine has less memory
+ *                than the end of the pool. Called once at boot, after
+ *                paging_init placed the pool.
+ *   INPUT: mem_end -- first physical address past the end of RAM
+ *   OUTPUT: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECT: none
+ */
+void frame_pool_limit(uint32_t mem_end) {
+	if (mem_end <= frame_pool_start)
+		frame_count = 0;
+	else if (mem_end < frame_pool_end)
+		frame_count = (mem_end - frame_pool_start) >> BITS_4KB_ALIGN;
+}
+
+/* frame_alloc
+ *   DESCRIPTION: Takes a free 4KB frame from the pool and zeroes it.
+ *   INPUT: none
+ *   OUTPUT: none
+ *   RETURN VALUE: physical (= kernel virtual) address of the frame, 0 if
+ *                 the pool is empty
+ *   SIDE EFFECT: none
+ */
+uint32_t frame_alloc(void) {
+	uint32_t flags;
+	uint32_t n, i;
+
+	cli_and_save(flags);
+	for (n = 0; n < frame_count; n++) {
+		i = frame_hint + n;
+		if (i >= frame_count)
+			i -= frame_count;
+		if (frame_bitmap[i >> 5] & (1 << (i & 31)))
+			continue;
+
+		frame_bitmap[i >> 5] |= 1 << (i & 31);
+		frame_hint = i + 1;
+		frame_used++;
+		restore_flags(flags);
+		memset((void*)(frame_pool_start + (i << BITS_4KB_ALIGN)), 0, PAGE_SIZE);
+		return frame_pool_start + (i << BITS_4KB_ALIGN);
+	}
+	restore_flags(flags);
+	return 0;
+}
+
+/* frame_free
+ *   DESCRIPTION: Returns a frame from frame_alloc to the pool.
+ *   INPUT: phys -- address of the frame
+ *   OUTPUT: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECT: none
+ */
+void frame_free(uint32_t phys) {
+	uint32_t flags;
+	uint32_t i;
+
+	if (phys < frame_pool_start || phys >= frame_pool_end)
+		return;
+	i = (phys - frame_pool_start) >> BITS_4KB_ALIGN;
+
+	cli_and_save(flags);
+	if (frame_bitmap[i >> 5] & (1 << (i & 31)))
+		frame_used--;
+	frame_bitmap[i >> 5] &= ~(1 << (i & 31));
+	if (i < frame_hint)
+		frame_hint = i;
+	restore_flags(flags);
+}
+
+/* frame_pool_stats
+ *   DESCRIPTION: Reports how much of the frame pool is in use.
+ *   INPUT: none
+ *   OUTPUT: total -- frames the pool can hand out, used -- frames out
+ *   RETURN VALUE: none
+ *   SIDE EFFECT: none
+ */
+void frame_pool_stats(uint32_t* total, uint32_t* used) {
+	*total = frame_count;
+	*used = frame_used;
+}
+
+/*
+ * Drop the TLB entry of one page, in case directory is the loaded one
+ */
+static void invalidate_page(uint32_t virt_address) {
+    asm volatile("invlpg (%0)"
+        : /* no outputs */
+        : "r"(virt_address)
+        : "memory"
+    );
+}
+
+/* paging_map_page
+ *   DESCRIPTION: Maps the 4KB page at virt_address to phys_address in
+ *                directory. The page table comes from the frame pool the
+ *                first time its 4MB range is used.
+ *   INPUT: directory -- page directory, virt_address -- page to map,
+ *          phys_address -- frame, flags -- USER_PTE_RW or USER_PTE_RO
+ *   OUTPUT: none
+ *   RETURN VALUE: 0 on success, -1 if the page is taken by a 4MB mapping or
+ *                 already mapped, or no frame is left for the page table
+ *   SIDE EFFECT: none
+ */
+int32_t paging_map_page(uint32_t* directory, uint32_t virt_address, uint32_t phys_address, uint32_t flags) {
+	uint32_t* pde = &directory[virt_address >> PDE_IDX_SHIFT];
+	uint32_t* pte;
+	uint32_t table;
+
+	if (!(*pde & PAGE_PRESENT)) {
+		if ((table = frame_alloc()) == 0)
+			return -1;
+		*pde = table | PAGE_TABLE_PRESENT_ENTRY;
+	} else if ((*pde & PAGE_SIZE_4MB) || !(*pde & PAGE_USER)) {
+		return -1;
+	}
+
+	pte = &((uint32_t*)(*pde & PAGE_ADDR_MASK))[(virt_address >> BITS_4KB_ALIGN) & PTE_IDX_MASK];
+	if (*pte & PAGE_PRESENT)
+		return -1;
+	*pte = (phys_address & PAGE_ADDR_MASK) | flags;
+	invalidate_page(virt_address);
+	return 0;
+}
+
+/* paging_unmap_page
+ *   DESCRIPTION: Removes the 4KB mapping of virt_address from directory. The
+ *                page table stays until paging_release_tables.
+ *   INPUT: directory -- page directory, virt_address -- page to unmap
+ *   OUTPUT: none
+ *   RETURN VALUE: the frame the page pointed to, 0 if it was not mapped
+ *   SIDE EFFECT: none
+ */
+uint32_t paging_unmap_page(uint32_t* directory, uint32_t virt_address) {
+	uint32_t pde = directory[virt_address >> PDE_IDX_SHIFT];
+	uint32_t* pte;
+	uint32_t phys;
+
+	if (!(pde & PAGE_PRESENT) || (pde & PAGE_SIZE_4MB))
+		return 0;
+
+	pte = &((uint32_t*)(pde & PAGE_ADDR_MASK))[(virt_address >> BITS_4KB_ALIGN) & PTE_IDX_MASK];
+	if (!(*pte & PAGE_PRESENT))
+		return 0;
+	phys = *pte & PAGE_ADDR_MASK;
+	*pte = 0;
+	invalidate_page(virt_address);
+	return phys;
+}
+
+/* paging_find_free
+ *   DESCRIPTION: Looks for npages consecutive unmapped user pages between
+ *                start and end.
+ *   INPUT: directory -- page directory, start/end -- page aligned window,
+ *          npages -- pages needed
+ *   OUTPUT: none
+ *   RETURN VALUE: first address of the free range, 0 if there is none
+ *   SIDE EFFECT: none
+ */
+uint32_t paging_find_free(uint32_t* directory, uint32_t start, uint32_t end, uint32_t npages) {
+	uint32_t addr, run;
 
+	run = 0;
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		if (paging_virt_to_phys(directory, addr) != 0) {
+			run = 0;
+			continue;
+		}
+		if (++run == npages)
+			return addr - (npages - 1) * PAGE_SIZE;
+	}
+	return 0;
+}
+
+/* paging_release_tables
+ *   DESCRIPTION: Frees the page tables paging_map_page allocated for
+ *                directory. Static tables (vidmap) are left alone. The
+ *                pages they mapped must already be unmapped or owned
+ *                elsewhere.
+ *   INPUT: directory -- page directory of a process that is going away
+ *   OUTPUT: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECT: none
+ */
+void paging_release_tables(uint32_t* directory) {
+	uint32_t i, table;
+
+	for (i = 0; i < NUM_ENTRIES; i++) {
+		if (!(directory[i] & PAGE_PRESENT) || (directory[i] & PAGE_SIZE_4MB))
+			continue;
+		table = directory[i] & PAGE_ADDR_MASK;
+		if (table < frame_pool_start || table >= frame_pool_end)
+			continue;
+		directory[i] = 0x00000002;
+		frame_free(table);
+	}
+}
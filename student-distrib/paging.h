@@ -21,6 +21,30 @@
 #define BITS_4KB_ALIGN              12
 #define VID_MEM_PT_INDEX            (VIDEO >> BITS_4KB_ALIGN)
 
+#define USER_PAGE_VIRT              0x08000000  /* 128MB, virtual address of the 4MB program page */
+#define USER_PDE_4MB                0x87        /* 4MB/USER/READ+WRITE/PRESENT                  */
+
+#define PAGE_PRESENT                0x1
+#define PAGE_USER                   0x4
+#define PAGE_SIZE_4MB               0x80
+#define PDE_4MB_ADDR_MASK           0xFFC00000
+#define PAGE_ADDR_MASK              0xFFFFF000
+#define PTE_IDX_MASK                0x3FF
+#define PAGE_SIZE                   4096
+#define USER_PTE_RW                 0x7         /* USER/READ+WRITE/PRESENT                      */
+#define USER_PTE_RO                 0x5         /* USER/READ ONLY/PRESENT                       */
+#define KERNEL_PDE_4MB              0x83        /* 4MB/SUPERVISOR/READ+WRITE/PRESENT            */
+
+/* The file system image is loaded right after the kernel and mapped with
+ * 4MB kernel pages. The 4MB pages of the process slots follow it (at 8MB
+ * when it fits in the kernel page), then the 4KB frames handed out at run
+ * time (page tables, shared memory, ...), identity mapped for the kernel.
+ * All of it has to end below USER_PAGE_VIRT, so the image must end below
+ * 72MB */
+#define USER_FRAMES_MIN             0x00800000  /* 8MB, past the kernel stacks                  */
+#define FRAME_POOL_SIZE             0x01800000  /* 24MB                                         */
+#define NUM_FRAMES                  (FRAME_POOL_SIZE >> BITS_4KB_ALIGN)
+
 /* declare global page directory array */
 extern uint32_t page_directory[NUM_ENTRIES];
 /* declare global page table for 0MB ~ 4MB (1024 entries) */
@@ -31,11 +55,35 @@ uint32_t video_pages[NUM_ENTRIES];
 
 
 /* ============================== FUNCTION DECLARATIONS ======================START= */
-/* funtion to initialize pages in 0MB ~ 4MB(video memory) & 4MB ~ 8MB (kernal)  */
-extern void paging_init();
+/* funtion to initialize pages in 0MB ~ 4MB(video memory), the kernel and the image */
+extern int32_t paging_init(uint32_t image_end);
 extern void update_page_directory(uint32_t virt_address, uint32_t phys_address, uint16_t flags);
 extern void remap_video(uint32_t virt_address);
 extern void flush_tlb(void);
+/* build the page directory of process pid around its 4MB user page */
+extern uint32_t* paging_setup_process(uint32_t pid, uint32_t user_phys);
+/* physical address of the 4MB user page of process slot pid */
+extern uint32_t paging_user_frame(uint32_t pid);
+/* switch address spaces by loading a page directory into CR3 */
+extern void load_page_directory(uint32_t* directory);
+/* physical address behind a user virtual address, 0 if not mapped for user */
+extern uint32_t paging_virt_to_phys(uint32_t* directory, uint32_t virt_address);
+/* cap the frame pool at the end of physical memory */
+extern void frame_pool_limit(uint32_t mem_end);
+/* take a zeroed 4KB frame from the pool, 0 if none is left */
+extern uint32_t frame_alloc(void);
+/* give a frame back to the pool */
+extern void frame_free(uint32_t phys);
+/* frames the pool can hand out, and how many are out */
+extern void frame_pool_stats(uint32_t* total, uint32_t* used);
+/* map one 4KB user page, allocating its page table if needed */
+extern int32_t paging_map_page(uint32_t* directory, uint32_t virt_address, uint32_t phys_address, uint32_t flags);
+/* unmap one 4KB user page, returns the frame it pointed to (0 if none) */
+extern uint32_t paging_unmap_page(uint32_t* directory, uint32_t virt_address);
+/* first of npages unmapped pages in [start, end), 0 if none */
+extern uint32_t paging_find_free(uint32_t* directory, uint32_t start, uint32_t end, uint32_t npages);
+/* free the page tables paging_map_page allocated for directory */
+extern void paging_release_tables(uint32_t* directory);
 /* =============================================================================END= */
 
 #endif
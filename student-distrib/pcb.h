@@ -6,6 +6,18 @@
 
 #define PCB_MASK 0x1FFF
 #define NUM_MAX_OPEN_FILES 8
+#define SHM_PER_PROCESS 4
+#define SHM_NONE (-1)
+#define MMAP_PER_PROCESS 4
+#define TASK_NAME_LEN 32    /* FILENAME_LEN, program names are shorter */
+
+/* scheduling states kept in pcb_t.state */
+#define TASK_RUNNABLE 0
+#define TASK_BLOCKED  1
+#define TASK_ZOMBIE   2
+
+/* parent_num of a task that nobody will wait for */
+#define PID_NONE 0xFFFFFFFF
 
 // file struct
 typedef struct file_t{
@@ -15,21 +27,52 @@ typedef struct file_t{
 	int32_t flags;
 } file_t;
 
+// shared memory segment a process has mapped
+typedef struct shm_map_t{
+	int32_t segment; // index into the segment table, SHM_NONE if unused
+	uint32_t addr;   // where the segment starts in the process
+} shm_map_t;
+
+// file mapped by mmap, addr 0 if unused
+typedef struct mmap_map_t{
+	uint32_t addr;
+	uint32_t npages;
+	uint32_t inode;
+} mmap_map_t;
+
 // struct for pcb in 4-8MB kernel page
 typedef struct pcb_t {
 	file_t file_array[NUM_MAX_OPEN_FILES];										// An array of file structs for each process
-	uint32_t parent_num;                                      // 1-indexed PID of parent task, 0 if current task is root shell
-	uint32_t parent_esp;																			// Value to set ESP to on calling halt (ESP of parent process)
-	uint32_t current_esp;                                     // Value to set ESP to on switching to the task (stored in PIT interrupt, restored in later PIT interrupt)
-	uint32_t parent_ebp;																			// Value to set EBP to on calling halt (EBP of parent process)
+	uint32_t parent_num;                                      // PID of parent task, PID_NONE if the task has no parent (root shell or orphan)
+	uint32_t current_esp;                                     // Kernel ESP saved by switch_to when the scheduler switches away from the task
 	uint32_t current_ebp;																			// Value to set EBP to on switching to the task (stored in PIT interrupt, restored in later PIT interrupt)
 	uint32_t current_eip;																			// Value to set EIP to on switching to the task (stored in PIT interrupt, restored in later PIT interrupt)
-	uint8_t* exec_ret_addr;																		// Value to set EIP to on calling halt (EIP of parent process)
 	uint32_t rtc_count;																				// Current number of RTC ticks in current RTC read. Since only one RTC read at a time per process, just store number of 1024Hz ticks left in PCB
 	uint8_t arg[TERMINAL_BUFFER_SIZE];												// Buffer containing the arguments to the process
 	uint8_t num_char_in_arg;																	// Number of characters in argument buffer
 	uint8_t terminal_index;                                   // What terminal this process is running on
 	uint8_t is_user_mode;																			// Whether a PIT interrupt should return to user mode or kernel mode (useful for launching 2nd and 3rd terminal shells)
+	uint32_t pid;                                             // Index of the task in pid_array, also selects its kernel stack slot
+	uint32_t state;                                           // TASK_RUNNABLE, TASK_BLOCKED or TASK_ZOMBIE
+	int32_t exit_status;                                      // Status passed to halt, collected by the parent through waitpid
+	int32_t wait_pid;                                         // Child PID the task is blocked on in waitpid (-1 for any child, WAIT_NONE if not waiting)
+	uint32_t* page_dir;                                       // Page directory loaded into CR3 when the task is scheduled
+	uint32_t owner;                                           // PID of the process the task belongs to, its own PID unless it is a thread
+	file_t* files;                                            // File table in use: file_array of the owner process
+	struct wait_queue_t* wait_queue;                          // Wait queue the task sleeps on, NULL if none
+	struct pcb_t* wait_next;                                  // Next task on the same wait queue
+	uint32_t wait_key;                                        // What the task waits for inside its queue (futex: physical address)
+	shm_map_t shm_maps[SHM_PER_PROCESS];                      // Shared memory segments mapped by the process (used in the owner's PCB)
+	mmap_map_t mmaps[MMAP_PER_PROCESS];                       // Files mapped by the process (used in the owner's PCB)
+	uint32_t heap_brk;                                        // End of the heap, pages below it are backed on first touch (used in the owner's PCB)
+	uint8_t name[TASK_NAME_LEN];                              // Program file name, shown by proc/ps
+	uint32_t ticks;                                           // PIT ticks the task was running when they fired
 } pcb_t;
 
+// FIFO of blocked tasks, linked through pcb_t.wait_next
+typedef struct wait_queue_t {
+	pcb_t* head;
+	pcb_t* tail;
+} wait_queue_t;
+
 #endif
@@ -0,0 +1,315 @@
+#include "perf.h"
+#include "lib.h"
+#include "serial.h"
+#include "filesys.h"
+#include "syscalls.h"
+#include "paging.h"
+
+/* one timed run: returns the cycles it took and sets *units to what the
+ * result is counted in (KB copied, lookups, ...) */
+typedef uint32_t (*perf_bench_t)(uint32_t* units);
+
+static int32_t perf_on;
+static int32_t perf_stage;          /* 0 before PERF_PROGRAM, 1 while it runs, 2 done */
+static uint8_t perf_src[PERF_BUF_SIZE] __attribute__((aligned(4096)));
+static uint8_t perf_dst[PERF_BUF_SIZE] __attribute__((aligned(4096)));
+static uint8_t perf_names[PERF_NAMES][FILENAME_LEN + 1];
+static uint32_t perf_name_count;
+
+/* what the memory routine sweep times next: a variant, a size and whether
+ * the destination and source are 1 and 3 bytes off alignment */
+static const uint32_t perf_mem_sizes[] = { 8, 64, 512, 4096, 65536, PERF_MEM_MAX };
+static const int8_t* perf_mem_size_names[] = { "8", "64", "512", "4k", "64k", "4m" };
+#define PERF_MEM_SIZES (sizeof(perf_mem_sizes) / sizeof(perf_mem_sizes[0]))
+static const mem_ops_t* perf_mem;
+static uint32_t perf_mem_size;
+static uint32_t perf_mem_skewed;
+
+/* perf_init
+ * DESCRIPTION: turns benchmark mode on if the command line asks for it
+ * INPUTS: cmdline -- multiboot command line, NULL if there is none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: from now on console output also goes to COM1
+ */
+void perf_init(const int8_t* cmdline) {
+    if (cmdline == NULL || !cmdline_has(cmdline, "perf"))
+        return;
+    perf_on = 1;
+    serial_mirror = 1;
+}
+
+int32_t perf_enabled(void) {
+    return perf_on;
+}
+
+/* perf_report
+ * DESCRIPTION: prints one result line for perf/perfcheck.sh
+ * INPUTS: name -- no blanks, value, unit -- no blanks
+ * OUTPUTS: the line on the console (and COM1)
+ * RETURN VALUE: none
+ */
+void perf_report(const int8_t* name, uint32_t value, const int8_t* unit) {
+    printf("PERF %s %u %s\n", name, value, unit);
+}
+
+/* perf_run
+ * DESCRIPTION: runs a benchmark PERF_REPS times and reports the fastest
+ *              run, divided by its units
+ * INPUTS: name, unit, bench
+ * OUTPUTS: a result line
+ * RETURN VALUE: none
+ */
+static void perf_run(const int8_t* name, const int8_t* unit, perf_bench_t bench) {
+    uint32_t i, cycles, units, best = 0xFFFFFFFF, best_units = 1;
+
+    for (i = 0; i < PERF_REPS; i++) {
+        units = 0;
+        cycles = bench(&units);
+        if (units != 0 && cycles < best) {
+            best = cycles;
+            best_units = units;
+        }
+    }
+    if (best != 0xFFFFFFFF)
+        perf_report(name, best / best_units, unit);
+}
+
+/* cycles since start, runs are kept well below 2^32 cycles */
+static uint32_t perf_elapsed(uint64_t start) {
+    uint64_t now;
+
+    rdtsc(now);
+    return (uint32_t)(now - start);
+}
+
+static uint32_t bench_memcpy_4k(uint32_t* units) {
+    uint64_t start;
+    uint32_t i;
+
+    rdtsc(start);
+    for (i = 0; i < PERF_BUF_SIZE / 4096; i++)
+        memcpy(perf_dst + i * 4096, perf_src + i * 4096, 4096);
+    *units = PERF_BUF_SIZE / 1024;
+    return perf_elapsed(start);
+}
+
+static uint32_t bench_memcpy_64k(uint32_t* units) {
+    uint64_t start;
+
+    rdtsc(start);
+    memcpy(perf_dst, perf_src, PERF_BUF_SIZE);
+    *units = PERF_BUF_SIZE / 1024;
+    return perf_elapsed(start);
+}
+
+static uint32_t bench_memcpy_unaligned(uint32_t* units) {
+    uint64_t start;
+
+    rdtsc(start);
+    memcpy(perf_dst + 1, perf_src + 3, PERF_BUF_SIZE - 4);
+    *units = PERF_BUF_SIZE / 1024;
+    return perf_elapsed(start);
+}
+
+static uint32_t bench_memset_64k(uint32_t* units) {
+    uint64_t start;
+
+    rdtsc(start);
+    memset(perf_dst, 0x5A, PERF_BUF_SIZE);
+    *units = PERF_BUF_SIZE / 1024;
+    return perf_elapsed(start);
+}
+
+/* perf_mem_calls
+ * DESCRIPTION: how many times a sweep run calls the routine, so that even
+ *              the small sizes take long enough to time
+ * INPUTS: none
+ * OUTPUTS: the count in *units too, results are per call
+ * RETURN VALUE: the count
+ */
+static uint32_t perf_mem_calls(uint32_t* units) {
+    *units = perf_mem_size < PERF_MEM_BYTES ? PERF_MEM_BYTES / perf_mem_size : 1;
+    return *units;
+}
+
+static uint32_t bench_mem_copy(uint32_t* units) {
+    uint8_t* dst = (uint8_t*)PERF_MEM_DST + (perf_mem_skewed ? 1 : 0);
+    uint8_t* src = (uint8_t*)PERF_MEM_SRC + (perf_mem_skewed ? 3 : 0);
+    uint64_t start;
+    uint32_t i, calls = perf_mem_calls(units);
+
+    rdtsc(start);
+    for (i = 0; i < calls; i++)
+        perf_mem->copy(dst, src, perf_mem_size);
+    return perf_elapsed(start);
+}
+
+static uint32_t bench_mem_set(uint32_t* units) {
+    uint8_t* dst = (uint8_t*)PERF_MEM_DST + (perf_mem_skewed ? 1 : 0);
+    uint64_t start;
+    uint32_t i, calls = perf_mem_calls(units);
+
+    rdtsc(start);
+    for (i = 0; i < calls; i++)
+        perf_mem->set(dst, 0x5A, perf_mem_size);
+    return perf_elapsed(start);
+}
+
+/* perf_mem_sweep
+ * DESCRIPTION: times every one of mem_variants at every size, aligned and
+ *              not, as <prefix>_<variant>_<size>[_u] in cycles per call.
+ *              Where one variant stops beating another is the size to
+ *              switch at, see MEM_SMALL and cpu_init
+ * INPUTS: prefix -- k_memcpy or k_memset, bench -- the matching benchmark
+ * OUTPUTS: result lines, by size then variant
+ * RETURN VALUE: none
+ */
+static void perf_mem_sweep(const int8_t* prefix, perf_bench_t bench) {
+    int8_t name[32];
+    uint32_t size, variant;
+
+    for (size = 0; size < PERF_MEM_SIZES; size++) {
+        perf_mem_size = perf_mem_sizes[size];
+        for (perf_mem_skewed = 0; perf_mem_skewed < 2; perf_mem_skewed++) {
+            for (variant = 0; variant < MEM_VARIANTS; variant++) {
+                perf_mem = &mem_variants[variant];
+                snprintf(name, sizeof(name), "%s_%s_%s%s", prefix, perf_mem->name,
+                         perf_mem_size_names[size], perf_mem_skewed ? "_u" : "");
+                perf_run(name, "cycles/op", bench);
+            }
+        }
+    }
+}
+
+/* a line of the kind procfs and the boot messages format */
+static uint32_t bench_snprintf(uint32_t* units) {
+    int8_t line[80];
+    uint64_t start;
+    uint32_t i;
+
+    rdtsc(start);
+    for (i = 0; i < 64; i++)
+        snprintf(line, sizeof(line), "%5u%6u %-8s%9u %s\n", i, 1, "run", i * 100, "shell");
+    *units = 64;
+    return perf_elapsed(start);
+}
+
+static uint32_t bench_lookup(uint32_t* units) {
+    dentry_t dentry;
+    uint64_t start;
+    uint32_t i;
+
+    rdtsc(start);
+    for (i = 0; i < perf_name_count; i++)
+        read_dentry_by_name(perf_names[i], &dentry);
+    *units = perf_name_count;
+    return perf_elapsed(start);
+}
+
+/* every regular file, PERF_BUF_SIZE at a time */
+static uint32_t bench_read(uint32_t* units) {
+    dentry_t dentry;
+    uint64_t start;
+    uint32_t i, offset, bytes = 0;
+    int32_t n;
+
+    rdtsc(start);
+    for (i = 0; read_dentry_by_index(i, &dentry) == 0; i++) {
+        if (dentry.filetype != FILE_TYPE_FILE)
+            continue;
+        for (offset = 0; (n = read_data(dentry.inode_num, offset, perf_dst, PERF_BUF_SIZE)) > 0; offset += n)
+            bytes += n;
+    }
+    *units = bytes / 1024;
+    return perf_elapsed(start);
+}
+
+/* 64 bytes every 4093, so the reads land all over the blocks */
+static uint32_t bench_read_small(uint32_t* units) {
+    dentry_t dentry;
+    uint64_t start;
+    uint32_t i, offset, length, reads = 0;
+
+    rdtsc(start);
+    for (i = 0; read_dentry_by_index(i, &dentry) == 0; i++) {
+        if (dentry.filetype != FILE_TYPE_FILE)
+            continue;
+        length = flength(dentry.inode_num);
+        for (offset = 0; offset < length; offset += 4093, reads++)
+            read_data(dentry.inode_num, offset, perf_dst, 64);
+    }
+    *units = reads;
+    return perf_elapsed(start);
+}
+
+/* perf_kernel_bench
+ * DESCRIPTION: times the lib.c copy routines, each of the variants mem_ops
+ *              can pick from, and the file system read paths, before the
+ *              scheduler starts so nothing preempts them
+ * INPUTS: none
+ * OUTPUTS: result lines
+ * RETURN VALUE: none
+ */
+void perf_kernel_bench(void) {
+    dentry_t dentry;
+    uint32_t i;
+
+    for (i = 0; i < PERF_BUF_SIZE; i++)
+        perf_src[i] = i * 7;
+    perf_name_count = 0;
+    for (i = 0; perf_name_count < PERF_NAMES && read_dentry_by_index(i, &dentry) == 0; i++) {
+        if (dentry.filename[0] == '\0')
+            continue;
+        strncpy((int8_t*)perf_names[perf_name_count], dentry.filename, FILENAME_LEN);
+        perf_names[perf_name_count++][FILENAME_LEN] = '\0';
+    }
+
+    perf_run("k_memcpy_4k", "cycles/KB", bench_memcpy_4k);
+    perf_run("k_memcpy_64k", "cycles/KB", bench_memcpy_64k);
+    perf_run("k_memcpy_unaligned", "cycles/KB", bench_memcpy_unaligned);
+    perf_run("k_memset_64k", "cycles/KB", bench_memset_64k);
+
+    for (i = 0; i < PERF_MEM_PAGES; i++) {
+        update_page_directory(PERF_MEM_SRC + i * C_4MB, PERF_MEM_SRC + i * C_4MB, KERNEL_PDE_4MB);
+        update_page_directory(PERF_MEM_DST + i * C_4MB, PERF_MEM_DST + i * C_4MB, KERNEL_PDE_4MB);
+    }
+    memset((void*)PERF_MEM_SRC, 0xA5, PERF_MEM_PAGES * C_4MB);
+    perf_mem_sweep("k_memcpy", bench_mem_copy);
+    perf_mem_sweep("k_memset", bench_mem_set);
+    for (i = 0; i < PERF_MEM_PAGES; i++) {
+        update_page_directory(PERF_MEM_SRC + i * C_4MB, 0, 0);
+        update_page_directory(PERF_MEM_DST + i * C_4MB, 0, 0);
+    }
+    perf_run("k_snprintf", "cycles/op", bench_snprintf);
+    perf_run("k_fs_lookup", "cycles/op", bench_lookup);
+    perf_run("k_fs_read", "cycles/KB", bench_read);
+    perf_run("k_fs_read_64b", "cycles/op", bench_read_small);
+}
+
+/* perf_root
+ * DESCRIPTION: takes the place of the root shell in benchmark mode. The
+ *              first call starts PERF_PROGRAM, the next (once it halted)
+ *              ends the run
+ * INPUTS: none
+ * OUTPUTS: PERF_DONE once everything ran
+ * RETURN VALUE: none
+ * SIDE EFFECTS: exits QEMU if it has an isa-debug-exit device, otherwise
+ *               the kernel idles
+ */
+void perf_root(void) {
+    uint8_t command[] = PERF_PROGRAM;
+
+    if (perf_stage == 0) {
+        perf_stage = 1;
+        if (spawn_process(command) >= 0)
+            return;
+        printf("PERF_ERROR cannot run %s\n", command);
+    }
+    if (perf_stage == 1) {
+        perf_stage = 2;
+        printf("PERF_DONE\n");
+        serial_flush();
+        outb(0, QEMU_EXIT_PORT);
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PERF_H_
+#define PERF_H_
+
+#include "types.h"
+
+/* A boot with "perf" on the multiboot command line is a benchmark run for
+ * perf/perfcheck.sh: console output is copied to COM1, the kernel times
+ * itself, then PERF_PROGRAM runs once as the root program instead of the
+ * shell and QEMU is told to exit. Results are lines of
+ *     PERF <name> <value> <unit>
+ * where a lower value is better, and the run ends with PERF_DONE */
+#define PERF_PROGRAM        "perfbench"
+#define PERF_REPS           5           /* a result is the best of this many runs */
+#define PERF_BUF_SIZE       (64 * 1024)
+#define PERF_NAMES          64          /* names timed by the lookup benchmark */
+#define QEMU_EXIT_PORT      0xF4        /* isa-debug-exit device */
+
+/* The sweep of the lib.c memory routines copies up to PERF_MEM_MAX bytes
+ * from PERF_MEM_SRC to PERF_MEM_DST: the program pages of process slots 0
+ * to 3, which nothing uses before the first program starts. Sizes below
+ * PERF_MEM_BYTES are repeated until that much was copied */
+#define PERF_MEM_MAX        (4 * 1024 * 1024)
+#define PERF_MEM_PAGES      2           /* 4MB pages mapped for each */
+#define PERF_MEM_SRC        paging_user_frame(0)
+#define PERF_MEM_DST        paging_user_frame(PERF_MEM_PAGES)
+#define PERF_MEM_BYTES      (256 * 1024)
+
+extern void perf_init(const int8_t* cmdline);
+extern int32_t perf_enabled(void);
+extern void perf_report(const int8_t* name, uint32_t value, const int8_t* unit);
+extern void perf_kernel_bench(void);
+extern void perf_root(void);
+
+#endif
@@ -0,0 +1,216 @@
+#include "pipe.h"
+#include "syscalls.h"
+#include "scheduler.h"
+
+/* An anonymous pipe: a ring buffer plus the tasks blocked on either side.
+ * A pipe is free when nobody holds either end */
+typedef struct pipe_t {
+    uint8_t* buf;
+    uint32_t head;                  /* index of the next byte to read */
+    uint32_t count;                 /* bytes in the buffer */
+    uint32_t readers;               /* open read ends */
+    uint32_t writers;               /* open write ends */
+    wait_queue_t read_queue;        /* readers waiting for data */
+    wait_queue_t write_queue;       /* writers waiting for room */
+} pipe_t;
+
+static uint8_t pipe_buffers[NUM_PIPES][PIPE_BUF_SIZE] __attribute__((aligned(PIPE_BUF_SIZE)));
+static pipe_t pipes[NUM_PIPES];
+
+/* pipe
+ * DESCRIPTION: system call for pipe, creates a pipe and opens both ends
+                in the caller's file array
+ * INPUTS: fds -- user array of two fds
+ * OUTPUTS: fds[0] = read end, fds[1] = write end
+ * RETURN VALUE: 0 on success, -1 if fds is bad or no pipe or fd is free
+ * SIDE EFFECTS: takes two entries of the file array
+ */
+int32_t pipe(int32_t* fds) {
+    uint32_t flags;
+    uint32_t i;
+    int32_t rfd, wfd;
+
+    if (bad_userspace_addr(fds, 2 * sizeof(int32_t)))
+        return -1;
+
+    cli_and_save(flags);
+    for (i = 0; i < NUM_PIPES; i++) {
+        if (pipes[i].readers == 0 && pipes[i].writers == 0)
+            break;
+    }
+    if (i == NUM_PIPES) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    if ((rfd = pipe_fd_open(i, PIPE_READ_END)) == -1) {
+        restore_flags(flags);
+        return -1;
+    }
+    if ((wfd = pipe_fd_open(i, PIPE_WRITE_END)) == -1) {
+        file_close(rfd);
+        restore_flags(flags);
+        return -1;
+    }
+
+    pipes[i].buf = pipe_buffers[i];
+    pipes[i].head = 0;
+    pipes[i].count = 0;
+    pipes[i].readers = 1;
+    pipes[i].writers = 1;
+    restore_flags(flags);
+
+    fds[0] = rfd;
+    fds[1] = wfd;
+    return 0;
+}
+
+/* pipe_open
+ * DESCRIPTION: pipes have no name, they are only made by pipe()
+ * INPUTS: filename -- ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_open(const uint8_t* filename) {
+    return -1;
+}
+
+/* pipe_read
+ * DESCRIPTION: reads what is buffered, up to nbytes, blocking while the
+                pipe is empty and a write end is still open
+ * INPUTS: fd -- read end, buf -- destination, nbytes -- most bytes to read
+ * OUTPUTS: fills buf
+ * RETURN VALUE: bytes read, 0 at end of file, -1 on failure
+ * SIDE EFFECTS: wakes writers blocked on a full pipe
+ */
+int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    pipe_t* p = &pipes[file->inode_num];
+    uint32_t flags;
+    uint32_t n, first;
+
+    if (file->file_position != PIPE_READ_END || nbytes < 0)
+        return -1;
+    /* a zero-length read tells a program its input is a pipe */
+    if (nbytes == 0)
+        return 0;
+    if (buf == NULL)
+        return -1;
+
+    cli_and_save(flags);
+    while (p->count == 0) {
+        if (p->writers == 0) {
+            restore_flags(flags);
+            return 0;
+        }
+        wait_queue_sleep(&p->read_queue, 0);
+    }
+
+    n = (p->count < (uint32_t)nbytes) ? p->count : (uint32_t)nbytes;
+    /* at most two pieces, before and after the wrap */
+    first = PIPE_BUF_SIZE - p->head;
+    if (first > n)
+        first = n;
+    memcpy(buf, p->buf + p->head, first);
+    memcpy((uint8_t*)buf + first, p->buf, n - first);
+    p->head = (p->head + n) & (PIPE_BUF_SIZE - 1);
+    p->count -= n;
+
+    wait_queue_wake_all(&p->write_queue);
+    restore_flags(flags);
+    return n;
+}
+
+/* pipe_write
+ * DESCRIPTION: appends nbytes to the pipe, blocking while it is full
+ * INPUTS: fd -- write end, buf -- source, nbytes -- bytes to write
+ * OUTPUTS: none
+ * RETURN VALUE: bytes written, -1 if nothing could be written because
+                 every read end is closed
+ * SIDE EFFECTS: wakes readers blocked on an empty pipe
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    pipe_t* p = &pipes[file->inode_num];
+    uint32_t flags;
+    uint32_t written = 0;
+    uint32_t tail, n;
+
+    if (file->file_position != PIPE_WRITE_END || nbytes < 0)
+        return -1;
+    if (buf == NULL && nbytes > 0)
+        return -1;
+
+    cli_and_save(flags);
+    while (written < (uint32_t)nbytes) {
+        if (p->readers == 0)
+            break;
+        if (p->count == PIPE_BUF_SIZE) {
+            wait_queue_sleep(&p->write_queue, 0);
+            continue;
+        }
+
+        /* largest piece that fits without wrapping */
+        tail = (p->head + p->count) & (PIPE_BUF_SIZE - 1);
+        n = nbytes - written;
+        if (n > PIPE_BUF_SIZE - p->count)
+            n = PIPE_BUF_SIZE - p->count;
+        if (n > PIPE_BUF_SIZE - tail)
+            n = PIPE_BUF_SIZE - tail;
+        memcpy(p->buf + tail, (const uint8_t*)buf + written, n);
+        p->count += n;
+        written += n;
+
+        wait_queue_wake_all(&p->read_queue);
+    }
+    restore_flags(flags);
+
+    if (written == 0 && nbytes > 0)
+        return -1;
+    return written;
+}
+
+/* pipe_close
+ * DESCRIPTION: drops one end of the pipe. Blocked readers see end of file
+                once the last write end goes, blocked writers fail once the
+                last read end goes
+ * INPUTS: fd -- pipe end to close
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: frees the file array entry, and the pipe with the last end
+ */
+int32_t pipe_close(int32_t fd) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    pipe_t* p = &pipes[file->inode_num];
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (file->file_position == PIPE_READ_END)
+        p->readers--;
+    else
+        p->writers--;
+    wait_queue_wake_all(&p->read_queue);
+    wait_queue_wake_all(&p->write_queue);
+    file_close(fd);
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_ref
+ * DESCRIPTION: counts another holder of one end of a pipe
+ * INPUTS: pipe -- pipe index, end -- PIPE_READ_END or PIPE_WRITE_END
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void pipe_ref(uint32_t pipe, uint32_t end) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (end == PIPE_READ_END)
+        pipes[pipe].readers++;
+    else
+        pipes[pipe].writers++;
+    restore_flags(flags);
+}
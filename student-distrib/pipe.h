@@ -0,0 +1,25 @@
+#ifndef PIPE_H_
+#define PIPE_H_
+
+#include "types.h"
+
+#define NUM_PIPES       8       /* pipes open at once, system wide */
+#define PIPE_BUF_SIZE   4096    /* one page of ring buffer per pipe, power of 2 */
+
+/* file_t.file_position of a pipe end tells which end it is */
+#define PIPE_READ_END   0
+#define PIPE_WRITE_END  1
+
+/* pipe system call, fds[0] is the read end and fds[1] the write end */
+extern int32_t pipe(int32_t* fds);
+
+/* ops of an open pipe end, see pipe_ops in filesys.c */
+extern int32_t pipe_open(const uint8_t* filename);
+extern int32_t pipe_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t pipe_close(int32_t fd);
+
+/* counts one more holder of an end, for fds copied into a child */
+extern void pipe_ref(uint32_t pipe, uint32_t end);
+
+#endif
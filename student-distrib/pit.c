@@ -0,0 +1,50 @@
+
+#include "pit.h"
+#include "i8259.h"
+#include "scheduler.h"
+#include "syscalls.h"
+
+/* local variables declared */
+uint32_t pit_tick_count = 0;
+uint32_t pit_idle_ticks = 0;	/* ticks that found the idle loop running */
+
+/* pit_init()
+*	DESCRIPTION: programs channel 0 of the PIT to fire PIT_FREQ times a second
+*	INPUT: none
+*	OUTPUT: none
+*	RETURN VALUE: none
+*	SIDE EFFECTS: unmasks IRQ0, the scheduler starts preempting tasks
+*/
+void pit_init(void){
+	uint32_t divisor = PIT_BASE_FREQ / PIT_FREQ;
+
+	outb(PIT_MODE3, PIT_CMD_PORT);
+	outb(divisor & 0xFF, PIT_CHANNEL0);			/* low byte of divisor */
+	outb((divisor >> 8) & 0xFF, PIT_CHANNEL0);	/* high byte of divisor */
+
+	pit_tick_count = 0;
+	pit_idle_ticks = 0;
+	enable_irq(PIT_IRQ);
+}
+
+/* pit_interrupt_handler()
+*	DESCRIPTION: acknowledges the timer and gives the cpu to the next task
+*	INPUT: none
+*	OUTPUT: none
+*	RETURN VALUE: none
+*	SIDE EFFECTS: may switch to another task before returning, charges
+*				  the tick to the task it interrupted
+*/
+void pit_interrupt_handler(void){
+	pit_tick_count++;
+	if (curr_process == PID_NONE)
+		pit_idle_ticks++;
+	else
+		getProcessPCB(curr_process)->ticks++;
+
+	/* EOI has to go out before the switch, the next task returns
+	 * through its own interrupt frame */
+	send_eoi(PIT_IRQ);
+	irq_exit(PIT_IRQ);
+	schedule();
+}
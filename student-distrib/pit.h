@@ -0,0 +1,27 @@
+#ifndef _PIT_H
+#define _PIT_H
+#include "lib.h"
+
+/* DECLARATION OF CONSTANTS TO USE */
+#define PIT_CHANNEL0	0x40
+#define PIT_CMD_PORT	0x43
+#define PIT_MODE3		0x36		/* channel 0, lo/hi byte, square wave */
+#define PIT_BASE_FREQ	1193182		/* input clock of the 8253/8254 in Hz */
+#define PIT_FREQ		100			/* scheduler ticks per second */
+#define PIT_IRQ			0
+
+/* ticks since pit_init, and those of them that found no task running */
+extern uint32_t pit_tick_count;
+extern uint32_t pit_idle_ticks;
+
+/* FUNCTIONS DECLARED */
+
+/* defined in interr.S */
+extern void pit_handler(void);
+
+/* programs channel 0 and unmasks IRQ0 */
+void pit_init(void);
+/* handles interrupt for pit, runs the scheduler */
+void pit_interrupt_handler(void);
+
+#endif
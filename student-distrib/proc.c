@@ -0,0 +1,346 @@
+#include "proc.h"
+#include "lib.h"
+#include "filesys.h"
+#include "syscalls.h"
+#include "i8259.h"
+#include "paging.h"
+#include "pit.h"
+#include "rtc.h"
+#include "cpu.h"
+
+#define PROC_PREFIX_LEN     5           /* "proc/" */
+
+/* text being made up for a read; whatever does not fit is cut off */
+typedef struct proc_buf_t {
+    int8_t* buf;
+    int32_t len;
+    int32_t size;
+} proc_buf_t;
+
+typedef void (*proc_gen_t)(proc_buf_t* out);
+
+typedef struct proc_file_t {
+    const int8_t* name;
+    proc_gen_t gen;
+} proc_file_t;
+
+static void proc_ps(proc_buf_t* out);
+static void proc_fds(proc_buf_t* out);
+static void proc_irq(proc_buf_t* out);
+static void proc_rtc(proc_buf_t* out);
+static void proc_mem(proc_buf_t* out);
+static void proc_uptime(proc_buf_t* out);
+static void proc_cpu(proc_buf_t* out);
+
+static const proc_file_t proc_files[] = {
+    { PROC_DIRNAME, NULL },             /* PROC_DIR */
+    { "proc/ps", proc_ps },
+    { "proc/fds", proc_fds },
+    { "proc/irq", proc_irq },
+    { "proc/rtc", proc_rtc },
+    { "proc/mem", proc_mem },
+    { "proc/uptime", proc_uptime },
+    { "proc/cpu", proc_cpu },
+};
+#define PROC_FILES (sizeof(proc_files) / sizeof(proc_files[0]))
+
+static const int8_t* task_states[] = { "run", "blocked", "zombie" };
+static const int8_t* file_types[] = {
+    "rtc", "dir", "file", "pipe", "terminal", "serial", "trace", "sysstat", "proc", "profile", "kmsg"
+};
+static const int8_t* irq_names[NUM_IRQ_LINES] = {
+    "pit", "keyboard", "", "", "serial", "", "", "", "rtc"
+};
+
+/* read buffer, filled and copied out with interrupts off */
+static int8_t proc_buf[PROC_BUF_SIZE];
+
+/* proc_printf
+ * DESCRIPTION: appends formatted text, see printf in lib.c
+ * INPUTS: out, format, its arguments
+ * OUTPUTS: the text in out, cut off one short of the end of the buffer
+ * RETURN VALUE: none
+ */
+static void proc_printf(proc_buf_t* out, const int8_t* format, ...) {
+    va_list ap;
+    int32_t room = out->size - out->len, len;
+
+    if (room <= 0)
+        return;
+    va_start(ap, format);
+    len = vsnprintf(out->buf + out->len, room, format, ap);
+    va_end(ap);
+    out->len += len < room ? len : room - 1;
+}
+
+/* proc_value
+ * DESCRIPTION: appends a "name value" line
+ * INPUTS: out, name, value
+ * OUTPUTS: the line in out
+ * RETURN VALUE: none
+ */
+static void proc_value(proc_buf_t* out, const int8_t* name, uint32_t value) {
+    proc_printf(out, "%-15s%10u\n", name, value);
+}
+
+/* proc_ps
+ * DESCRIPTION: a line per task slot in use, threads included
+ */
+static void proc_ps(proc_buf_t* out) {
+    pcb_t* pcb;
+    uint32_t pid;
+
+    proc_printf(out, "  PID  PPID OWNER TTY STATE        TICKS NAME\n");
+    for (pid = 0; pid < NUM_MAX_PROCESSES; pid++) {
+        if (pid_array[pid] == PROG_NOT_ACTIVE)
+            continue;
+        pcb = getProcessPCB(pid);
+        proc_printf(out, "%5u", pid);
+        if (pcb->parent_num == PID_NONE)
+            proc_printf(out, "     -");
+        else
+            proc_printf(out, "%6u", pcb->parent_num);
+        proc_printf(out, "%6u%4u %-8s%9u %s%s\n", pcb->owner, pcb->terminal_index,
+                    pcb->state <= TASK_ZOMBIE ? task_states[pcb->state] : "?",
+                    pcb->ticks, pcb->name, pid == curr_process ? " *" : "");
+    }
+}
+
+/* proc_fds
+ * DESCRIPTION: a line per open file of each process; threads share the
+ *              files of their owner, so they are not listed again
+ */
+static void proc_fds(proc_buf_t* out) {
+    pcb_t* pcb;
+    uint32_t pid, fd, type;
+
+    proc_printf(out, "  PID  FD TYPE      INODE        POS\n");
+    for (pid = 0; pid < NUM_MAX_PROCESSES; pid++) {
+        if (pid_array[pid] == PROG_NOT_ACTIVE)
+            continue;
+        pcb = getProcessPCB(pid);
+        if (pcb->owner != pid || pcb->state == TASK_ZOMBIE)
+            continue;
+        for (fd = 0; fd < NUM_MAX_OPEN_FILES; fd++) {
+            if (pcb->files[fd].flags == FILE_AVAIL)
+                continue;
+            type = file_type_of(&pcb->files[fd]);
+            proc_printf(out, "%5u%4u %-8s%7u%11u\n", pid, fd,
+                        type <= FILE_TYPE_KMSG ? file_types[type] : "?",
+                        pcb->files[fd].inode_num, pcb->files[fd].file_position);
+        }
+    }
+}
+
+/* proc_irq
+ * DESCRIPTION: a line per IRQ line that has fired: interrupts, cycles in
+ *              the handler in all (in units of 1024), on average and at
+ *              most; then the longest time interrupts were masked by
+ *              cli_and_save and the file and line that masked them
+ */
+static void proc_irq(proc_buf_t* out) {
+    uint32_t irq;
+
+    proc_printf(out, "IRQ      COUNT    KCYCLES      AVG      MAX NAME\n");
+    for (irq = 0; irq < NUM_IRQ_LINES; irq++) {
+        if (irq_counts[irq] == 0)
+            continue;
+        proc_printf(out, "%3u%11u%11u%9u%9u %s\n", irq, irq_counts[irq],
+                    (uint32_t)(irq_cycles[irq] >> 10), irq_avg_cycles(irq),
+                    irq_max_cycles[irq], irq_names[irq] != NULL ? irq_names[irq] : "");
+    }
+    proc_printf(out, "irqoff_max_cycles %u", irqoff_max_cycles);
+    if (irqoff_max_file != NULL)
+        proc_printf(out, " %s:%u", irqoff_max_file, irqoff_max_line);
+    proc_printf(out, "\n");
+}
+
+static void proc_rtc(proc_buf_t* out) {
+    proc_value(out, "rtc_call_count", rtc_call_count);
+}
+
+/* proc_mem
+ * DESCRIPTION: the frame pool (page tables, heaps, mmap, shm, pipes) and
+ *              the 4MB program pages of the processes
+ */
+static void proc_mem(proc_buf_t* out) {
+    uint32_t total, used, pid, programs = 0;
+
+    frame_pool_stats(&total, &used);
+    for (pid = 0; pid < NUM_MAX_PROCESSES; pid++)
+        if (pid_array[pid] != PROG_NOT_ACTIVE && getProcessPCB(pid)->owner == pid)
+            programs++;
+
+    proc_value(out, "pool_total_kb", total * 4);
+    proc_value(out, "pool_used_kb", used * 4);
+    proc_value(out, "pool_free_kb", (total - used) * 4);
+    proc_value(out, "program_kb", programs * (C_4MB / 1024));
+}
+
+/* proc_uptime
+ * DESCRIPTION: "<ticks> <idle ticks> <ticks per second>", for top
+ */
+static void proc_uptime(proc_buf_t* out) {
+    proc_printf(out, "%u %u %u\n", pit_tick_count, pit_idle_ticks, PIT_FREQ);
+}
+
+/* proc_cpu
+ * DESCRIPTION: what cpu_init found and the memory routines it picked
+ */
+static void proc_cpu(proc_buf_t* out) {
+    uint32_t i;
+
+    proc_printf(out, "%-10s%s\n", "vendor", cpu_info.vendor);
+    proc_printf(out, "%-10s%u\n", "family", cpu_info.family);
+    proc_printf(out, "%-10s%u\n", "model", cpu_info.model);
+    proc_printf(out, "%-10s%u\n", "stepping", cpu_info.stepping);
+    proc_printf(out, "%-10s", "flags");
+    for (i = 0; i < CPU_FEATURES; i++)
+        if (cpu_info.features & (1 << i))
+            proc_printf(out, "%s ", cpu_feature_names[i]);
+    proc_printf(out, "\n%-10s%s, %s below %u bytes\n", "memcpy", mem_ops->name,
+                mem_variants[MEM_LOOP].name, MEM_SMALL);
+}
+
+/* proc_lookup
+ * DESCRIPTION: finds a proc file by its full name
+ * INPUTS: filename
+ * OUTPUTS: none
+ * RETURN VALUE: PROC_DIR for "proc", the entry of a file, -1 if it is not
+ *               a proc file
+ * SIDE EFFECTS: none
+ */
+int32_t proc_lookup(const uint8_t* filename) {
+    uint32_t i;
+
+    for (i = 0; i < PROC_FILES; i++)
+        if (strncmp((int8_t*)filename, proc_files[i].name, FILENAME_LEN) == 0)
+            return i;
+    return -1;
+}
+
+/* proc_text
+ * DESCRIPTION: makes up the text of a proc file
+ * INPUTS: entry -- from proc_lookup, buf, size
+ * OUTPUTS: the text in buf, not NUL terminated, cut off at size - 1
+ * RETURN VALUE: its length, -1 if entry is not a file
+ * SIDE EFFECTS: none
+ */
+int32_t proc_text(int32_t entry, int8_t* buf, int32_t size) {
+    proc_buf_t out;
+
+    if (entry <= PROC_DIR || entry >= (int32_t)PROC_FILES || buf == NULL || size < 0)
+        return -1;
+    out.buf = buf;
+    out.len = 0;
+    out.size = size;
+    proc_files[entry].gen(&out);
+    return out.len;
+}
+
+/* proc_open, proc_close
+ * DESCRIPTION: nothing is kept between reads but the file position;
+ *              close gives the fd back
+ * RETURN VALUE: 0, -1 if fd is not open
+ */
+int32_t proc_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t proc_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* proc_read
+ * DESCRIPTION: reads a proc file from the file position. The text is made
+ *              up again for each read, so read it in one go for a
+ *              consistent picture. On "proc" each read returns the next
+ *              name, as directory_read does
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: text in buf
+ * RETURN VALUE: bytes read, 0 at the end, -1 if buf is NULL or nbytes
+ *               negative
+ * SIDE EFFECTS: advances the file position
+ */
+int32_t proc_read(int32_t fd, void* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    const int8_t* name;
+    int32_t len, n;
+    uint32_t flags;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+
+    if (file->inode_num == PROC_DIR) {
+        if (file->file_position + 1 >= (int32_t)PROC_FILES)
+            return 0;
+        name = proc_files[++file->file_position].name + PROC_PREFIX_LEN;
+        for (n = 0; n < nbytes && name[n] != '\0'; n++)
+            ((int8_t*)buf)[n] = name[n];
+        return n;
+    }
+
+    cli_and_save(flags);
+    len = proc_text(file->inode_num, proc_buf, PROC_BUF_SIZE);
+    n = len - file->file_position;
+    if (n > nbytes)
+        n = nbytes;
+    if (n < 0)
+        n = 0;
+    memcpy(buf, proc_buf + file->file_position, n);
+    restore_flags(flags);
+
+    file->file_position += n;
+    return n;
+}
+
+/* proc_write
+ * DESCRIPTION: the proc files are read only
+ * RETURN VALUE: -1
+ */
+int32_t proc_write(int32_t fd, const void* buf, int32_t nbytes) {
+    return -1;
+}
+
+/* proc_getdents
+ * DESCRIPTION: getdents on "proc", dirent_t records of the files after
+ *              the file position
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: packed records in buf
+ * RETURN VALUE: bytes filled, 0 at the end, -1 if fd is not "proc" or the
+ *               next record does not fit
+ * SIDE EFFECTS: moves the fd past the entries returned
+ */
+int32_t proc_getdents(int32_t fd, uint8_t* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    const int8_t* name;
+    dirent_t* rec;
+    uint32_t namelen, reclen;
+    int32_t filled = 0;
+
+    if (file->inode_num != PROC_DIR || buf == NULL || nbytes < 0)
+        return -1;
+
+    while (file->file_position + 1 < (int32_t)PROC_FILES) {
+        name = proc_files[file->file_position + 1].name + PROC_PREFIX_LEN;
+        namelen = strlen(name);
+        reclen = (sizeof(dirent_t) + namelen + 1 + 3) & ~3;
+        if (filled + reclen > nbytes)
+            break;
+
+        rec = (dirent_t*)(buf + filled);
+        rec->inode_num = file->file_position + 1;
+        rec->size = 0;
+        rec->reclen = reclen;
+        rec->filetype = FILE_TYPE_PROC;
+        rec->namelen = namelen;
+        memcpy(rec->name, name, namelen + 1);
+
+        filled += reclen;
+        file->file_position++;
+    }
+
+    if (filled == 0 && file->file_position + 1 < (int32_t)PROC_FILES)
+        return -1;
+    return filled;
+}
@@ -0,0 +1,32 @@
+#ifndef PROC_H_
+#define PROC_H_
+
+#include "types.h"
+
+/* Read-only text files made up on every read, like /proc. "proc" itself
+ * reads as a directory of the file names without the "proc/" in front;
+ * the files are opened by their full names:
+ *     proc/ps      task table: pid, parent, owner, terminal, state, ticks
+ *     proc/fds     open files of every process
+ *     proc/irq     interrupts, handler cycles and longest masked section
+ *     proc/rtc     RTC interrupts since boot
+ *     proc/mem     frame pool and program pages in use
+ *     proc/uptime  PIT ticks, ticks spent idle, ticks per second
+ *     proc/cpu     CPUID vendor, model and features, memory routines used */
+#define PROC_DIRNAME        "proc"
+#define PROC_DIR            0           /* proc_lookup result for "proc" */
+#define PROC_BUF_SIZE       4096        /* longest text a file can have */
+
+extern int32_t proc_lookup(const uint8_t* filename);
+
+/* ops of the proc files, see proc_ops in filesys.c */
+extern int32_t proc_open(const uint8_t* filename);
+extern int32_t proc_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t proc_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t proc_close(int32_t fd);
+extern int32_t proc_getdents(int32_t fd, uint8_t* buf, int32_t nbytes);
+
+/* text of entry, as a read from the start would return it */
+extern int32_t proc_text(int32_t entry, int8_t* buf, int32_t size);
+
+#endif
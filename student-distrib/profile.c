@@ -0,0 +1,236 @@
+#include "profile.h"
+#include "lib.h"
+#include "paging.h"
+#include "serial.h"
+#include "syscalls.h"
+
+/* samples are only ever added by pit_handler, with interrupts off, and
+ * taken with interrupts off; head counts those recorded since the start,
+ * tail those drained */
+int32_t profile_on = 0;
+static profile_sample_t samples[PROFILE_SAMPLES];
+static uint32_t head;
+static uint32_t tail;
+static uint32_t lost;
+static uint8_t prog_names[PROFILE_PROGS][TASK_NAME_LEN];
+static uint32_t prog_count;
+
+/* profile_prog
+ * DESCRIPTION: finds the program name of a task in this run's table,
+ *              adding it the first time
+ * INPUTS: name -- pcb name of the task
+ * OUTPUTS: none
+ * RETURN VALUE: its index, PROFILE_NO_PROG if the table is full
+ * SIDE EFFECTS: may add an entry
+ */
+static uint8_t profile_prog(const uint8_t* name) {
+    uint32_t i;
+
+    for (i = 0; i < prog_count; i++)
+        if (strncmp((const int8_t*)prog_names[i], (const int8_t*)name, TASK_NAME_LEN) == 0)
+            return i;
+    if (prog_count == PROFILE_PROGS)
+        return PROFILE_NO_PROG;
+    strncpy((int8_t*)prog_names[prog_count], (const int8_t*)name, TASK_NAME_LEN - 1);
+    return prog_count++;
+}
+
+/* profile_sample
+ * DESCRIPTION: records where the PIT interrupt found the CPU. The EBP
+ *              chain is only followed while it stays in the stack memory
+ *              of the interrupted privilege level (the kernel's 4MB page
+ *              or the program page) and moves up the stack, so a frame
+ *              pointer that holds anything else ends the backtrace rather
+ *              than faulting
+ * INPUTS: regs -- registers and interrupt frame on the kernel stack
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: counts the sample as lost if the buffer is full
+ */
+void profile_sample(const profile_regs_t* regs) {
+    profile_sample_t* s;
+    uint32_t ebp, next, low, high, i;
+
+    if (!profile_on)
+        return;
+    if (head - tail == PROFILE_SAMPLES) {
+        lost++;
+        return;
+    }
+
+    s = &samples[head % PROFILE_SAMPLES];
+    s->eip = regs->eip;
+    s->cpl = regs->cs & 3;
+    s->pid = curr_process;
+    s->prog = curr_process == PID_NONE ? PROFILE_NO_PROG
+                                       : profile_prog(getProcessPCB(curr_process)->name);
+
+    if (s->cpl == 0) {
+        low = C_4MB;
+        high = C_8MB;
+    } else {
+        low = USER_PAGE_VIRT;
+        high = USER_PAGE_VIRT + C_4MB;
+    }
+    ebp = regs->ebp;
+    for (i = 0; i < PROFILE_DEPTH; i++) {
+        if (ebp < low || ebp > high - 2 * C_4B || (ebp & (C_4B - 1)) != 0)
+            break;
+        s->frames[i] = ((uint32_t*)ebp)[1];
+        next = ((uint32_t*)ebp)[0];
+        if (next <= ebp) {
+            i++;
+            break;
+        }
+        ebp = next;
+    }
+    for (; i < PROFILE_DEPTH; i++)
+        s->frames[i] = 0;
+    head++;
+}
+
+/* profile_take
+ * DESCRIPTION: takes the oldest sample that has not been drained yet
+ * INPUTS: none
+ * OUTPUTS: the sample in s
+ * RETURN VALUE: 1 if there was one, 0 if there is none left
+ * SIDE EFFECTS: none
+ */
+static int32_t profile_take(profile_sample_t* s) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (tail == head) {
+        restore_flags(flags);
+        return 0;
+    }
+    *s = samples[tail % PROFILE_SAMPLES];
+    tail++;
+    restore_flags(flags);
+    return 1;
+}
+
+/* profile_start
+ * DESCRIPTION: drops the samples and program names of the last run and
+ *              starts sampling
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void profile_start(void) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    head = tail = lost = 0;
+    prog_count = 0;
+    memset(prog_names, 0, sizeof(prog_names));
+    profile_on = 1;
+    restore_flags(flags);
+}
+
+/* profile_dump
+ * DESCRIPTION: stops sampling and drains the samples to COM1 as text:
+ *                  PROF_PROG <prog> <name>
+ *              for each program name of the run, then one line a sample
+ *                  PROF <pid> <cpl> <prog> <eip> [<return address> ...]
+ *              all in hex, and PROF_LOST <count> if the buffer filled up.
+ *              The format host/profsym.sh reads
+ * INPUTS: none
+ * OUTPUTS: the lines on COM1
+ * RETURN VALUE: none
+ * SIDE EFFECTS: waits for the UART to send them
+ */
+void profile_dump(void) {
+    profile_sample_t s;
+    uint32_t i;
+
+    profile_on = 0;
+    for (i = 0; i < prog_count; i++) {
+        serial_puts("PROF_PROG ");
+        serial_puthex(i, 2);
+        serial_putc(' ');
+        serial_puts((int8_t*)prog_names[i]);
+        serial_putc('\n');
+    }
+    while (profile_take(&s)) {
+        serial_puts("PROF ");
+        serial_puthex(s.pid, 4);
+        serial_putc(' ');
+        serial_puthex(s.cpl, 1);
+        serial_putc(' ');
+        serial_puthex(s.prog, 2);
+        serial_putc(' ');
+        serial_puthex(s.eip, 8);
+        for (i = 0; i < PROFILE_DEPTH && s.frames[i] != 0; i++) {
+            serial_putc(' ');
+            serial_puthex(s.frames[i], 8);
+        }
+        serial_putc('\n');
+    }
+    if (lost != 0) {
+        serial_puts("PROF_LOST ");
+        serial_puthex(lost, 8);
+        serial_putc('\n');
+        lost = 0;
+    }
+    serial_flush();
+}
+
+/* profile_open, profile_close
+ * DESCRIPTION: the samples are shared by all openers; close gives the fd
+ *              back
+ * RETURN VALUE: 0, -1 if fd is not open
+ */
+int32_t profile_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t profile_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* profile_read
+ * DESCRIPTION: drains samples, as many whole ones as fit in buf
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: profile_sample_t records in buf, oldest first
+ * RETURN VALUE: bytes read, a multiple of sizeof(profile_sample_t); 0 when
+ *               nothing is left, -1 if buf is NULL or nbytes negative
+ * SIDE EFFECTS: samples read are gone for the next reader
+ */
+int32_t profile_read(int32_t fd, void* buf, int32_t nbytes) {
+    profile_sample_t* out = (profile_sample_t*)buf;
+    int32_t count = 0;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+    while ((count + 1) * (int32_t)sizeof(profile_sample_t) <= nbytes && profile_take(&out[count]))
+        count++;
+    return count * sizeof(profile_sample_t);
+}
+
+/* profile_write
+ * DESCRIPTION: starts, stops or dumps the profile
+ * INPUTS: fd, buf -- an int32_t PROFILE_*, nbytes -- its size
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 if buf is not an int32_t or not a command
+ * SIDE EFFECTS: see profile_start and profile_dump
+ */
+int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes) {
+    if (buf == NULL || nbytes != sizeof(int32_t))
+        return -1;
+    switch (*(const int32_t*)buf) {
+    case PROFILE_STOP:
+        profile_on = 0;
+        break;
+    case PROFILE_START:
+        profile_start();
+        break;
+    case PROFILE_DUMP:
+        profile_dump();
+        break;
+    default:
+        return -1;
+    }
+    return nbytes;
+}
@@ -0,0 +1,66 @@
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "types.h"
+
+/* Sampling profiler. While it runs, every PIT tick records where it found
+ * the CPU: the interrupted EIP and privilege level, the task, and the
+ * return addresses of up to PROFILE_DEPTH frames found by following the
+ * saved EBP chain (everything is built without -fomit-frame-pointer). The
+ * RTC rate belongs to the programs that open "rtc", so the 100 Hz
+ * scheduler tick is the clock. Samples past PROFILE_SAMPLES are counted
+ * as lost, not recorded.
+ *
+ * The "profile" device file controls it: write an int32_t PROFILE_START
+ * (clears the samples), PROFILE_STOP or PROFILE_DUMP (stops and sends the
+ * samples to COM1 as text for host/profsym.sh); a read drains whole
+ * profile_sample_t records. "profile" on the multiboot command line
+ * starts it at boot */
+
+#define PROFILE_STOP            0
+#define PROFILE_START           1
+#define PROFILE_DUMP            2
+
+#define PROFILE_SAMPLES         8192    /* 80 s of ticks */
+#define PROFILE_DEPTH           6       /* return addresses kept per sample */
+#define PROFILE_PROGS           16      /* program names told apart per run */
+#define PROFILE_NO_PROG         0xFF    /* prog of a sample in the idle loop */
+#define PROFILE_FILENAME        "profile" /* device file name for open */
+
+#ifndef ASM
+
+/* 32 bytes. frames are return addresses, innermost first, 0 past the last
+ * one found. prog indexes the program names of this run, so that user
+ * EIPs can be looked up in the right binary */
+typedef struct profile_sample_t {
+    uint32_t eip;
+    uint16_t pid;               /* low half of curr_process, 0xFFFF idle */
+    uint8_t cpl;
+    uint8_t prog;
+    uint32_t frames[PROFILE_DEPTH];
+} profile_sample_t;
+
+/* what pit_handler has on the stack when it calls profile_sample: the
+ * registers of pushal, then the frame the CPU pushed for the interrupt;
+ * esp and ss only if it came from user mode */
+typedef struct profile_regs_t {
+    uint32_t edi, esi, ebp, esp_unused, ebx, edx, ecx, eax;
+    uint32_t eip, cs, eflags, esp, ss;
+} profile_regs_t;
+
+/* nonzero while sampling; pit_handler tests it before calling */
+extern int32_t profile_on;
+
+extern void profile_start(void);
+extern void profile_sample(const profile_regs_t* regs);
+extern void profile_dump(void);
+
+/* ops of the "profile" device file, see profile_ops in filesys.c */
+extern int32_t profile_open(const uint8_t* filename);
+extern int32_t profile_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t profile_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t profile_close(int32_t fd);
+
+#endif /* ASM */
+
+#endif
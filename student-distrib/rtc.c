@@ -104,7 +104,7 @@ int32_t rtc_write(const void* buf, int32_t nbytes){
 		frequency = 0x02;
 	}
 
-	else if ((frequency = 256)){ // if frequency is 256
+	else if ((frequency == 256)){ // if frequency is 256
 		frequency = 0x01;
 	}
 
@@ -117,7 +117,8 @@ int32_t rtc_write(const void* buf, int32_t nbytes){
 	}
 
 	else {
-		frequency = -1; // error if invalid 
+		restore_flags(flag);
+		return -1; // error if invalid, leave the rate as it is
 	}
 
 	
@@ -182,6 +183,5 @@ void rtc_interrupt_handler() {
     outb(REG_C, REG_RTC_SEL); // REG_C is set, and next interrupt is read
     inb(REG_RTC_VAL);
 
-	send_eoi(8);
-
+	/* rtc_handler in interr.S sends the EOI */
 }
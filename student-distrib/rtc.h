@@ -11,6 +11,9 @@
 #define MASK_RTC	 	0x40
 #define MASK_RATE       0xF0
 
+/* RTC interrupts since rtc_init */
+extern int rtc_call_count;
+
 /* FUNCTIONS DECLARED */
 
 /* initializes the rtc */
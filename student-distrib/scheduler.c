@@ -0,0 +1,230 @@
+
+#include "scheduler.h"
+#include "syscalls.h"
+#include "paging.h"
+#include "lib.h"
+#include "trace.h"
+
+static uint32_t idle_esp;   /* kernel ESP of the boot context while a task runs */
+
+/*
+ * schedule
+ *   DESCRIPTION: Round-robin over the process slots, starting after the
+ *                current task. Switches address space, TSS stack and kernel
+ *                stack to the first runnable task found. When nothing is
+ *                runnable, the boot context (idle loop) gets the cpu.
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: returns only once the calling task is picked again
+ */
+void schedule(void) {
+    uint32_t flags;
+    uint32_t i, pid, start;
+    uint32_t next = PID_NONE;
+    uint32_t* save_esp;
+    uint32_t* prev_dir;
+    pcb_t* next_pcb;
+
+    cli_and_save(flags);
+
+    /* find the next runnable task after the current one */
+    start = (curr_process == PID_NONE) ? 0 : curr_process + 1;
+    for (i = 0; i < NUM_MAX_PROCESSES; i++) {
+        pid = (start + i) % NUM_MAX_PROCESSES;
+        if (pid_array[pid] == PROG_ACTIVE && getProcessPCB(pid)->state == TASK_RUNNABLE) {
+            next = pid;
+            break;
+        }
+    }
+
+    /* nothing to switch to */
+    if (next == curr_process) {
+        restore_flags(flags);
+        return;
+    }
+
+    /* where the outgoing context keeps its kernel stack pointer */
+    if (curr_process == PID_NONE) {
+        save_esp = &idle_esp;
+        prev_dir = page_directory;
+    } else {
+        save_esp = &getProcessPCB(curr_process)->current_esp;
+        prev_dir = getProcessPCB(curr_process)->page_dir;
+    }
+
+    trace_event(TRACE_SWITCH, next);
+    curr_process = next;
+    if (next == PID_NONE) {
+        load_page_directory(page_directory);
+        switch_to(save_esp, idle_esp);
+    } else {
+        next_pcb = getProcessPCB(next);
+        /* threads of the same process keep the TLB */
+        if (next_pcb->page_dir != prev_dir)
+            load_page_directory(next_pcb->page_dir);
+        tss.esp0 = get_kernel_stack_bottom(next);
+        switch_to(save_esp, next_pcb->current_esp);
+    }
+
+    restore_flags(flags);
+}
+
+/*
+ * task_block
+ *   DESCRIPTION: marks the current task blocked and switches away
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: returns after another context calls task_wake on us
+ */
+void task_block(void) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    getProcessPCB(curr_process)->state = TASK_BLOCKED;
+    schedule();
+    restore_flags(flags);
+}
+
+/*
+ * task_wake
+ *   DESCRIPTION: makes a blocked task runnable again, it is picked up by
+ *                the next call to schedule
+ *   INPUTS: pcb -- task to wake
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void task_wake(pcb_t* pcb) {
+    if (pcb->state == TASK_BLOCKED)
+        pcb->state = TASK_RUNNABLE;
+}
+
+/*
+ * wait_queue_sleep
+ *   DESCRIPTION: appends the current task to q and blocks it
+ *   INPUTS: q -- queue to sleep on, key -- what the task waits for
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: returns once wait_queue_wake took the task off q
+ */
+void wait_queue_sleep(wait_queue_t* q, uint32_t key) {
+    uint32_t flags;
+    pcb_t* pcb;
+
+    cli_and_save(flags);
+    pcb = getProcessPCB(curr_process);
+    pcb->wait_queue = q;
+    pcb->wait_key = key;
+    pcb->wait_next = NULL;
+    if (q->tail == NULL)
+        q->head = pcb;
+    else
+        q->tail->wait_next = pcb;
+    q->tail = pcb;
+
+    task_block();
+    restore_flags(flags);
+}
+
+/*
+ * wait_queue_wake
+ *   DESCRIPTION: takes up to n tasks waiting on key off q, oldest first,
+ *                and makes them runnable
+ *   INPUTS: q -- queue, key -- only tasks waiting on this key, n -- limit
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of tasks woken
+ *   SIDE EFFECTS: none
+ */
+uint32_t wait_queue_wake(wait_queue_t* q, uint32_t key, uint32_t n) {
+    uint32_t flags;
+    uint32_t woken = 0;
+    pcb_t* prev = NULL;
+    pcb_t* pcb;
+    pcb_t* next;
+
+    cli_and_save(flags);
+    for (pcb = q->head; pcb != NULL && woken < n; pcb = next) {
+        next = pcb->wait_next;
+        if (pcb->wait_key != key) {
+            prev = pcb;
+            continue;
+        }
+
+        /* unlink */
+        if (prev == NULL)
+            q->head = next;
+        else
+            prev->wait_next = next;
+        if (q->tail == pcb)
+            q->tail = prev;
+
+        pcb->wait_queue = NULL;
+        pcb->wait_next = NULL;
+        task_wake(pcb);
+        woken++;
+    }
+    restore_flags(flags);
+    return woken;
+}
+
+/*
+ * wait_queue_wake_all
+ *   DESCRIPTION: makes every task on q runnable and empties q
+ *   INPUTS: q -- queue
+ *   OUTPUTS: none
+ *   RETURN VALUE: number of tasks woken
+ *   SIDE EFFECTS: none
+ */
+uint32_t wait_queue_wake_all(wait_queue_t* q) {
+    uint32_t flags;
+    uint32_t woken = 0;
+    pcb_t* pcb;
+
+    cli_and_save(flags);
+    while ((pcb = q->head) != NULL) {
+        q->head = pcb->wait_next;
+        pcb->wait_queue = NULL;
+        pcb->wait_next = NULL;
+        task_wake(pcb);
+        woken++;
+    }
+    q->tail = NULL;
+    restore_flags(flags);
+    return woken;
+}
+
+/*
+ * wait_queue_remove
+ *   DESCRIPTION: unlinks pcb from the queue it sleeps on without waking it,
+ *                used when a blocked task is killed
+ *   INPUTS: pcb -- task to unlink
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void wait_queue_remove(pcb_t* pcb) {
+    uint32_t flags;
+    wait_queue_t* q;
+    pcb_t* prev = NULL;
+    pcb_t* cur;
+
+    cli_and_save(flags);
+    q = pcb->wait_queue;
+    if (q != NULL) {
+        for (cur = q->head; cur != NULL; prev = cur, cur = cur->wait_next) {
+            if (cur != pcb) continue;
+            if (prev == NULL)
+                q->head = cur->wait_next;
+            else
+                prev->wait_next = cur->wait_next;
+            if (q->tail == cur)
+                q->tail = prev;
+            break;
+        }
+        pcb->wait_queue = NULL;
+        pcb->wait_next = NULL;
+    }
+    restore_flags(flags);
+}
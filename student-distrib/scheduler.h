@@ -0,0 +1,30 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "types.h"
+#include "pcb.h"
+
+/* EFLAGS of a freshly started user task: IF set, reserved bit 1 set */
+#define USER_EFLAGS 0x202
+
+/* defined in interr.S */
+extern void switch_to(uint32_t* save_esp, uint32_t new_esp);
+extern void task_start(void);
+
+/* gives the cpu to the next runnable task, or to the idle loop */
+extern void schedule(void);
+/* puts the current task to sleep until task_wake is called on it */
+extern void task_block(void);
+/* makes a blocked task runnable again */
+extern void task_wake(pcb_t* pcb);
+
+/* blocks the current task on q until woken with a matching key */
+extern void wait_queue_sleep(wait_queue_t* q, uint32_t key);
+/* wakes up to n tasks of q waiting on key, returns how many woke */
+extern uint32_t wait_queue_wake(wait_queue_t* q, uint32_t key, uint32_t n);
+/* wakes every task on q */
+extern uint32_t wait_queue_wake_all(wait_queue_t* q);
+/* unlinks a task from the queue it sleeps on (task being killed) */
+extern void wait_queue_remove(pcb_t* pcb);
+
+#endif
@@ -0,0 +1,165 @@
+#include "serial.h"
+#include "lib.h"
+#include "filesys.h"
+
+int32_t serial_mirror = 0;
+
+/* Bytes waiting to go out. The IRQ handler moves them to the UART a FIFO
+ * load at a time, so writers only copy into the ring */
+static uint8_t tx_buf[SERIAL_BUF_SIZE];
+static uint32_t tx_head;            /* index of the next byte to send */
+static uint32_t tx_count;           /* bytes in the ring */
+static int32_t tx_irq_on;           /* THRE interrupt enabled */
+
+/* serial_init
+ * DESCRIPTION: sets COM1 to 115200 baud 8N1 with FIFOs. Output is sent by
+ *              polling until IRQ4 is unmasked; after that the UART only
+ *              interrupts while there is something to send
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void serial_init(void) {
+    outb(0, SERIAL_IER);
+    outb(SERIAL_LCR_DLAB, SERIAL_LCR);
+    outb(SERIAL_DIVISOR & 0xFF, SERIAL_DATA);
+    outb(SERIAL_DIVISOR >> 8, SERIAL_IER);
+    outb(SERIAL_LCR_8N1, SERIAL_LCR);
+    outb(SERIAL_FCR_ENABLE, SERIAL_FCR);
+    outb(SERIAL_MCR_OUT2, SERIAL_MCR);
+    tx_head = tx_count = 0;
+    tx_irq_on = 0;
+}
+
+/* tx_fill
+ * DESCRIPTION: if the transmit FIFO is empty, loads it from the ring, and
+ *              keeps the THRE interrupt on exactly while bytes are left.
+ *              Call with interrupts off
+ * INPUTS: none
+ * OUTPUTS: up to SERIAL_FIFO_SIZE bytes to the UART
+ * RETURN VALUE: none
+ */
+static void tx_fill(void) {
+    uint32_t n;
+
+    if (inb(SERIAL_LSR) & SERIAL_LSR_THRE) {
+        for (n = 0; n < SERIAL_FIFO_SIZE && tx_count > 0; n++) {
+            outb(tx_buf[tx_head], SERIAL_DATA);
+            tx_head = (tx_head + 1) & (SERIAL_BUF_SIZE - 1);
+            tx_count--;
+        }
+    }
+    if ((tx_count > 0) != tx_irq_on) {
+        tx_irq_on = (tx_count > 0);
+        outb(tx_irq_on ? SERIAL_IER_THRE : 0, SERIAL_IER);
+    }
+}
+
+/* serial_putc
+ * DESCRIPTION: queues one byte. If the ring is full (interrupts have been
+ *              off for a while) it waits for the UART instead of dropping
+ * INPUTS: c -- byte to send
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void serial_putc(uint8_t c) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while (tx_count == SERIAL_BUF_SIZE)
+        tx_fill();
+    tx_buf[(tx_head + tx_count) & (SERIAL_BUF_SIZE - 1)] = c;
+    tx_count++;
+    tx_fill();
+    restore_flags(flags);
+}
+
+/* serial_puts
+ * DESCRIPTION: queues a string, for the text dumps of trace and profile
+ * INPUTS: s -- NUL terminated
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void serial_puts(const int8_t* s) {
+    while (*s != '\0')
+        serial_putc(*s++);
+}
+
+/* serial_puthex
+ * DESCRIPTION: queues a number as that many hex digits
+ * INPUTS: value, digits -- 1 to 8
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void serial_puthex(uint32_t value, uint32_t digits) {
+    while (digits-- > 0)
+        serial_putc("0123456789abcdef"[(value >> (digits * 4)) & 0xF]);
+}
+
+/* serial_flush
+ * DESCRIPTION: sends everything queued and waits until it is on the wire,
+ *              e.g. before the machine goes away
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ */
+void serial_flush(void) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while (tx_count > 0)
+        tx_fill();
+    while (!(inb(SERIAL_LSR) & SERIAL_LSR_TEMT))
+        ;
+    restore_flags(flags);
+}
+
+/* serial_interrupt_handler
+ * DESCRIPTION: IRQ4, the transmit FIFO ran empty. serial_handler sends
+ *              the EOI
+ * INPUTS: none
+ * OUTPUTS: the next bytes of the ring to the UART
+ * RETURN VALUE: none
+ */
+void serial_interrupt_handler(void) {
+    inb(SERIAL_IIR);                /* acknowledge */
+    tx_fill();
+}
+
+/* serial_open, serial_close
+ * DESCRIPTION: nothing to set up, the port is shared by all openers;
+ *              close gives the fd back
+ * RETURN VALUE: 0, -1 if fd is not open
+ */
+int32_t serial_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t serial_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* serial_read
+ * DESCRIPTION: the port is output only
+ * RETURN VALUE: 0, as at the end of a file
+ */
+int32_t serial_read(int32_t fd, void* buf, int32_t nbytes) {
+    return 0;
+}
+
+/* serial_write
+ * DESCRIPTION: queues bytes for COM1
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 if buf is NULL or nbytes negative
+ * SIDE EFFECTS: waits for the UART only when the ring is full
+ */
+int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes) {
+    int32_t i;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+    for (i = 0; i < nbytes; i++)
+        serial_putc(((const uint8_t*)buf)[i]);
+    return nbytes;
+}
@@ -0,0 +1,47 @@
+#ifndef SERIAL_H_
+#define SERIAL_H_
+
+#include "types.h"
+
+/* 16550 UART on COM1 */
+#define SERIAL_IRQ          4
+#define SERIAL_PORT         0x3F8
+#define SERIAL_DATA         (SERIAL_PORT + 0)   /* THR/RBR, divisor low with DLAB */
+#define SERIAL_IER          (SERIAL_PORT + 1)   /* interrupt enable, divisor high with DLAB */
+#define SERIAL_IIR          (SERIAL_PORT + 2)   /* interrupt id on read, FCR on write */
+#define SERIAL_FCR          (SERIAL_PORT + 2)
+#define SERIAL_LCR          (SERIAL_PORT + 3)
+#define SERIAL_MCR          (SERIAL_PORT + 4)
+#define SERIAL_LSR          (SERIAL_PORT + 5)
+#define SERIAL_LCR_DLAB     0x80
+#define SERIAL_LCR_8N1      0x03
+#define SERIAL_FCR_ENABLE   0xC7        /* FIFOs on and cleared, 14-byte trigger */
+#define SERIAL_MCR_OUT2     0x0B        /* DTR, RTS, and OUT2 which gates the IRQ line */
+#define SERIAL_IER_THRE     0x02        /* interrupt when the transmit FIFO empties */
+#define SERIAL_LSR_THRE     0x20        /* transmit FIFO empty */
+#define SERIAL_LSR_TEMT     0x40        /* transmitter completely idle */
+#define SERIAL_FIFO_SIZE    16
+#define SERIAL_DIVISOR      1           /* 115200 baud */
+#define SERIAL_BUF_SIZE     8192        /* bytes queued for sending, power of 2 */
+#define SERIAL_FILENAME     "serial"    /* device file name for open */
+
+/* set when console output is copied to the serial port, see putc */
+extern int32_t serial_mirror;
+
+extern void serial_init(void);
+extern void serial_putc(uint8_t c);
+extern void serial_puts(const int8_t* s);
+extern void serial_puthex(uint32_t value, uint32_t digits);
+extern void serial_flush(void);
+
+/* IRQ4, entered through serial_handler in interr.S */
+extern void serial_handler(void);
+extern void serial_interrupt_handler(void);
+
+/* ops of the "serial" device file, see serial_ops in filesys.c */
+extern int32_t serial_open(const uint8_t* filename);
+extern int32_t serial_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t serial_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t serial_close(int32_t fd);
+
+#endif
@@ -0,0 +1,218 @@
+#include "shm.h"
+#include "syscalls.h"
+#include "paging.h"
+
+/* A shared memory segment: frames from the pool plus the number of
+ * processes that map it. A segment is free when refs is 0 */
+typedef struct shm_segment_t {
+    int32_t key;                        /* name the processes agree on */
+    uint32_t npages;
+    uint32_t refs;
+    uint32_t frames[SHM_MAX_PAGES];
+} shm_segment_t;
+
+static shm_segment_t segments[NUM_SHM_SEGMENTS];
+
+/* shm_range_free
+ * DESCRIPTION: checks that npages pages from addr are unmapped
+ * INPUTS: directory -- page directory, addr -- first page, npages -- count
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if none of them is mapped, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t shm_range_free(uint32_t* directory, uint32_t addr, uint32_t npages) {
+    return paging_find_free(directory, addr, addr + npages * PAGE_SIZE, npages) == addr;
+}
+
+/* shm_release
+ * DESCRIPTION: drops one reference to a segment, freeing its frames with
+                the last one
+ * INPUTS: seg -- segment
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void shm_release(shm_segment_t* seg) {
+    uint32_t i;
+
+    if (--seg->refs != 0)
+        return;
+    for (i = 0; i < seg->npages; i++)
+        frame_free(seg->frames[i]);
+    seg->npages = 0;
+}
+
+/* shm_detach
+ * DESCRIPTION: unmaps entry idx of owner's shm_maps from directory
+ * INPUTS: owner -- PCB of the process, directory -- its page directory,
+ *         idx -- entry of owner->shm_maps
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: may free the segment
+ */
+static void shm_detach(pcb_t* owner, uint32_t* directory, uint32_t idx) {
+    shm_segment_t* seg = &segments[owner->shm_maps[idx].segment];
+    uint32_t i;
+
+    for (i = 0; i < seg->npages; i++)
+        paging_unmap_page(directory, owner->shm_maps[idx].addr + i * PAGE_SIZE);
+    shm_release(seg);
+    owner->shm_maps[idx].segment = SHM_NONE;
+}
+
+/* shm_map
+ * DESCRIPTION: system call for shm_map. Maps the segment called key into
+                the caller, creating it with size bytes of zeroed frames if
+                no process has it mapped. Every process mapping the same key
+                sees the same frames
+ * INPUTS: key -- segment name, size -- bytes wanted (at most the size of
+ *                an existing segment),
+ *         addr -- page aligned address to map at, NULL to let the kernel
+ *                 pick one
+ * OUTPUTS: none
+ * RETURN VALUE: address the segment is mapped at, -1 on failure
+ * SIDE EFFECTS: allocates frames and page tables
+ */
+int32_t shm_map(int32_t key, uint32_t size, void* addr) {
+    pcb_t* owner;
+    uint32_t* directory;
+    shm_segment_t* seg = NULL;
+    uint32_t npages = (size + PAGE_SIZE - 1) >> BITS_4KB_ALIGN;
+    uint32_t virt = (uint32_t)addr;
+    uint32_t flags;
+    int32_t slot;
+    uint32_t i;
+
+    if (npages == 0 || npages > SHM_MAX_PAGES)
+        return -1;
+    if (virt != 0 && ((virt & (PAGE_SIZE - 1)) || virt < SHM_USER_START ||
+        virt > SHM_USER_END - npages * PAGE_SIZE))
+        return -1;
+
+    cli_and_save(flags);
+    owner = getProcessPCB(getCurrentProcessPCB()->owner);
+    directory = owner->page_dir;
+
+    for (slot = 0; slot < SHM_PER_PROCESS; slot++) {
+        if (owner->shm_maps[slot].segment == SHM_NONE)
+            break;
+    }
+    if (slot == SHM_PER_PROCESS)
+        goto fail;
+
+    /* join the segment if it exists */
+    for (i = 0; i < NUM_SHM_SEGMENTS; i++) {
+        if (segments[i].refs != 0 && segments[i].key == key) {
+            seg = &segments[i];
+            break;
+        }
+    }
+    if (seg != NULL && npages > seg->npages)
+        goto fail;
+    if (seg != NULL)
+        npages = seg->npages;
+
+    if (virt == 0)
+        virt = paging_find_free(directory, SHM_REGION_START, SHM_REGION_END, npages);
+    if (virt == 0 || !shm_range_free(directory, virt, npages))
+        goto fail;
+
+    /* otherwise make it */
+    if (seg == NULL) {
+        for (i = 0; i < NUM_SHM_SEGMENTS; i++) {
+            if (segments[i].refs == 0) {
+                seg = &segments[i];
+                break;
+            }
+        }
+        if (seg == NULL)
+            goto fail;
+        seg->key = key;
+        seg->refs = 0;
+        for (seg->npages = 0; seg->npages < npages; seg->npages++) {
+            if ((seg->frames[seg->npages] = frame_alloc()) == 0) {
+                while (seg->npages > 0)
+                    frame_free(seg->frames[--seg->npages]);
+                goto fail;
+            }
+        }
+    }
+
+    seg->refs++;
+    owner->shm_maps[slot].segment = seg - segments;
+    owner->shm_maps[slot].addr = virt;
+    for (i = 0; i < npages; i++) {
+        if (paging_map_page(directory, virt + i * PAGE_SIZE, seg->frames[i], USER_PTE_RW) == -1) {
+            /* unwinds the pages mapped so far, and the segment if new */
+            shm_detach(owner, directory, slot);
+            goto fail;
+        }
+    }
+
+    restore_flags(flags);
+    return virt;
+
+fail:
+    restore_flags(flags);
+    return -1;
+}
+
+/* shm_unmap
+ * DESCRIPTION: system call for shm_unmap, unmaps the segment the caller
+                mapped at addr. The frames are freed once no process maps
+                the segment any more
+ * INPUTS: addr -- address shm_map returned
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if no segment is mapped at addr
+ * SIDE EFFECTS: none
+ */
+int32_t shm_unmap(void* addr) {
+    pcb_t* owner;
+    uint32_t flags;
+    uint32_t i;
+
+    if ((uint32_t)addr & (PAGE_SIZE - 1))
+        return -1;
+
+    cli_and_save(flags);
+    owner = getProcessPCB(getCurrentProcessPCB()->owner);
+    for (i = 0; i < SHM_PER_PROCESS; i++) {
+        if (owner->shm_maps[i].segment != SHM_NONE && owner->shm_maps[i].addr == (uint32_t)addr) {
+            shm_detach(owner, owner->page_dir, i);
+            restore_flags(flags);
+            return 0;
+        }
+    }
+    restore_flags(flags);
+    return -1;
+}
+
+/* shm_init_process
+ * DESCRIPTION: marks every shared memory entry of a new process unused
+ * INPUTS: pcb -- new process
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void shm_init_process(pcb_t* pcb) {
+    uint32_t i;
+
+    for (i = 0; i < SHM_PER_PROCESS; i++)
+        pcb->shm_maps[i].segment = SHM_NONE;
+}
+
+/* shm_exit
+ * DESCRIPTION: unmaps every segment a process still has mapped
+ * INPUTS: pcb -- process that is going away (not a thread)
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: frees segments nobody else maps
+ */
+void shm_exit(pcb_t* pcb) {
+    uint32_t i;
+
+    for (i = 0; i < SHM_PER_PROCESS; i++) {
+        if (pcb->shm_maps[i].segment != SHM_NONE)
+            shm_detach(pcb, pcb->page_dir, i);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef SHM_H_
+#define SHM_H_
+
+#include "types.h"
+#include "pcb.h"
+
+#define NUM_SHM_SEGMENTS    16          /* segments in the system at once */
+#define SHM_MAX_PAGES       256         /* 1MB per segment */
+#define SHM_REGION_START    0x0C000000  /* 192MB, where the kernel places segments */
+#define SHM_REGION_END      0x10000000  /* 256MB */
+#define SHM_USER_START      0x0C000000  /* lowest address a caller may pick, above the heap */
+#define SHM_USER_END        0x40000000  /* 1GB */
+
+/* shm_map system call: maps segment key (created with size bytes if new) */
+extern int32_t shm_map(int32_t key, uint32_t size, void* addr);
+/* shm_unmap system call: unmaps the segment mapped at addr */
+extern int32_t shm_unmap(void* addr);
+
+/* marks every shm_maps entry of a new process unused */
+extern void shm_init_process(pcb_t* pcb);
+/* unmaps every segment of a process that is going away */
+extern void shm_exit(pcb_t* pcb);
+
+#endif
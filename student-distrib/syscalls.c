@@ -3,10 +3,14 @@
 #include "filesys.h"
 #include "paging.h"
 #include "terminal.h"
+#include "scheduler.h"
+#include "shm.h"
+#include "mmap.h"
+#include "heap.h"
 
 /* declare variables */
-uint8_t  pid_array[NUM_MAX_PROCESSES] = {0, 0, 0, 0, 0, 0};  /* array that folds the pids */
-uint32_t curr_process = 0;                                   /* keeps track of which current process it is running */
+uint8_t  pid_array[NUM_MAX_PROCESSES] = {0};                /* array that folds the pids */
+uint32_t curr_process = PID_NONE;                            /* keeps track of which current process it is running */
 
 /* open
  * DESCRIPTION: system call for open, attempts to open a file with its filename
@@ -18,28 +22,17 @@ uint32_t curr_process = 0;                                   /* keeps track of w
 int32_t open(const uint8_t* filename) {
     // DEBUG PRINT
     //printf("## open(%s)\n", filename);
-    // Check file exist or not
+    // Check file exist or not; lookup_file also knows the device files,
+    // which have no entry in the image
     dentry_t dentry;
-    if (read_dentry_by_name(filename, &dentry) == -1)
+    if (filename == NULL || lookup_file(filename, &dentry) == -1)
         return -1;
 
-    int ret;
-    switch (dentry.filetype) {
-        case FILE_TYPE_DIR:
-            return directory_open(filename);
+    if (dentry.filetype == FILE_TYPE_DIR)
+        return directory_open(filename);
 
-        case FILE_TYPE_RTC:
-            // Create RTC entry in file_array
-            if (file_open(filename) == -1) return -1;
-
-        case FILE_TYPE_FILE:
-            ret = file_open(filename);
-            //printf("## open(%s) - %d\n", filename, ret);
-            return ret;
-    }
-
-    // Otherwise, error
-    return -1;
+    // Files, the RTC and the devices get their ops table from file_open
+    return file_open(filename);
 }
 
 /* close
@@ -53,7 +46,7 @@ int32_t close(int32_t fd) {
     // DEBUG PRINT
     //printf("## close() - %d\n", fd);
     // Get file_array pointer
-    file_t * file_array = getCurrentProcessPCB()->file_array;
+    file_t * file_array = getCurrentProcessPCB()->files;
 
     // Don't close stdin or stdout, or anything out of bounds
     if (7 < fd || fd < 2) return -1;
@@ -78,7 +71,7 @@ int32_t read(int32_t fd, void* buf, int32_t nbytes) {
     // DEBUG PRINT
     //printf("## read() - %d, %x, %d\n", fd, buf, nbytes);
     // Get file_array pointer
-    file_t * file_array = getCurrentProcessPCB()->file_array;
+    file_t * file_array = getCurrentProcessPCB()->files;
 
     // Don't close stdin or stdout, or anything out of bounds
     if (7 < fd || fd < 0) return -1;
@@ -103,7 +96,7 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
     // DEBUG PRINT
     //printf("## write() - %d, %s, %d\n", fd, buf, nbytes);
     // Get file_array pointer
-    file_t * file_array = getCurrentProcessPCB()->file_array;
+    file_t * file_array = getCurrentProcessPCB()->files;
 
     // Don't close stdin or stdout, or anything out of bounds
     if (7 < fd || fd < 0) return -1;
@@ -118,62 +111,193 @@ int32_t write(int32_t fd, const void* buf, int32_t nbytes) {
 }    
 
 
+/* getdents
+ * DESCRIPTION: system call for getdents, reads many directory entries at
+                once as packed dirent_t records (name, type, inode, size)
+ * INPUTS: fd of an open directory, buffer to fill, its size in bytes
+ * OUTPUTS: records in buf
+ * RETURN VALUE: bytes filled, 0 at the end of the directory, -1 on failure
+ *               or if buf is not the caller's memory
+ * SIDE EFFECTS: advances the directory position
+ */
+int32_t getdents(int32_t fd, void* buf, int32_t nbytes) {
+    if (bad_userspace_addr(buf, nbytes))
+        return -1;
+    return directory_getdents(fd, (uint8_t*)buf, nbytes);
+}
+
+
+/* stat
+ * DESCRIPTION: system call for stat, describes a file by name
+ * INPUTS: filename, user pointer to a stat_t
+ * OUTPUTS: type, inode, length and block count in *st
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t stat(const uint8_t* filename, stat_t* st) {
+    if (bad_userspace_addr(st, sizeof(stat_t)))
+        return -1;
+    return file_stat(filename, st);
+}
+
+/* fstat
+ * DESCRIPTION: system call for fstat, describes an open fd. Pipes and the
+                terminal report FILE_TYPE_PIPE and FILE_TYPE_TERMINAL
+ * INPUTS: fd, user pointer to a stat_t
+ * OUTPUTS: type, inode, length and block count in *st
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t fstat(int32_t fd, stat_t* st) {
+    if (bad_userspace_addr(st, sizeof(stat_t)))
+        return -1;
+    return file_fstat(fd, st);
+}
+
+/* create
+ * DESCRIPTION: system call for create, makes an empty regular file
+ * INPUTS: filename, shorter than 32 characters
+ * OUTPUTS: a new directory entry
+ * RETURN VALUE: 0 on success, -1 if the name is bad or taken or the file
+ *               system is full
+ * SIDE EFFECTS: none
+ */
+int32_t create(const uint8_t* filename) {
+    return (create_file(filename) < 0) ? -1 : 0;
+}
+
+/* ftruncate
+ * DESCRIPTION: system call for ftruncate, sets the length of an open file
+ * INPUTS: fd, length in bytes
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t ftruncate(int32_t fd, uint32_t length) {
+    return file_truncate(fd, length);
+}
+
+/* lseek
+ * DESCRIPTION: system call for lseek, moves the position of an open file
+ * INPUTS: fd, offset, whence (SEEK_SET, SEEK_CUR or SEEK_END)
+ * OUTPUTS: none
+ * RETURN VALUE: the new position, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int32_t lseek(int32_t fd, int32_t offset, int32_t whence) {
+    return file_seek(fd, offset, whence);
+}
+
+
 /* halt
- * DESCRIPTION: system call for halt, attempt to halt programs that have 
-                een opened, and is not the shell
+ * DESCRIPTION: system call for halt, terminates the calling process. Its
+                open files are closed, its threads are killed, its children
+                become orphans and the parent blocked in waitpid (if any) is
+                woken up. Called from a thread, only that thread ends
  * INPUTS: status
- * OUTPUTS: system halted
- * RETURN VALUE: return 0 for success
- * SIDE EFFECTS: system stop, return to parent
+ * OUTPUTS: process becomes a zombie until the parent collects the status
+ * RETURN VALUE: never returns
+ * SIDE EFFECTS: switches to the next runnable task
  */
-#define USER_PDE_4MB_BASE     0x87    /* offset to calculate the offset to parent */
 int32_t halt(uint8_t status) {
     // DEBUG PRINT
 //    printf("## halt() - %d\n", status);
-    /* declare variables */
-    uint32_t pcb_offset = 2;          /* offset to correctly manage process locations */
-    pcb_t * current_pcb = ((pcb_t *)(BASE_PROCESS_POSITION - (curr_process + pcb_offset) * PROCESS_OFFSET)); /* holds current pcb */
-    
-    /* decalre parent's storeing variables */
-    uint32_t parent_process = current_pcb->parent_num;      /* keeps track which process is the parent */
-    uint32_t parent_ebp = current_pcb->parent_ebp;          /* holds parents's ebp for return stack to parent's state */
-    uint32_t parent_esp = current_pcb->parent_esp;          /* holds parents's esp for return stack to parent's state */
-    uint8_t* exec_ret_addr = current_pcb->exec_ret_addr;    /* execution return address */
-
-    /* Restore to parent by calculating offset: data/paging */
-    /*                      128MB       8MB                           4MB         USER PDE 4MB BASE VALUE  */
-    //update_page_directory(0x08000000, 0x00800000 + parent_process * 0x00400000, 0x87);
-    update_page_directory(C_128MB, C_8MB + parent_process * C_4MB, USER_PDE_4MB_BASE);
-
-    /* Restore ESP to parent */
-    tss.esp0 = BASE_PROCESS_POSITION - (parent_process + 1) * PROCESS_OFFSET - C_4B;
-    
-    /* mark current process as no longer active */
-    pid_array[curr_process] = PROG_NOT_ACTIVE;
-    curr_process = parent_process;
-
-    /* Jump to execute return */
-    return_to_execute(exec_ret_addr, parent_ebp, parent_esp, status);
+    task_exit(status);
 
     /* returns, but never back to the caller */
     return 0;
 }
 
+/* task_exit
+ * DESCRIPTION: common exit path of halt, tears down the current process
+ * INPUTS: status -- exit status handed to the parent
+ * OUTPUTS: none
+ * RETURN VALUE: never returns
+ * SIDE EFFECTS: frees the process slot right away if nobody can wait for it
+ */
+void task_exit(int32_t status) {
+    uint32_t flags;
+    uint32_t i;
+    pcb_t * current_pcb;
+    pcb_t * parent_pcb;
+    pcb_t * child_pcb;
+    int32_t * fp;
+
+    cli_and_save(flags);
+    current_pcb = getProcessPCB(curr_process);
+
+    if (current_pcb->owner == curr_process) {
+        /* close everything, stdin/stdout too since they may be pipe
+         * ends. Threads share the table */
+        for (i = 0; i < NUM_MAX_OPEN_FILES; i++) {
+            if (current_pcb->files[i].flags == FILE_AVAIL) continue;
+            fp = (int32_t *) current_pcb->files[i].file_ops_table_ptr;
+            ((CLOSEFUNC)fp[CLOSE])(i);
+        }
+
+        /* the address space goes away, so do the other threads */
+        for (i = 0; i < NUM_MAX_PROCESSES; i++) {
+            if (pid_array[i] == PROG_NOT_ACTIVE || i == curr_process) continue;
+            if (getProcessPCB(i)->owner != curr_process) continue;
+            wait_queue_remove(getProcessPCB(i));
+            pid_array[i] = PROG_NOT_ACTIVE;
+        }
+
+        /* drop the 4KB mappings and the page tables behind them */
+        shm_exit(current_pcb);
+        mmap_exit(current_pcb);
+        heap_exit(current_pcb);
+        paging_release_tables(current_pcb->page_dir);
+    }
+
+    /* orphan the children (also those of killed threads), nobody will
+     * collect the ones already dead */
+    for (i = 0; i < NUM_MAX_PROCESSES; i++) {
+        if (pid_array[i] == PROG_NOT_ACTIVE || i == curr_process) continue;
+        child_pcb = getProcessPCB(i);
+        if (child_pcb->parent_num == PID_NONE) continue;
+        if (child_pcb->parent_num != curr_process &&
+            pid_array[child_pcb->parent_num] == PROG_ACTIVE) continue;
+        child_pcb->parent_num = PID_NONE;
+        if (child_pcb->state == TASK_ZOMBIE)
+            pid_array[i] = PROG_NOT_ACTIVE;
+    }
+
+    current_pcb->exit_status = status;
+    current_pcb->state = TASK_ZOMBIE;
+
+    if (current_pcb->parent_num == PID_NONE) {
+        /* no parent, reap ourselves. The slot is not reused before the
+         * switch below since interrupts stay off until then */
+        pid_array[curr_process] = PROG_NOT_ACTIVE;
+    } else {
+        /* wake the parent if it waits for us */
+        parent_pcb = getProcessPCB(current_pcb->parent_num);
+        if (parent_pcb->wait_pid == -1 || parent_pcb->wait_pid == curr_process)
+            task_wake(parent_pcb);
+    }
+
+    schedule();
+
+    /* a zombie is never scheduled again */
+    restore_flags(flags);
+}
+
 
 /* get_next_process_number
  * DESCRIPTION: returns the number of active process by looping
- * INPUTS: void
+ * INPUTS: first -- lowest slot that may be handed out
  * OUTPUTS: will get the number of active processes to use
  * RETURN VALUE: return index to store next process number for success, 
                  return -1 for failure
  * SIDE EFFECTS: none, just loops through the array
  */
-int32_t get_next_process_number() {
+int32_t get_next_process_number(uint32_t first) {
     /* declare variables */
     int32_t i;
 
     /* loops through to find the next unused pid index to store new pid */
-    for (i = 0; i < NUM_MAX_PROCESSES; i++) {
+    for (i = first; i < NUM_MAX_PROCESSES; i++) {
         if (pid_array[i] == PROG_NOT_ACTIVE) {
             pid_array[i] = PROG_ACTIVE;
             return i;
@@ -184,46 +308,97 @@ int32_t get_next_process_number() {
     return -1;
 }
 
-/* execute
- * DESCRIPTION: system call for execute, execute the process
+/* current_page_directory
+ * DESCRIPTION: page directory of the running context
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: the current task's directory, or the boot directory when idle
+ * SIDE EFFECTS: none
+ */
+static uint32_t* current_page_directory(void) {
+    if (curr_process == PID_NONE)
+        return page_directory;
+    return getProcessPCB(curr_process)->page_dir;
+}
+
+/* start_task
+ * DESCRIPTION: builds the kernel stack switch_to resumes a new task on:
+                an IRET frame into user mode, the return address into
+                task_start, then ebp/ebx/esi/edi. Marks the task runnable
+ * INPUTS: pcb -- new task, entry -- user EIP, user_esp -- user stack
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: the scheduler may pick the task from now on
+ */
+static void start_task(pcb_t* pcb, uint32_t entry, uint32_t user_esp) {
+    uint32_t* kstack = (uint32_t *)(get_kernel_stack_bottom(pcb->pid) + C_4B);
+
+    pcb->wait_queue = NULL;
+    pcb->wait_next = NULL;
+
+    *(--kstack) = USER_DS;
+    *(--kstack) = user_esp;
+    *(--kstack) = USER_EFLAGS;
+    *(--kstack) = USER_CS;
+    *(--kstack) = entry;
+    *(--kstack) = (uint32_t)task_start;
+    *(--kstack) = 0;
+    *(--kstack) = 0;
+    *(--kstack) = 0;
+    *(--kstack) = 0;
+    pcb->current_esp = (uint32_t)kstack;
+
+    pcb->state = TASK_RUNNABLE;
+}
+
+/* spawn_process
+ * DESCRIPTION: loads a program into a new process slot and makes it
+                runnable, without waiting for it. The new task starts in
+                task_start the first time the scheduler picks it
  * INPUTS: command as character array
- * OUTPUTS: sets new page directory and will set program in memory
- * RETURN VALUE: return 0 for success, else return -1 for fail
- * SIDE EFFECTS: modifies the PCB
+ * OUTPUTS: sets up the page directory, program image and PCB of the child
+ * RETURN VALUE: pid of the child, -1 if the command is bad,
+                 SPAWN_NO_SLOT if every process slot is taken
+ * SIDE EFFECTS: modifies the PCB, the child is a child of the caller
  */
-int32_t execute(const uint8_t* command) {
-    // DEBUG PRINT
-    //printf("## execute() - %s\n", command);
+int32_t spawn_process(const uint8_t* command) {
     /* declare variables */
     uint8_t filename[FILENAME_LEN];     /* holds the filename */
     uint8_t buffer[128];                /* buffer of size 128 */
     dentry_t dentry;                    /* program's file directory entry */
     uint8_t* program_image = (uint8_t *) 0x8048000; /* program's position */
-    uint32_t next_process;              /* holds the next process id */
+    int32_t next_process;               /* holds the next process id */
     uint32_t entry_point;               /* holds the entry location */
     uint32_t ret;                       /* return value */
+    uint32_t flags;
+    pcb_t* pcb;
+
+    if (command == NULL)
+        return -1;
+
+    /* nothing may preempt us while strtok state and CR3 are borrowed */
+    cli_and_save(flags);
 
     /* Returns first token and check string length */
     char* token = strtok((char*)command, " ");
-    if (token == NULL || strlen(token) >= (FILENAME_LEN - 1))
+    if (token == NULL || strlen(token) >= (FILENAME_LEN - 1)) {
+        restore_flags(flags);
         return -1;  // Filename error
+    }
 
     /* Get filename from command */
     strcpy((char*)filename, token);
 
-	/* Read the directory entry with the specified filename */
-	if (read_dentry_by_name(filename, &dentry) != 0)
-		return -1; // Couldn't find matching directory entry
-	if (dentry.filetype != FILE_TYPE_FILE)
-		return -1; // Wrong file type
-
-    /* Check if the file is a valid executable file, by checking */
-	// the first 4 bytes to see if it matches the magic number. 
-    // "7F 45 4C 46" is head. ".ELF"
-	if (read_data(dentry.inode_num, 0, buffer, 4) != 4)
-		return -1; // Read_data error
-    if (buffer[0] != 0x7F || buffer[1] != 0x45 || buffer[2] != 0x4C || buffer[3] != 0x46)
-		return -1; // File is not an executable
+	/* Read the directory entry with the specified filename, check if the
+	 * file is a valid executable file by checking the first 4 bytes to see
+	 * if it matches the magic number. "7F 45 4C 46" is head. ".ELF" */
+	if (read_dentry_by_name(filename, &dentry) != 0 ||
+	    dentry.filetype != FILE_TYPE_FILE ||
+	    read_data(dentry.inode_num, 0, buffer, 4) != 4 ||
+	    buffer[0] != 0x7F || buffer[1] != 0x45 || buffer[2] != 0x4C || buffer[3] != 0x46) {
+		restore_flags(flags);
+		return -1;
+	}
 
     // Cleanup arguments and copying into pcb->arg
     buffer[0] = '\0';
@@ -239,43 +414,50 @@ int32_t execute(const uint8_t* command) {
         token = strtok(NULL, " ");
     }
 
-    // Modifying page memory
-    next_process =  get_next_process_number();
+    // Slot 0 is reserved for the root shell, which has no parent
+    next_process = get_next_process_number(curr_process == PID_NONE ? 0 : 1);
     // if reached max process 
     if (next_process == -1)  {
         printf("You have reached the maximum number of processes! \n");
-        return 256;
+        restore_flags(flags);
+        return SPAWN_NO_SLOT;
     }
-    //                    128MB       8MB                           4MB         USER PDE 4MB BASE VALUE 
-    update_page_directory(0x08000000, 0x00800000 + next_process * 0x00400000, 0x87);
 
-    // Get the entire file size and read into memory
+    // Get process control block and the child's address space
+    pcb = getProcessPCB(next_process);
+    pcb->page_dir = paging_setup_process(next_process, paging_user_frame(next_process));
+
+    // Read file into image memory through the child's page directory
+    load_page_directory(pcb->page_dir);
     uint32_t size = flength(dentry.inode_num);
-    // Read file into image memory
 	if (read_data(dentry.inode_num, 0, program_image, size) != size) {
-        update_page_directory(0x08000000, 0x00800000 + curr_process * 0x00400000, 0x87);
+        load_page_directory(current_page_directory());
+        pid_array[next_process] = PROG_NOT_ACTIVE;
+        restore_flags(flags);
 		return -1; // Read_data error
     }
-
-    // Save esp in TSS
-    tss.esp0 = BASE_PROCESS_POSITION - (next_process + 1) * PROCESS_OFFSET - C_4B;
-
-    // Get process control block
-    pcb_t *pcb = (pcb_t *)(BASE_PROCESS_POSITION - (next_process + 2) * PROCESS_OFFSET);
+    // Entry point is in bytes 24 - 27
+    entry_point = *((uint32_t*)(program_image + 24));
+    load_page_directory(current_page_directory());
 
     // this should set files for stdin and stdout in file array
     init_file_array(pcb->file_array);
 
+    pcb->files = pcb->file_array;
+    shm_init_process(pcb);
+    mmap_init_process(pcb);
+    heap_init_process(pcb);
+
     // Give PCB parent process number
+    pcb->pid = next_process;
+    pcb->owner = next_process;
     pcb->parent_num = curr_process;
+    pcb->terminal_index = (curr_process == PID_NONE) ? 0 : getProcessPCB(curr_process)->terminal_index;
+    pcb->exit_status = 0;
+    pcb->wait_pid = WAIT_NONE;
 
-    // Save esp and ebp in PCB
-    asm("\t movl %%esp,%0" : "=r" (pcb->parent_esp));
-    asm("\t movl %%ebp,%0" : "=r" (pcb->parent_ebp));
-
-    // Give PCB return address that execute will return to
-    pcb->exec_ret_addr = &&end_of_execute;
-    pcb->terminal_index = getCurrentProcessPCB()->terminal_index;
+    strcpy((int8_t *)pcb->name, (const int8_t*)filename);
+    pcb->ticks = 0;
 
     // Fill pcb arguments
     strcpy((int8_t *)pcb->arg, (const int8_t*)buffer);
@@ -283,22 +465,226 @@ int32_t execute(const uint8_t* command) {
     // DEBUG PRINT
     //printf("## file = %s, arg(%d) = \"%s\"\n", filename, pcb->num_char_in_arg, pcb->arg);
 
-    // set current process as the process being switched into
-    curr_process = next_process;
-    pid_array[next_process] = PROG_ACTIVE;
+    // hand the child to the scheduler
+    start_task(pcb, entry_point, C_128MB + C_4MB - C_4B);
 
-    // Perform the context switch with entry point (bytes 24 - 27)
-    entry_point = *((uint32_t*)(program_image + 24));
-    context_switch(entry_point, C_128MB + C_4MB - C_4B);
+    restore_flags(flags);
+    return next_process;
+}
 
-end_of_execute:
-    // move eax into return value
-    asm("\t movl %%eax,%0" : "=r" (ret));
+/* wait_child
+ * DESCRIPTION: collects the exit status of a zombie child, blocking until
+                one exits unless WNOHANG is given
+ * INPUTS: pid -- child to wait for, -1 for any child
+ *         status -- where the exit status is stored
+ *         options -- WNOHANG to return 0 instead of blocking
+ * OUTPUTS: frees the slot of the collected child
+ * RETURN VALUE: pid of the collected child, 0 if WNOHANG and none exited,
+                 -1 if the caller has no such child
+ * SIDE EFFECTS: may block the caller
+ */
+int32_t wait_child(int32_t pid, int32_t* status, int32_t options) {
+    uint32_t flags;
+    uint32_t i;
+    int32_t found;
+    pcb_t * current_pcb;
+    pcb_t * child_pcb;
+
+    cli_and_save(flags);
+    current_pcb = getProcessPCB(curr_process);
+
+    while (1) {
+        found = 0;
+        for (i = 0; i < NUM_MAX_PROCESSES; i++) {
+            if (pid_array[i] == PROG_NOT_ACTIVE || i == curr_process) continue;
+            if (pid != -1 && pid != i) continue;
+            child_pcb = getProcessPCB(i);
+            if (child_pcb->parent_num != curr_process) continue;
+
+            found = 1;
+            if (child_pcb->state == TASK_ZOMBIE) {
+                *status = child_pcb->exit_status;
+                pid_array[i] = PROG_NOT_ACTIVE;
+                current_pcb->wait_pid = WAIT_NONE;
+                restore_flags(flags);
+                return i;
+            }
+        }
+
+        /* nothing to wait for */
+        if (!found || (options & WNOHANG)) {
+            current_pcb->wait_pid = WAIT_NONE;
+            restore_flags(flags);
+            return found ? 0 : -1;
+        }
+
+        /* sleep until a child exits, then look again */
+        current_pcb->wait_pid = pid;
+        task_block();
+    }
+}
+
+/* execute
+ * DESCRIPTION: system call for execute, spawns the process and waits
+                for it to halt
+ * INPUTS: command as character array
+ * OUTPUTS: sets new page directory and will set program in memory
+ * RETURN VALUE: exit status of the program, -1 if it could not be
+                 started, 256 if there was no free process slot
+ * SIDE EFFECTS: blocks the caller while the child runs
+ */
+int32_t execute(const uint8_t* command) {
+    // DEBUG PRINT
+    //printf("## execute() - %s\n", command);
+    int32_t pid, status;
+
+    pid = spawn_process(command);
+    if (pid == SPAWN_NO_SLOT)
+        return 256;
+    if (pid < 0)
+        return -1;
+
+    if (wait_child(pid, &status, 0) != pid)
+        return -1;
 
     // Return value passed by halt
+    return status;
+}
+
+/* spawn_fd_bad
+ * DESCRIPTION: checks an fd handed to spawn for the child's stdin/stdout
+ * INPUTS: files -- caller's file array, fd -- open fd, or -1 for the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if fd is neither -1 nor open, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t spawn_fd_bad(file_t* files, int32_t fd) {
+    if (fd == -1)
+        return 0;
+    return (fd < 0 || fd >= NUM_MAX_OPEN_FILES || files[fd].flags == FILE_AVAIL);
+}
+
+/* spawn
+ * DESCRIPTION: system call for spawn, starts a program in the background
+ * INPUTS: command as character array
+ *         in_fd, out_fd -- caller's fds the child gets as stdin/stdout
+ *                          (e.g. pipe ends), -1 to keep the terminal
+ * OUTPUTS: new runnable process
+ * RETURN VALUE: pid of the child on success, -1 on failure
+ * SIDE EFFECTS: the child runs concurrently with the caller
+ */
+int32_t spawn(const uint8_t* command, int32_t in_fd, int32_t out_fd) {
+    file_t* files = getCurrentProcessPCB()->files;
+    pcb_t* child;
+    uint32_t flags;
+    int32_t pid;
+
+    if (spawn_fd_bad(files, in_fd) || spawn_fd_bad(files, out_fd))
+        return -1;
+
+    /* the child must not run before its stdin/stdout are in place */
+    cli_and_save(flags);
+    pid = spawn_process(command);
+    if (pid < 0) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    child = getProcessPCB(pid);
+    if (in_fd != -1)
+        file_inherit(&child->files[0], &files[in_fd]);
+    if (out_fd != -1)
+        file_inherit(&child->files[1], &files[out_fd]);
+    restore_flags(flags);
+    return pid;
+}
+
+/* waitpid
+ * DESCRIPTION: system call for waitpid, collects a halted child
+ * INPUTS: pid -- child to wait for, -1 for any child
+ *         status -- user pointer for the exit status, may be NULL
+ *         options -- WNOHANG to poll instead of blocking
+ * OUTPUTS: writes the exit status to *status
+ * RETURN VALUE: pid of the child, 0 if WNOHANG and no child has halted,
+                 -1 on failure
+ * SIDE EFFECTS: may block the caller
+ */
+int32_t waitpid(int32_t pid, int32_t* status, int32_t options) {
+    int32_t child_status;
+    int32_t ret;
+
+    if (pid < -1 || pid >= NUM_MAX_PROCESSES)
+        return -1;
+    if (status != NULL && bad_userspace_addr(status, sizeof(int32_t)))
+        return -1;
+
+    ret = wait_child(pid, &child_status, options);
+    if (ret > 0 && status != NULL)
+        *status = child_status;
     return ret;
 }
 
+/* thread_create
+ * DESCRIPTION: system call for thread_create, starts another schedulable
+                context inside the calling process. The thread shares the
+                page directory and file table of the process but runs on
+                its own kernel stack. It begins at entry as if called as
+                entry(arg) on the user stack ending at stack_top; the
+                function must end with halt, which only ends the thread
+ * INPUTS: entry -- user function, arg -- its argument,
+ *         stack_top -- end of the user stack the caller set aside
+ * OUTPUTS: new runnable task
+ * RETURN VALUE: pid of the thread on success (waitpid joins it), -1 on failure
+ * SIDE EFFECTS: writes the argument frame at the top of the user stack
+ */
+int32_t thread_create(void* entry, void* arg, void* stack_top) {
+    uint32_t flags;
+    int32_t tid;
+    pcb_t* parent_pcb;
+    pcb_t* pcb;
+    uint32_t* user_stack = (uint32_t*)stack_top;
+
+    /* code is in the program page, the stack may also come from malloc */
+    if ((uint32_t)entry < PAGE_TOP || (uint32_t)entry > PAGE_BOTTOM)
+        return -1;
+    if (bad_userspace_addr(user_stack - 2, 2 * sizeof(uint32_t)))
+        return -1;
+
+    cli_and_save(flags);
+
+    tid = get_next_process_number(1);
+    if (tid == -1) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    parent_pcb = getProcessPCB(curr_process);
+    pcb = getProcessPCB(tid);
+
+    /* everything but the kernel stack comes from the process */
+    pcb->pid = tid;
+    pcb->owner = parent_pcb->owner;
+    pcb->parent_num = curr_process;
+    pcb->page_dir = parent_pcb->page_dir;
+    pcb->files = parent_pcb->files;
+    pcb->terminal_index = parent_pcb->terminal_index;
+    pcb->exit_status = 0;
+    pcb->wait_pid = WAIT_NONE;
+    pcb->arg[0] = '\0';
+    pcb->num_char_in_arg = 0;
+    strcpy((int8_t *)pcb->name, (const int8_t *)parent_pcb->name);
+    pcb->ticks = 0;
+
+    /* cdecl frame for entry(arg): argument, then a null return address */
+    *(--user_stack) = (uint32_t)arg;
+    *(--user_stack) = 0;
+
+    start_task(pcb, (uint32_t)entry, (uint32_t)user_stack);
+
+    restore_flags(flags);
+    return tid;
+}
+
 /* getargs
  * DESCRIPTION: system call for getargs
  * INPUTS:
@@ -344,21 +730,18 @@ int32_t vidmap(uint8_t** screen_start) {
     //printf("## vidmap() : %x\n", screen_start);
 
     // Check if address of buf is within the address range covered
-    if (screen_start == NULL || (uint32_t)screen_start < PAGE_TOP || (uint32_t)screen_start > PAGE_BOTTOM) 
+    if (bad_userspace_addr(screen_start, sizeof(uint8_t*)))
         return -1;
 
     // map text-mode video memory into user space at virtual 256MB
     *screen_start = (uint8_t*) 0x10000000; // 256 MB
 
-    //initialize page
-    page_directory[PAGE_VIDMAP] = (uint32_t)video_pages | 7;
+    //initialize page in the caller's own page directory
+    getCurrentProcessPCB()->page_dir[PAGE_VIDMAP] = (uint32_t)video_pages | 7;
     video_pages[0] = (uint32_t)VIDEO | 7;
 
     // flush tlb
-    asm volatile(
-        "movl %cr3, %eax \n \
-         movl %eax, %cr3"
-    );
+    flush_tlb();
 
     //assign pointer to the start of video memory
     *screen_start = (uint8_t*)PAGE_VIDMEM;
@@ -406,11 +789,56 @@ pcb_t * getCurrentProcessPCB(){
   return (pcb_t *)(esp & ~(PCB_MASK));
 }
 
+/*
+ * pcb_t * getProcessPCB(uint32_t pid)
+ *   DESCRIPTION: returns pointer to the PCB of process slot pid, which sits
+ *                at the low end of its 8KB kernel stack
+ *   INPUTS: pid -- process slot
+ *   OUTPUTS: none
+ *   RETURN VALUE: A pointer to the PCB
+ *   SIDE EFFECTS: none
+ */
 pcb_t * getProcessPCB(uint32_t pid){
-  return (pcb_t *)(0x800000 - (pid + 1) * 0x2000);
+  return (pcb_t *)(BASE_PROCESS_POSITION - (pid + 2) * PROCESS_OFFSET);
 }
 
+/*
+ * uint32_t get_kernel_stack_bottom(uint32_t pid)
+ *   DESCRIPTION: returns the first kernel stack address of process slot pid,
+ *                the value tss.esp0 holds while the process runs
+ *   INPUTS: pid -- process slot
+ *   OUTPUTS: none
+ *   RETURN VALUE: initial kernel ESP of the process
+ *   SIDE EFFECTS: none
+ */
 uint32_t get_kernel_stack_bottom(uint32_t pid){
-  return 0x800000 - pid * 0x2000 - 4;
+  return BASE_PROCESS_POSITION - (pid + 1) * PROCESS_OFFSET - C_4B;
+}
+
+/*
+ * int32_t bad_userspace_addr(const void* addr, int32_t len)
+ *   DESCRIPTION: checks a buffer a system call was handed. It has to lie
+ *                in the program page or in the caller's heap below the
+ *                break, where malloc puts it
+ *   INPUTS: addr -- user pointer, len -- bytes the call reads or writes
+ *   OUTPUTS: none
+ *   RETURN VALUE: 0 if the buffer is usable, 1 if not
+ *   SIDE EFFECTS: none
+ */
+int32_t bad_userspace_addr(const void* addr, int32_t len){
+  uint32_t start = (uint32_t)addr;
+  uint32_t heap_brk;
+
+  if (len <= 0)
+    return 1;
+  /* the program page ends where the vidmap page starts */
+  if (start >= PAGE_TOP && start < PAGE_VIDMEM && PAGE_VIDMEM - start >= (uint32_t)len)
+    return 0;
+  if (start < HEAP_START || start >= HEAP_END)
+    return 1;
+  heap_brk = getProcessPCB(getCurrentProcessPCB()->owner)->heap_brk;
+  if (start < heap_brk && heap_brk - start >= (uint32_t)len)
+    return 0;
+  return 1;
 }
 
@@ -11,7 +11,7 @@
 #define READ 1
 #define WRITE 2
 #define CLOSE 3
-#define NUM_MAX_PROCESSES 6
+#define NUM_MAX_PROCESSES 8
 #define NUM_MAX_OPEN_FILES 8
 #define PROG_NOT_ACTIVE 0
 #define PROG_ACTIVE 1
@@ -37,15 +37,33 @@
  */
 extern uint32_t num_processes;
 extern uint32_t curr_process;
+extern uint8_t pid_array[NUM_MAX_PROCESSES];
+
+/* waitpid options */
+#define WNOHANG 1
+/* pcb_t.wait_pid of a task that is not blocked in waitpid */
+#define WAIT_NONE (-2)
+/* spawn_process result when every process slot is in use */
+#define SPAWN_NO_SLOT (-2)
 
 extern int32_t open(const uint8_t* filename);
 extern int32_t close(int32_t fd);
 extern int32_t read(int32_t fd, void* buf, int32_t nbytes);
 extern int32_t write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t getdents(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t stat(const uint8_t* filename, stat_t* st);
+extern int32_t fstat(int32_t fd, stat_t* st);
+extern int32_t create(const uint8_t* filename);
+extern int32_t ftruncate(int32_t fd, uint32_t length);
+extern int32_t lseek(int32_t fd, int32_t offset, int32_t whence);
 extern int32_t halt(uint8_t status);
 extern int32_t execute(const uint8_t* command);
-extern void return_to_execute(uint8_t* exec_ret_addr, uint32_t parent_ebp, uint32_t parent_esp, uint8_t status);
-extern void context_switch(uint32_t entry_point, uint32_t position);
+extern int32_t spawn(const uint8_t* command, int32_t in_fd, int32_t out_fd);
+extern int32_t waitpid(int32_t pid, int32_t* status, int32_t options);
+extern int32_t spawn_process(const uint8_t* command);
+extern int32_t wait_child(int32_t pid, int32_t* status, int32_t options);
+extern void task_exit(int32_t status);
+extern int32_t thread_create(void* entry, void* arg, void* stack_top);
 extern int32_t getargs(uint8_t* buf, int32_t nbytes);
 extern int32_t vidmap(uint8_t** screen_start);
 extern int32_t set_handler(int32_t signum, void* handler);
@@ -54,6 +72,8 @@ extern int32_t sigreturn(void);
 extern pcb_t * getCurrentProcessPCB();
 extern pcb_t * getProcessPCB(uint32_t pid);
 extern uint32_t get_kernel_stack_bottom(uint32_t pid);
+/* 1 unless len bytes at addr are in the program page or the caller's heap */
+extern int32_t bad_userspace_addr(const void* addr, int32_t len);
 
 // typedefs for function pointers for close, read, write
 typedef int32_t (*CLOSEFUNC)(int32_t);
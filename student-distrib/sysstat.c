@@ -0,0 +1,121 @@
+#include "sysstat.h"
+#include "lib.h"
+#include "pcb.h"
+#include "syscalls.h"
+
+int32_t sysstat_on = 0;
+static sysstat_t stats[SYSSTAT_CALLS];
+
+/* sysstat_record
+ * DESCRIPTION: called by system_call_handler after a timed call returned,
+ *              adds it to the histogram of its number
+ * INPUTS: num -- system call number, 1 to SYSSTAT_CALLS - 1
+ *         start_lo, start_hi -- TSC before the dispatch
+ *         ret -- what the call returned
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void sysstat_record(uint32_t num, uint32_t start_lo, uint32_t start_hi, int32_t ret) {
+    uint64_t now, took;
+    uint32_t cycles, bucket, flags;
+
+    rdtsc(now);
+    if (num >= SYSSTAT_CALLS)
+        return;
+    took = now - (((uint64_t)start_hi << 32) | start_lo);
+    cycles = (took >> 32) ? 0xFFFFFFFF : (uint32_t)took;
+    for (bucket = 0; bucket < SYSSTAT_BUCKETS - 1 && (cycles >> (bucket + 1)) != 0; bucket++)
+        ;
+
+    /* a call can be interrupted by one that blocked, or by a task switch */
+    cli_and_save(flags);
+    stats[num].calls++;
+    if (ret == -1)
+        stats[num].errors++;
+    if (cycles > stats[num].max)
+        stats[num].max = cycles;
+    stats[num].buckets[bucket]++;
+    restore_flags(flags);
+}
+
+/* sysstat_get
+ * DESCRIPTION: copies the counts of one system call
+ * INPUTS: num -- system call number, st
+ * OUTPUTS: the counts in st
+ * RETURN VALUE: 0 on success, -1 if there is no such call
+ * SIDE EFFECTS: none
+ */
+int32_t sysstat_get(uint32_t num, sysstat_t* st) {
+    uint32_t flags;
+
+    if (num == 0 || num >= SYSSTAT_CALLS || st == NULL)
+        return -1;
+    cli_and_save(flags);
+    *st = stats[num];
+    restore_flags(flags);
+    st->num = num;
+    return 0;
+}
+
+/* sysstat_open, sysstat_close
+ * DESCRIPTION: the counts are shared by all openers; close gives the fd
+ *              back
+ * RETURN VALUE: 0, -1 if fd is not open
+ */
+int32_t sysstat_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t sysstat_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* sysstat_read
+ * DESCRIPTION: reads the counts like a file of SYSSTAT_CALLS - 1 records,
+ *              one per system call number from 1 up
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: whole sysstat_t records in buf
+ * RETURN VALUE: bytes read, 0 at the end, -1 if buf is NULL or nbytes
+ *               negative
+ * SIDE EFFECTS: advances the file position
+ */
+int32_t sysstat_read(int32_t fd, void* buf, int32_t nbytes) {
+    file_t* file = &getCurrentProcessPCB()->files[fd];
+    sysstat_t* out = (sysstat_t*)buf;
+    int32_t count = 0;
+    uint32_t num;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+    num = 1 + file->file_position / sizeof(sysstat_t);
+    while ((count + 1) * (int32_t)sizeof(sysstat_t) <= nbytes && sysstat_get(num, &out[count]) == 0) {
+        count++;
+        num++;
+    }
+    file->file_position += count * sizeof(sysstat_t);
+    return count * sizeof(sysstat_t);
+}
+
+/* sysstat_write
+ * DESCRIPTION: starts recording from zero, or stops it
+ * INPUTS: fd, buf -- an int32_t, nonzero to start, nbytes -- its size
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 if buf is not an int32_t
+ * SIDE EFFECTS: starting clears all counts
+ */
+int32_t sysstat_write(int32_t fd, const void* buf, int32_t nbytes) {
+    uint32_t flags;
+
+    if (buf == NULL || nbytes != sizeof(int32_t))
+        return -1;
+    cli_and_save(flags);
+    if (*(const int32_t*)buf != 0) {
+        memset(stats, 0, sizeof(stats));
+        sysstat_on = 1;
+    } else {
+        sysstat_on = 0;
+    }
+    restore_flags(flags);
+    return nbytes;
+}
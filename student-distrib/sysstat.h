@@ -0,0 +1,40 @@
+#ifndef SYSSTAT_H_
+#define SYSSTAT_H_
+
+#include "types.h"
+
+/* Latency histograms of the system calls, taken with rdtsc around the
+ * dispatch in system_call_handler while sysstat_on is set. Bucket b counts
+ * the calls that took 2^b to 2^(b+1) - 1 cycles (bucket 0 also counts 0).
+ * The "sysstat" device file reads back a sysstat_t per system call number;
+ * writing a nonzero int32_t clears the counts and starts recording, 0
+ * stops it */
+#define SYSSTAT_CALLS       29          /* numbers 1 to 28, see system_call_jump_table */
+#define SYSSTAT_BUCKETS     32
+#define SYSSTAT_FILENAME    "sysstat"   /* device file name for open */
+
+#ifndef ASM
+
+typedef struct sysstat_t {
+    uint32_t num;                       /* system call number */
+    uint32_t calls;
+    uint32_t errors;                    /* calls that returned -1 */
+    uint32_t max;                       /* cycles of the slowest call */
+    uint32_t buckets[SYSSTAT_BUCKETS];
+} sysstat_t;
+
+/* nonzero while calls are timed; system_call_handler tests it */
+extern int32_t sysstat_on;
+
+extern void sysstat_record(uint32_t num, uint32_t start_lo, uint32_t start_hi, int32_t ret);
+extern int32_t sysstat_get(uint32_t num, sysstat_t* st);
+
+/* ops of the "sysstat" device file, see sysstat_ops in filesys.c */
+extern int32_t sysstat_open(const uint8_t* filename);
+extern int32_t sysstat_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t sysstat_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t sysstat_close(int32_t fd);
+
+#endif /* ASM */
+
+#endif
@@ -76,7 +76,7 @@ terminal_read(int32_t fd, char *buffer, uint32_t num_chars) {
  */
 int32_t terminal_write(int32_t fd, char *buffer, uint32_t num_chars) {
     //uint32_t read_flag;
-    int32_t idx = 0;
+    uint32_t idx = 0;
 
     if (fd != 1) return -1;
 
@@ -90,13 +90,10 @@ int32_t terminal_write(int32_t fd, char *buffer, uint32_t num_chars) {
     /* ============= START critical section to write buffer ============= */
     //cli_and_save(read_flag);
 
-    while (buffer[idx] != '\0') {
-        /* write char to screen */
-        putc(buffer[idx]);
-        /* check if max amount to copy is reached */
-        if (++idx == num_chars)
-            break;
-    }
+    /* up to the first NUL or num_chars, written in one go */
+    while (idx < num_chars && buffer[idx] != '\0')
+        idx++;
+    console_write(buffer, idx);
 
     //restore_flags(read_flag);
     /* ============== END critical section to write buffer ============== */
@@ -10,6 +10,19 @@
 #include "filesys.h"
 #include "terminal.h"
 #include "syscalls.h"
+#include "futex.h"
+#include "pipe.h"
+#include "shm.h"
+#include "mmap.h"
+#include "heap.h"
+#include "fscache.h"
+#include "serial.h"
+#include "trace.h"
+#include "sysstat.h"
+#include "proc.h"
+#include "profile.h"
+#include "klog.h"
+#include "cpu.h"
 
 #define PASS 1
 #define FAIL 0
@@ -27,6 +40,67 @@ static inline void assertion_failure(){
 	asm volatile("int $15");
 }
 
+/* system call numbers, as in syscalls/ece391sysnum.h */
+#define SYS_READ	3
+#define SYS_WRITE	4
+#define SYS_OPEN	5
+#define SYS_CLOSE	6
+#define SYS_PIPE	16
+#define SYS_SBRK	22
+#define SYS_STAT	24
+#define SYS_FSTAT	25
+
+/* test_syscall
+ * makes a system call the way a program does, through int $0x80 and
+ * system_call_handler, and returns what it returned in EAX */
+static int32_t test_syscall(uint32_t num, uint32_t arg1, uint32_t arg2, uint32_t arg3){
+	int32_t ret;
+	asm volatile("int $0x80"
+			: "=a"(ret)
+			: "a"(num), "b"(arg1), "c"(arg2), "d"(arg3)
+			: "memory", "cc");
+	return ret;
+}
+
+/* test_files_init
+ * the tests run in the boot context, which is no process; give its PCB a
+ * fresh file array so that open has fds to hand out */
+static void test_files_init(){
+	pcb_t* pcb = getCurrentProcessPCB();
+
+	init_file_array(pcb->file_array);
+	pcb->files = pcb->file_array;
+}
+
+/* test_heap_init
+ * gives the boot context a one page heap the way malloc gets it, by sbrk,
+ * and backs the page up front since there is no process for
+ * page_fault_resolve to back it for. Returns HEAP_START, 0 on failure */
+static uint32_t test_heap_init(){
+	pcb_t* pcb = getCurrentProcessPCB();
+	uint32_t frame;
+
+	pcb->owner = PID_NONE;
+	pcb->page_dir = page_directory;
+	heap_init_process(pcb);
+	if(test_syscall(SYS_SBRK, PAGE_SIZE, 0, 0) != HEAP_START)
+		return 0;
+	if((frame = frame_alloc()) == 0 || paging_map_page(page_directory, HEAP_START, frame, USER_PTE_RW) != 0)
+		return 0;
+	return HEAP_START;
+}
+
+/* test_heap_release
+ * shrinks the heap of test_heap_init back to nothing, which frees its
+ * page. Returns 0, -1 if the page was not freed */
+static int32_t test_heap_release(){
+	if(test_syscall(SYS_SBRK, -PAGE_SIZE, 0, 0) != HEAP_START + PAGE_SIZE
+	   || paging_virt_to_phys(page_directory, HEAP_START) != 0)
+		return -1;
+	paging_release_tables(page_directory);
+	return 0;
+}
+
 
 /* ==================================== CHECKPOINT 1 TESTS =============================START== */
 #define NON_GENERGIC_IDT	19		/* 0-18 is non generic interrupts: total of 19 entries */
@@ -848,18 +922,1302 @@ int execute_test()  {
 /* =======================================================================================END== */
 
 
+/* =============================== CHECKPOINT 4 TESTS ==================================START== */
+
+/*
+ *	 spawn_wait_test()
+ *   DESCRIPTION: test that spawn and waitpid reject bad arguments before
+ 			   touching the process table
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: spawn, waitpid argument checks
+ *   FILES: syscalls.c
+ */
+int spawn_wait_test()  {
+	TEST_HEADER;
+	int32_t status;
+
+	/* no command, or a command that is not a program */
+	if(spawn(NULL, -1, -1) != -1)
+		return FAIL;
+	if(spawn((uint8_t*)"FAKE_FILE", -1, -1) != -1)
+		return FAIL;
+
+	/* pid out of range */
+	if(waitpid(-2, NULL, 0) != -1)
+		return FAIL;
+	if(waitpid(NUM_MAX_PROCESSES, NULL, 0) != -1)
+		return FAIL;
+
+	/* status pointer outside of the user page */
+	if(waitpid(-1, &status, WNOHANG) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 thread_create_test()
+ *   DESCRIPTION: test that thread_create only accepts an entry point in
+ 			   the program page and a stack in the program page or the
+ 			   heap, and that a thread on a stack from the heap starts
+ 			   with its argument frame on that stack
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: sets up the boot context's heap, maps and frees a heap
+ 			   page in the kernel page directory
+ *   COVERAGE: thread_create, bad_userspace_addr
+ *   FILES: syscalls.c
+ */
+int thread_create_test()  {
+	TEST_HEADER;
+	uint32_t* stack;
+	int32_t tid;
+
+	/* entry point in kernel memory */
+	if(thread_create((void*)KERNEL_LOCATION, NULL, (void*)PAGE_BOTTOM) != -1)
+		return FAIL;
+	/* no stack */
+	if(thread_create((void*)PAGE_TOP, NULL, NULL) != -1)
+		return FAIL;
+	/* stack above the program page */
+	if(thread_create((void*)PAGE_TOP, NULL, (void*)PAGE_VIDMEM + C_4B) != -1)
+		return FAIL;
+
+	/* a malloc'd stack, and one past the break */
+	if(test_heap_init() == 0)
+		return FAIL;
+	stack = (uint32_t*)(HEAP_START + PAGE_SIZE);
+	if(thread_create((void*)PAGE_TOP, NULL, stack + 1) != -1)
+		return FAIL;
+	if((tid = thread_create((void*)PAGE_TOP, (void*)0x1234, stack)) <= 0)
+		return FAIL;
+	/* it never runs: the tests are over before the scheduler starts */
+	pid_array[tid] = PROG_NOT_ACTIVE;
+	if(getProcessPCB(tid)->owner != PID_NONE || stack[-1] != 0x1234 || stack[-2] != 0)
+		return FAIL;
+	if(test_heap_release() != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 futex_test()
+ *   DESCRIPTION: test that futex wait and wake refuse words that are not
+ 			   aligned, so the caller never sleeps on a bad key
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: futex_wait, futex_wake argument checks
+ *   FILES: futex.c
+ */
+int futex_test()  {
+	TEST_HEADER;
+	int32_t word[2] = {0, 0};
+	int32_t* unaligned = (int32_t*)((uint8_t*)word + 1);
+
+	if(futex_wait(unaligned, 0) != -1)
+		return FAIL;
+	if(futex_wake(unaligned, 1) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 pipe_test()
+ *   DESCRIPTION: test that pipe wants a user array for the two fds and
+ 			   that pipes cannot be opened by name
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: pipe argument checks, pipe_open
+ *   FILES: pipe.c
+ */
+int pipe_test()  {
+	TEST_HEADER;
+	int32_t fds[2];
+
+	if(pipe(NULL) != -1)
+		return FAIL;
+	/* kernel stack array, not user memory */
+	if(pipe(fds) != -1)
+		return FAIL;
+	if(pipe_open((uint8_t*)"pipe") != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/* scratch page directory for frame_test */
+static uint32_t test_directory[NUM_ENTRIES] __attribute__((aligned(ALIGN_BITS)));
+
+/*
+ *	 frame_test()
+ *   DESCRIPTION: test that pool frames come back zeroed and page aligned,
+ 			   and that 4KB mappings build and release their page tables
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: frame_alloc, frame_free, paging_map_page, paging_unmap_page,
+ 			   paging_release_tables
+ *   FILES: paging.c
+ */
+int frame_test()  {
+	TEST_HEADER;
+	uint32_t frame, i;
+
+	frame = frame_alloc();
+	if(frame == 0 || (frame & (PAGE_SIZE - 1)))
+		return FAIL;
+	for(i = 0; i < PAGE_SIZE; i++) {
+		if(((uint8_t*)frame)[i] != 0)
+			return FAIL;
+	}
+	/* dirty it, it must be zeroed when handed out again */
+	((uint8_t*)frame)[0] = 0xAB;
+	frame_free(frame);
+	if(frame_alloc() != frame || ((uint8_t*)frame)[0] != 0)
+		return FAIL;
+
+	for(i = 0; i < NUM_ENTRIES; i++)
+		test_directory[i] = 0x2;
+	if(paging_map_page(test_directory, SHM_REGION_START, frame, USER_PTE_RW) != 0)
+		return FAIL;
+	if(paging_virt_to_phys(test_directory, SHM_REGION_START + 4) != frame + 4)
+		return FAIL;
+	/* the same page twice */
+	if(paging_map_page(test_directory, SHM_REGION_START, frame, USER_PTE_RW) != -1)
+		return FAIL;
+	if(paging_unmap_page(test_directory, SHM_REGION_START) != frame)
+		return FAIL;
+	if(paging_virt_to_phys(test_directory, SHM_REGION_START) != 0)
+		return FAIL;
+
+	paging_release_tables(test_directory);
+	if(test_directory[SHM_REGION_START >> PDE_IDX_SHIFT] & PAGE_PRESENT)
+		return FAIL;
+	frame_free(frame);
+
+	/* shm_map rejects bad sizes and addresses before touching anything */
+	if(shm_map(1, 0, NULL) != -1)
+		return FAIL;
+	if(shm_map(1, (SHM_MAX_PAGES + 1) * PAGE_SIZE, NULL) != -1)
+		return FAIL;
+	if(shm_map(1, PAGE_SIZE, (void*)(SHM_REGION_START + 1)) != -1)
+		return FAIL;
+	if(shm_map(1, PAGE_SIZE, (void*)PAGE_TOP) != -1)
+		return FAIL;
+	if(shm_unmap((void*)(SHM_REGION_START + 1)) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 file_block_test()
+ *   DESCRIPTION: test that file_block_addr finds the same bytes read_data
+ 			   copies, and rejects blocks past the inode. Also checks that
+ 			   mmap refuses fds that cannot be files
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: file_block_addr, mmap argument checks
+ *   FILES: filesys.c, mmap.c
+ */
+int file_block_test()  {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint8_t buf[32];
+	uint8_t* block;
+
+	if(read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) != 0)
+		return FAIL;
+	if(read_data(dentry.inode_num, 0, buf, sizeof(buf)) != sizeof(buf))
+		return FAIL;
+	if((block = file_block_addr(dentry.inode_num, 0)) == NULL)
+		return FAIL;
+	if(strncmp((int8_t*)block, (int8_t*)buf, sizeof(buf)) != 0)
+		return FAIL;
+	if(file_block_addr(dentry.inode_num, NUM_DATA_BLOCKS_IN_INODE) != NULL)
+		return FAIL;
+
+	/* stdin/stdout and out of range fds */
+	if(mmap(0, 1) != -1 || mmap(1, 1) != -1 || mmap(NUM_MAX_OPEN_FILES, 1) != -1)
+		return FAIL;
+	if(munmap(NULL) != -1 || munmap((void*)(MMAP_REGION_START + 1)) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/* indirect_boundary_ok
+ * reads 32 bytes on each side of the start of block index of a file from
+ * mkfs/mkpattern, and checks them against the two blocks file_block_addr
+ * finds and against the pattern (each word holds its offset / 4) */
+static int indirect_boundary_ok(uint32_t inode, uint32_t index){
+	uint32_t words[16];
+	uint8_t* buf = (uint8_t*)words;
+	uint8_t* before = file_block_addr(inode, index - 1);
+	uint8_t* after = file_block_addr(inode, index);
+	uint32_t half = sizeof(words) / 2;
+	uint32_t offset = index * NUM_B_IN_FOUR_KB - half;
+	uint32_t i;
+
+	if(before == NULL || after == NULL)
+		return 0;
+	if(read_data(inode, offset, buf, sizeof(words)) != sizeof(words))
+		return 0;
+	for(i = 0; i < half; i++){
+		if(buf[i] != before[NUM_B_IN_FOUR_KB - half + i] || buf[half + i] != after[i])
+			return 0;
+	}
+	for(i = 0; i < sizeof(words) / sizeof(words[0]); i++){
+		if(words[i] != offset / 4 + i)
+			return 0;
+	}
+	return 1;
+}
+
+/*
+ *	 indirect_block_test()
+ *   DESCRIPTION: test that every block inside every file of the image
+ 			   resolves, whichever format the image uses, that offsets
+ 			   past the double indirect block never do, and that reads
+ 			   across the first block behind the single and the double
+ 			   indirect block return the right bytes. Needs an image from
+ 			   "make image-test" in mkfs/, which adds indirect1 (past the
+ 			   direct blocks) and indirect2 (past the single indirect block)
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: file_block_addr, read_data
+ *   FILES: filesys.c
+ */
+int indirect_block_test()  {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint32_t i, index, length;
+	uint32_t single = FS_DIRECT_PTRS;
+	uint32_t twice = FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK;
+
+	for(i = 0; read_dentry_by_index(i, &dentry) == 0; i++){
+		if(dentry.filetype != FILE_TYPE_FILE)
+			continue;
+		length = flength(dentry.inode_num);
+		for(index = 0; index * NUM_B_IN_FOUR_KB < length; index++){
+			if(file_block_addr(dentry.inode_num, index) == NULL)
+				return FAIL;
+		}
+	}
+	index = FS_DIRECT_PTRS + FS_PTRS_PER_BLOCK + FS_PTRS_PER_BLOCK * FS_PTRS_PER_BLOCK;
+	if(file_block_addr(0, index) != NULL)
+		return FAIL;
+
+	if(read_dentry_by_name((uint8_t*)"indirect1", &dentry) != 0)
+		return FAIL;
+	if(flength(dentry.inode_num) <= single * NUM_B_IN_FOUR_KB || !indirect_boundary_ok(dentry.inode_num, single))
+		return FAIL;
+	if(read_dentry_by_name((uint8_t*)"indirect2", &dentry) != 0)
+		return FAIL;
+	if(flength(dentry.inode_num) <= twice * NUM_B_IN_FOUR_KB || !indirect_boundary_ok(dentry.inode_num, single)
+	   || !indirect_boundary_ok(dentry.inode_num, twice))
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 extent_read_test()
+ *   DESCRIPTION: test that reads crossing block boundaries return the same
+ 			   bytes as the blocks themselves, whether the file is copied
+ 			   as one extent or run by run, and that reads stop at EOF
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: read_data, find_extents
+ *   FILES: filesys.c
+ */
+int extent_read_test()  {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint8_t buf[64];
+	uint8_t* block;
+	uint32_t i, length;
+
+	if(read_dentry_by_name((uint8_t*)"fish", &dentry) != 0)
+		return FAIL;
+	length = flength(dentry.inode_num);
+	if(length <= 2 * NUM_B_IN_FOUR_KB)
+		return FAIL;
+
+	/* 32 bytes on each side of the first block boundary */
+	if(read_data(dentry.inode_num, NUM_B_IN_FOUR_KB - 32, buf, sizeof(buf)) != sizeof(buf))
+		return FAIL;
+	block = file_block_addr(dentry.inode_num, 0);
+	for(i = 0; i < 32; i++){
+		if(buf[i] != block[NUM_B_IN_FOUR_KB - 32 + i])
+			return FAIL;
+	}
+	block = file_block_addr(dentry.inode_num, 1);
+	for(i = 0; i < 32; i++){
+		if(buf[32 + i] != block[i])
+			return FAIL;
+	}
+
+	/* short read at the end, nothing past it */
+	if(read_data(dentry.inode_num, length - 10, buf, sizeof(buf)) != 10)
+		return FAIL;
+	if(read_data(dentry.inode_num, length, buf, sizeof(buf)) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 dentry_lookup_test()
+ *   DESCRIPTION: test that every name in the directory is found by name
+ 			   with the same entry it has by index, whether the directory
+ 			   is the boot block or hashed, and that unknown names are not
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: read_dentry_by_name, read_dentry_by_index, dir_init
+ *   FILES: filesys.c
+ */
+int dentry_lookup_test()  {
+	TEST_HEADER;
+	dentry_t by_index, by_name;
+	uint8_t name[FILENAME_LEN + 1];
+	uint32_t i;
+
+	for(i = 0; read_dentry_by_index(i, &by_index) == 0; i++){
+		if(by_index.filename[0] == '\0')
+			continue;
+		strncpy((int8_t*)name, by_index.filename, FILENAME_LEN);
+		name[FILENAME_LEN] = '\0';
+		if(read_dentry_by_name(name, &by_name) != 0)
+			return FAIL;
+		if(by_name.inode_num != by_index.inode_num || by_name.filetype != by_index.filetype)
+			return FAIL;
+	}
+	if(i == 0)
+		return FAIL;
+	if(read_dentry_by_name((uint8_t*)"no such file", &by_name) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 write_test()
+ *   DESCRIPTION: test that a new file written in odd sized pieces reads
+ 			   back the same, that truncating frees its blocks for the next
+ 			   round, and prints the read back speed in cycles per KB
+ *   INPUTS: none
+ *   OUTPUTS: cycles per KB of each read back
+ *   SIDE EFFECTS: leaves an empty write_test.txt in the file system
+ *   COVERAGE: create_file, write_data, truncate_data, block allocator
+ *   FILES: filesys.c
+ */
+#define WRITE_TEST_SIZE (64 * 1024)
+#define WRITE_TEST_PIECE 1000
+static uint8_t write_test_buf[WRITE_TEST_SIZE];
+int write_test()  {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint8_t piece[WRITE_TEST_PIECE];
+	uint32_t i, round, done, n;
+	uint64_t start, end;
+	int32_t inode;
+
+	if((inode = create_file((uint8_t*)"write_test.txt")) < 0){
+		if(read_dentry_by_name((uint8_t*)"write_test.txt", &dentry) != 0)
+			return FAIL;
+		inode = dentry.inode_num;
+	}
+	if(create_file((uint8_t*)"write_test.txt") != -1 || create_file((uint8_t*)"") != -1)
+		return FAIL;
+
+	for(round = 0; round < 3; round++){
+		if(truncate_data(inode, 0) != 0 || flength(inode) != 0)
+			return FAIL;
+
+		/* byte i of the file is (i * 7 + round) & 0xFF */
+		for(done = 0; done < WRITE_TEST_SIZE; done += n){
+			n = (WRITE_TEST_SIZE - done < WRITE_TEST_PIECE) ? WRITE_TEST_SIZE - done : WRITE_TEST_PIECE;
+			for(i = 0; i < n; i++)
+				piece[i] = ((done + i) * 7 + round) & 0xFF;
+			if(write_data(inode, done, piece, n) != n)
+				return FAIL;
+		}
+		if(flength(inode) != WRITE_TEST_SIZE)
+			return FAIL;
+
+		rdtsc(start);
+		if(read_data(inode, 0, write_test_buf, WRITE_TEST_SIZE) != WRITE_TEST_SIZE)
+			return FAIL;
+		rdtsc(end);
+		for(i = 0; i < WRITE_TEST_SIZE; i++){
+			if(write_test_buf[i] != ((i * 7 + round) & 0xFF))
+				return FAIL;
+		}
+		printf("round %d: %d cycles/KB\n", round, (uint32_t)(end - start) / (WRITE_TEST_SIZE / 1024));
+	}
+
+	/* shrinking keeps the head and reads zeros past it after growing */
+	if(truncate_data(inode, 10) != 0 || truncate_data(inode, 5000) != 0)
+		return FAIL;
+	if(read_data(inode, 0, write_test_buf, 5000) != 5000 || write_test_buf[9] != ((9 * 7 + 2) & 0xFF))
+		return FAIL;
+	for(i = 10; i < 5000; i++){
+		if(write_test_buf[i] != 0)
+			return FAIL;
+	}
+	if(truncate_data(inode, 0) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/* test_file_inode
+ * inode of a file the tests write, created the first time */
+static int32_t test_file_inode(const int8_t* name){
+	dentry_t dentry;
+	int32_t inode;
+
+	if((inode = create_file((uint8_t*)name)) >= 0)
+		return inode;
+	if(read_dentry_by_name((uint8_t*)name, &dentry) != 0)
+		return -1;
+	return dentry.inode_num;
+}
+
+/*
+ *	 mmap_truncate_test()
+ *   DESCRIPTION: test that a mapped file cannot be truncated shorter, so
+ 			   that another file growing cannot be handed the blocks the
+ 			   mapping shows, and that it can be once unmapped
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: leaves empty mmap_test.txt and mmap_grow.txt in the file
+ 			   system, sets up the boot context's file array and mmaps
+ *   COVERAGE: mmap, munmap, file_truncate, truncate_data, file_map_ref,
+ 			   file_map_unref, write_data
+ *   FILES: mmap.c, filesys.c
+ */
+#define MMAP_TEST_SIZE (3 * PAGE_SIZE)
+static uint8_t mmap_test_buf[MMAP_TEST_SIZE];
+int mmap_truncate_test()  {
+	TEST_HEADER;
+	pcb_t* pcb = getCurrentProcessPCB();
+	int32_t inode, grow, fd, virt;
+	uint32_t i, phys;
+
+	if((inode = test_file_inode("mmap_test.txt")) < 0 || (grow = test_file_inode("mmap_grow.txt")) < 0)
+		return FAIL;
+	if(truncate_data(inode, 0) != 0 || truncate_data(grow, 0) != 0)
+		return FAIL;
+	for(i = 0; i < MMAP_TEST_SIZE; i++)
+		mmap_test_buf[i] = (i * 13) & 0xFF;
+	if(write_data(inode, 0, mmap_test_buf, MMAP_TEST_SIZE) != MMAP_TEST_SIZE)
+		return FAIL;
+
+	/* the boot context maps into the scratch directory */
+	for(i = 0; i < NUM_ENTRIES; i++)
+		test_directory[i] = 0x2;
+	pcb->owner = PID_NONE;
+	pcb->page_dir = test_directory;
+	mmap_init_process(pcb);
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)"mmap_test.txt", 0, 0)) < 2)
+		return FAIL;
+	if((virt = mmap(fd, MMAP_TEST_SIZE)) == -1)
+		return FAIL;
+
+	/* shorter is refused, longer is not */
+	if(file_truncate(fd, 0) != -1 || file_truncate(fd, PAGE_SIZE + 1) != -1 || flength(inode) != MMAP_TEST_SIZE)
+		return FAIL;
+	if(file_truncate(fd, MMAP_TEST_SIZE + 1) != 0)
+		return FAIL;
+
+	/* blocks freed by the truncate would have gone to this file */
+	memset(mmap_test_buf, 0xFF, MMAP_TEST_SIZE);
+	if(write_data(grow, 0, mmap_test_buf, MMAP_TEST_SIZE) != MMAP_TEST_SIZE)
+		return FAIL;
+	for(i = 0; i < MMAP_TEST_SIZE; i++){
+		if((phys = paging_virt_to_phys(test_directory, virt + i)) == 0 || *(uint8_t*)phys != ((i * 13) & 0xFF))
+			return FAIL;
+	}
+
+	if(munmap((void*)virt) != 0 || file_truncate(fd, 0) != 0 || test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		return FAIL;
+	paging_release_tables(test_directory);
+	if(truncate_data(grow, 0) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 read_bench_test()
+ *   DESCRIPTION: test that every file reads back the same twice in a row
+ 			   and that the LZ4 decoder refuses malformed blocks, then
+ 			   prints the speed of each pass in cycles per KB. On a
+ 			   compressed image the first pass is mostly cache misses
+ *   INPUTS: none
+ *   OUTPUTS: cycles per KB of each pass, block cache counters
+ *   SIDE EFFECTS: fills the block cache
+ *   COVERAGE: read_data, fscache_block, lz4_decompress
+ *   FILES: filesys.c, fscache.c
+ */
+#define READ_BENCH_SIZE (64 * 1024)
+static uint8_t read_bench_buf[READ_BENCH_SIZE];
+int read_bench_test()  {
+	TEST_HEADER;
+	/* literals "ab", then a match of 8 at offset 2 */
+	static const uint8_t good[] = {0x24, 'a', 'b', 0x02, 0x00, 0x10, 'c'};
+	static const uint8_t far[] = {0x14, 'a', 0x05, 0x00};
+	uint8_t out[16];
+	dentry_t dentry;
+	fscache_stats_t stats;
+	uint32_t i, pass, total, sum[2], offset;
+	uint64_t start, end;
+	int32_t n;
+
+	if(lz4_decompress(good, sizeof(good), out, sizeof(out)) != 11 || out[9] != 'b' || out[10] != 'c')
+		return FAIL;
+	if(lz4_decompress(good, sizeof(good), out, 8) != -1 || lz4_decompress(far, sizeof(far), out, sizeof(out)) != -1)
+		return FAIL;
+
+	for(pass = 0; pass < 2; pass++){
+		total = 0;
+		sum[pass] = 0;
+		rdtsc(start);
+		for(i = 0; read_dentry_by_index(i, &dentry) == 0; i++){
+			if(dentry.filetype != FILE_TYPE_FILE)
+				continue;
+			for(offset = 0; (n = read_data(dentry.inode_num, offset, read_bench_buf, READ_BENCH_SIZE)) > 0; offset += n){
+				total += n;
+				sum[pass] = sum[pass] * 31 + read_bench_buf[0] + read_bench_buf[n - 1];
+			}
+			if(n != 0)
+				return FAIL;
+		}
+		rdtsc(end);
+		if(total < 1024)
+			return FAIL;
+		printf("pass %d: %d KB, %d cycles/KB\n", pass, total / 1024, (uint32_t)(end - start) / (total / 1024));
+	}
+	if(sum[0] != sum[1])
+		return FAIL;
+
+	fscache_get_stats(&stats);
+	if(stats.errors != 0)
+		return FAIL;
+	if(stats.hits + stats.misses + stats.raw != 0)
+		printf("cache: %d hits, %d misses, %d raw\n", stats.hits, stats.misses, stats.raw);
+
+	return PASS;
+}
+
+/*
+ *	 serial_test()
+ *   DESCRIPTION: test that the serial device is found by name, that
+ 			   device names win over image files, that writes queue all
+ 			   their bytes (more than the ring holds, so the full ring
+ 			   path runs), that bad writes are refused, and that programs
+ 			   can open, write and close it by system call
+ *   INPUTS: none
+ *   OUTPUTS: a line on COM1
+ *   SIDE EFFECTS: sends bytes to COM1, resets the boot context's fds
+ *   COVERAGE: serial_write, serial_flush, file_stat, lookup_file, open,
+ 			   write, close
+ *   FILES: serial.c, filesys.c, syscalls.c
+ */
+int serial_test()  {
+	TEST_HEADER;
+	static const int8_t line[] = "serial_test: ";
+	stat_t st;
+	uint32_t i;
+	int32_t fd;
+
+	if(file_stat((uint8_t*)SERIAL_FILENAME, &st) != 0 || st.filetype != FILE_TYPE_SERIAL)
+		return FAIL;
+	/* the image has programs named like these devices */
+	if(file_stat((uint8_t*)SYSSTAT_FILENAME, &st) != 0 || st.filetype != FILE_TYPE_SYSSTAT
+	   || file_stat((uint8_t*)PROFILE_FILENAME, &st) != 0 || st.filetype != FILE_TYPE_PROFILE)
+		return FAIL;
+	if(serial_write(0, NULL, 1) != -1 || serial_write(0, line, -1) != -1)
+		return FAIL;
+	for(i = 0; i <= SERIAL_BUF_SIZE / (sizeof(line) - 1); i++){
+		if(serial_write(0, line, sizeof(line) - 1) != sizeof(line) - 1)
+			return FAIL;
+	}
+	if(serial_write(0, "\n", 1) != 1)
+		return FAIL;
+
+	/* by name through the open system call, as a program opens it; close
+	   gives the fd back */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)SERIAL_FILENAME, 0, 0)) < 2)
+		return FAIL;
+	if(test_syscall(SYS_WRITE, fd, (uint32_t)line, sizeof(line) - 1) != sizeof(line) - 1
+	   || test_syscall(SYS_WRITE, fd, (uint32_t)"\n", 1) != 1)
+		return FAIL;
+	if(test_syscall(SYS_CLOSE, fd, 0, 0) != 0 || test_syscall(SYS_CLOSE, fd, 0, 0) != -1)
+		return FAIL;
+	serial_flush();
+
+	return PASS;
+}
+
+/*
+ *	 trace_test()
+ *   DESCRIPTION: test that events are only recorded while tracing is on,
+ 			   that reads drain whole records oldest first, that the
+ 			   trace device is found by name, and that a program can
+ 			   open, switch and read it by system call
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: drains the trace, leaves tracing as it was, resets the
+ 			   boot context's fds
+ *   COVERAGE: trace_event, trace_read, trace_write, file_stat, open, read,
+ 			   write, close
+ *   FILES: trace.c, filesys.c, syscalls.c
+ */
+int trace_test()  {
+	TEST_HEADER;
+	trace_rec_t recs[4];
+	stat_t st;
+	int32_t on = 1, off = 0, was_on = trace_on, fd, n, i, found;
+	int result = PASS;
+
+	if(file_stat((uint8_t*)TRACE_FILENAME, &st) != 0 || st.filetype != FILE_TYPE_TRACE)
+		return FAIL;
+	if(trace_write(0, &on, 1) != -1 || trace_read(0, NULL, sizeof(recs)) != -1)
+		return FAIL;
+
+	trace_write(0, &off, sizeof(off));
+	while(trace_read(0, recs, sizeof(recs)) > 0)
+		;
+	trace_event(TRACE_EXCEPTION, 1);
+	if(trace_read(0, recs, sizeof(recs)) != 0)
+		result = FAIL;
+
+	trace_write(0, &on, sizeof(on));
+	trace_event(TRACE_IRQ_ENTER, 8);
+	trace_event(TRACE_IRQ_EXIT, 8);
+	trace_event(TRACE_SWITCH, 3);
+	trace_write(0, &off, sizeof(off));
+
+	/* a read takes whole records only */
+	if(trace_read(0, recs, sizeof(trace_rec_t) + 4) != sizeof(trace_rec_t))
+		result = FAIL;
+	if(recs[0].event != TRACE_IRQ_ENTER || recs[0].arg != 8 || recs[0].pid != (uint16_t)curr_process)
+		result = FAIL;
+	if(trace_read(0, &recs[1], 3 * sizeof(trace_rec_t)) != 2 * sizeof(trace_rec_t))
+		result = FAIL;
+	if(recs[1].event != TRACE_IRQ_EXIT || recs[2].event != TRACE_SWITCH || recs[2].arg != 3)
+		result = FAIL;
+	if(recs[1].tsc_hi < recs[0].tsc_hi || (recs[1].tsc_hi == recs[0].tsc_hi && recs[1].tsc_lo < recs[0].tsc_lo))
+		result = FAIL;
+
+	/* what tracedump does: open "trace" by system call, turn it on and
+	   off, read the records back; the write that turned it off was
+	   traced on the way in */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)TRACE_FILENAME, 0, 0)) < 2)
+		return FAIL;
+	if(test_syscall(SYS_WRITE, fd, (uint32_t)&on, sizeof(on)) != sizeof(on)
+	   || test_syscall(SYS_WRITE, fd, (uint32_t)&off, sizeof(off)) != sizeof(off))
+		result = FAIL;
+	found = 0;
+	while((n = test_syscall(SYS_READ, fd, (uint32_t)recs, sizeof(recs))) > 0){
+		for(i = 0; i < n / (int32_t)sizeof(trace_rec_t); i++)
+			if(recs[i].event == TRACE_SYSCALL_ENTER && recs[i].arg == SYS_WRITE)
+				found = 1;
+	}
+	if(n != 0 || !found || test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		result = FAIL;
+
+	trace_write(0, &was_on, sizeof(was_on));
+	return result;
+}
+
+/*
+ *	 sysstat_test()
+ *   DESCRIPTION: test that timed calls land in the bucket of their cycle
+ 			   count, that errors are counted, that starting again
+ 			   clears the counts, and that a program can open and read
+ 			   the histograms by system call
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: clears the system call histograms, leaves timing as it
+ 			   was, resets the boot context's fds
+ *   COVERAGE: sysstat_record, sysstat_get, sysstat_write, file_stat, and
+ 			   sysstat_read through open, read, write, close
+ *   FILES: sysstat.c, filesys.c, syscalls.c
+ */
+int sysstat_test()  {
+	TEST_HEADER;
+	sysstat_t st, recs[3];
+	stat_t fst;
+	uint64_t now;
+	int32_t on = 1, was_on = sysstat_on, fd;
+	uint32_t b;
+	int result = PASS;
+
+	if(file_stat((uint8_t*)SYSSTAT_FILENAME, &fst) != 0 || fst.filetype != FILE_TYPE_SYSSTAT)
+		return FAIL;
+	if(sysstat_get(0, &st) != -1 || sysstat_get(SYSSTAT_CALLS, &st) != -1)
+		return FAIL;
+
+	sysstat_write(0, &on, sizeof(on));
+	rdtsc(now);
+	now -= 5000;
+	sysstat_record(3, (uint32_t)now, (uint32_t)(now >> 32), 10);
+	sysstat_record(3, (uint32_t)now, (uint32_t)(now >> 32), -1);
+	if(sysstat_get(3, &st) != 0 || st.num != 3 || st.calls != 2 || st.errors != 1 || st.max < 5000)
+		result = FAIL;
+	/* 5000 cycles and a bit are in bucket 12 (4096 up) or later */
+	for(b = 0; b < 12; b++){
+		if(st.buckets[b] != 0)
+			result = FAIL;
+	}
+
+	sysstat_write(0, &on, sizeof(on));
+	if(sysstat_get(3, &st) != 0 || st.calls != 0)
+		result = FAIL;
+
+	/* what the sysstat program does, by system call: start from zero,
+	   make a failing read, then read the records of calls 1 to 3 */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)SYSSTAT_FILENAME, 0, 0)) < 2)
+		return FAIL;
+	if(test_syscall(SYS_WRITE, fd, (uint32_t)&on, sizeof(on)) != sizeof(on))
+		result = FAIL;
+	test_syscall(SYS_READ, NUM_MAX_OPEN_FILES - 1, (uint32_t)&b, sizeof(b));
+	if(test_syscall(SYS_READ, fd, (uint32_t)recs, sizeof(recs)) != sizeof(recs))
+		result = FAIL;
+	if(recs[2].num != SYS_READ || recs[2].calls != 1 || recs[2].errors != 1)
+		result = FAIL;
+	if(test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		result = FAIL;
+
+	sysstat_write(0, &was_on, sizeof(was_on));
+	return result;
+}
+
+/*
+ *	 proc_test()
+ *   DESCRIPTION: test that the proc names resolve, that their text is made
+ 			   up with the expected headers, that the directory has no
+ 			   text of its own, and that programs can open and read the
+ 			   files and the directory by system call
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: resets the boot context's fds
+ *   COVERAGE: proc_lookup, proc_text, file_stat, and proc_read through
+ 			   open, read, close
+ *   FILES: proc.c, filesys.c, syscalls.c
+ */
+int proc_test()  {
+	TEST_HEADER;
+	static int8_t text[PROC_BUF_SIZE];
+	stat_t fst;
+	int32_t entry, fd, n, len;
+
+	if(proc_lookup((uint8_t*)PROC_DIRNAME) != PROC_DIR || proc_lookup((uint8_t*)"proc/none") != -1)
+		return FAIL;
+	if(proc_text(PROC_DIR, text, sizeof(text)) != -1)
+		return FAIL;
+	if(file_stat((uint8_t*)"proc/ps", &fst) != 0 || fst.filetype != FILE_TYPE_PROC)
+		return FAIL;
+
+	if((entry = proc_lookup((uint8_t*)"proc/ps")) <= 0 || proc_text(entry, text, sizeof(text)) <= 0
+	   || strncmp(text, "  PID", 5) != 0)
+		return FAIL;
+	if((entry = proc_lookup((uint8_t*)"proc/irq")) <= 0 || proc_text(entry, text, sizeof(text)) <= 0
+	   || strncmp(text, "IRQ", 3) != 0)
+		return FAIL;
+	if((entry = proc_lookup((uint8_t*)"proc/mem")) <= 0 || proc_text(entry, text, sizeof(text)) <= 0
+	   || strncmp(text, "pool_total_kb", 13) != 0)
+		return FAIL;
+	/* a short buffer gets cut, not overrun */
+	if((entry = proc_lookup((uint8_t*)"proc/uptime")) <= 0 || proc_text(entry, text, 2) > 2)
+		return FAIL;
+
+	/* what ps and top do, by system call: read a file in pieces until
+	   the end, and list the directory */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)"proc/ps", 0, 0)) < 2)
+		return FAIL;
+	for(len = 0; (n = test_syscall(SYS_READ, fd, (uint32_t)(text + len), 16)) > 0; len += n)
+		;
+	if(n != 0 || len < 5 || strncmp(text, "  PID", 5) != 0 || test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		return FAIL;
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)PROC_DIRNAME, 0, 0)) < 2)
+		return FAIL;
+	if(test_syscall(SYS_READ, fd, (uint32_t)text, sizeof(text)) != 2 || strncmp(text, "ps", 2) != 0
+	   || test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 profile_test()
+ *   DESCRIPTION: test that a sample keeps the interrupted EIP, CPL and
+ 			   task, follows a frame pointer chain until it stops going
+ 			   up the stack, does not follow a kernel chain from user
+ 			   mode, and that a program can start, stop and read the
+ 			   profiler by system call
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: drops the samples of a profile in progress and leaves
+ 			   the profiler stopped, resets the boot context's fds
+ *   COVERAGE: profile_start, profile_sample, profile_read, profile_write,
+ 			   and the device through open, read, write, close
+ *   FILES: profile.c, filesys.c, syscalls.c
+ */
+int profile_test()  {
+	TEST_HEADER;
+	profile_sample_t out[3];
+	profile_regs_t regs;
+	uint32_t chain[8];
+	stat_t fst;
+	int32_t cmd = PROFILE_STOP, bad = 7, fd;
+	int result = PASS;
+
+	if(file_stat((uint8_t*)PROFILE_FILENAME, &fst) != 0 || fst.filetype != FILE_TYPE_PROFILE)
+		return FAIL;
+	if(profile_write(0, &bad, sizeof(bad)) != -1)
+		return FAIL;
+
+	/* two frames; the second one points back down the stack */
+	memset(chain, 0, sizeof(chain));
+	chain[0] = (uint32_t)&chain[4];
+	chain[1] = 0x1111;
+	chain[4] = (uint32_t)&chain[0];
+	chain[5] = 0x2222;
+	memset(&regs, 0, sizeof(regs));
+	regs.eip = 0x4321;
+	regs.cs = KERNEL_CS;
+	regs.ebp = (uint32_t)&chain[0];
+
+	profile_start();
+	profile_sample(&regs);
+	regs.cs = USER_CS;
+	profile_sample(&regs);
+	profile_write(0, &cmd, sizeof(cmd));
+	profile_sample(&regs);				/* stopped, not recorded */
+
+	if(profile_read(0, out, sizeof(out)) != 2 * sizeof(profile_sample_t))
+		return FAIL;
+	if(out[0].eip != 0x4321 || out[0].cpl != 0 || out[0].pid != (uint16_t)curr_process)
+		result = FAIL;
+	if(out[0].frames[0] != 0x1111 || out[0].frames[1] != 0x2222 || out[0].frames[2] != 0)
+		result = FAIL;
+	if(curr_process == PID_NONE && out[0].prog != PROFILE_NO_PROG)
+		result = FAIL;
+	if(out[1].cpl != 3 || out[1].frames[0] != 0)
+		result = FAIL;
+	if(profile_read(0, out, sizeof(out)) != 0)
+		result = FAIL;
+
+	/* what "profile start" and "profile stop" do, by system call, with
+	   a sample taken in between */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)PROFILE_FILENAME, 0, 0)) < 2)
+		return FAIL;
+	cmd = PROFILE_START;
+	if(test_syscall(SYS_WRITE, fd, (uint32_t)&cmd, sizeof(cmd)) != sizeof(cmd))
+		result = FAIL;
+	regs.cs = KERNEL_CS;
+	profile_sample(&regs);
+	cmd = PROFILE_STOP;
+	if(test_syscall(SYS_WRITE, fd, (uint32_t)&cmd, sizeof(cmd)) != sizeof(cmd))
+		result = FAIL;
+	if(test_syscall(SYS_READ, fd, (uint32_t)out, sizeof(out)) != sizeof(profile_sample_t) || out[0].eip != 0x4321)
+		result = FAIL;
+	if(test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		result = FAIL;
+
+	return result;
+}
+
+/*
+ *	 irq_stat_test()
+ *   DESCRIPTION: test that a handler run is counted and timed on its own
+ 			   line, and that a section with interrupts masked by
+ 			   cli_and_save is timed when it ends
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: counts a made up interrupt on IRQ 15
+ *   COVERAGE: irq_enter, irq_exit, irq_avg_cycles, irqoff_begin, irqoff_end
+ *   FILES: i8259.c, lib.h
+ */
+int irq_stat_test()  {
+	TEST_HEADER;
+	uint32_t count = irq_counts[NUM_IRQ], other = irq_counts[NUM_IRQ - 1];
+	uint64_t cycles = irq_cycles[NUM_IRQ];
+	uint32_t flags, i;
+	int result = PASS;
+
+	irq_enter(NUM_IRQ);
+	for(i = 0; i < 1000; i++)
+		asm volatile ("" : : : "memory");
+	irq_exit(NUM_IRQ);
+	if(irq_counts[NUM_IRQ] != count + 1 || irq_counts[NUM_IRQ - 1] != other)
+		result = FAIL;
+	if(irq_cycles[NUM_IRQ] <= cycles || irq_max_cycles[NUM_IRQ] == 0 || irq_avg_cycles(NUM_IRQ) == 0)
+		result = FAIL;
+
+	/* only a section that really masked interrupts is timed */
+	cli_and_save(flags);
+	for(i = 0; i < 1000; i++)
+		asm volatile ("" : : : "memory");
+	restore_flags(flags);
+	if((flags & EFLAGS_IF) && (irqoff_max_cycles == 0 || irqoff_max_file == NULL))
+		result = FAIL;
+
+	return result;
+}
+
+/*
+ *	 snprintf_test()
+ *   DESCRIPTION: test the conversions and field widths of snprintf, that
+ 			   a short buffer is cut and NUL terminated, and that the
+ 			   whole length is returned anyway
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: snprintf, vsnprintf
+ *   FILES: lib.c
+ */
+int snprintf_test()  {
+	TEST_HEADER;
+	int8_t buf[48];
+	int result = PASS;
+
+	if(snprintf(buf, sizeof(buf), "%d %u %x %#x %c%s%%", -12, 34, 0xBEEF, 0xE, 'Z', "s") != 24
+	   || strncmp(buf, "-12 34 BEEF 0000000E Zs%", sizeof(buf)) != 0)
+		result = FAIL;
+	if(snprintf(buf, sizeof(buf), "[%5u][%-5u][%05d][%-4s]", 42, 42, -42, "ab") != 27
+	   || strncmp(buf, "[   42][42   ][-0042][ab  ]", sizeof(buf)) != 0)
+		result = FAIL;
+	if(snprintf(buf, 5, "%s", "abcdefgh") != 8 || strncmp(buf, "abcd", sizeof(buf)) != 0)
+		result = FAIL;
+	if(snprintf(buf, sizeof(buf), "%s", NULL) != 6)
+		result = FAIL;
+
+	return result;
+}
+
+/*
+ *	 klog_test()
+ *   DESCRIPTION: test that printf output lands in the kernel log, that
+ 			   a program can read it by opening "kmsg", and that a reader
+ 			   left behind by a full ring skips to the oldest byte still
+ 			   kept
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: prints two lines, fills the kernel log with filler,
+ 			   sets up the boot context's file array
+ *   COVERAGE: printf, klog_append, klog_text, klog_read, klog_close,
+ 			   open, read, close, file_stat
+ *   FILES: klog.c, lib.c, filesys.c, syscalls.c
+ */
+int klog_test()  {
+	TEST_HEADER;
+	static int8_t text[KLOG_SIZE];
+	int8_t filler[64];
+	uint32_t pos = 0, n, end, i;
+	int32_t fd, ret;
+	stat_t fst;
+
+	if(file_stat((uint8_t*)KLOG_FILENAME, &fst) != 0 || fst.filetype != FILE_TYPE_KMSG)
+		return FAIL;
+
+	/* the end of the log is where the next line goes */
+	while(klog_text(&pos, text, sizeof(text)) != 0)
+		;
+	end = pos;
+	printf("klog_test %d\n", 42);
+	if(klog_text(&pos, text, sizeof(text)) != 13 || strncmp(text, "klog_test 42\n", 13) != 0)
+		return FAIL;
+
+	/* what dmesg does, by system call: read from the oldest byte to the
+	   end, then get a new line and nothing after it */
+	test_files_init();
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)KLOG_FILENAME, 0, 0)) < 2)
+		return FAIL;
+	while((ret = test_syscall(SYS_READ, fd, (uint32_t)text, sizeof(text))) > 0)
+		;
+	if(ret != 0)
+		return FAIL;
+	printf("klog_test %d\n", 43);
+	if(test_syscall(SYS_READ, fd, (uint32_t)text, sizeof(text)) != 13 || strncmp(text, "klog_test 43\n", 13) != 0
+	   || test_syscall(SYS_READ, fd, (uint32_t)text, sizeof(text)) != 0)
+		return FAIL;
+	if(test_syscall(SYS_CLOSE, fd, 0, 0) != 0 || test_syscall(SYS_CLOSE, fd, 0, 0) != -1)
+		return FAIL;
+
+	/* end is now older than anything kept */
+	memset(filler, '.', sizeof(filler));
+	for(i = 0; i < KLOG_SIZE / sizeof(filler) + 1; i++)
+		klog_append(filler, sizeof(filler));
+	pos = end;
+	n = klog_text(&pos, text, sizeof(text));
+	if(n != KLOG_SIZE || text[0] != '.' || klog_text(&pos, text, sizeof(text)) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 mem_dispatch_test()
+ *   DESCRIPTION: test that cpu_init picked the memory routines its CPUID
+ 			   features call for, that every variant copies and sets
+ 			   exactly the bytes asked for at any alignment, that memmove
+ 			   handles overlap both ways, and the dword string routines
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: cpu_init, cpu_has, mem_variants, memmove, strlen, strncmp, strcpy
+ *   FILES: cpu.c, lib.c
+ */
+int mem_dispatch_test()  {
+	TEST_HEADER;
+	static uint8_t src[160], dst[160];
+	int8_t str[48];
+	uint32_t v, n, off, i, flags;
+
+	if(mem_ops != &mem_variants[cpu_has(CPU_ERMS) ? MEM_MOVSB : MEM_MOVSL])
+		return FAIL;
+	if(cpu_has(CPU_ERMS | CPU_SSE2) && !cpu_has(CPU_CPUID))
+		return FAIL;
+
+	for(v = 0; v < MEM_VARIANTS; v++) {
+		for(n = 0; n < 70; n++) {
+			for(off = 0; off < 4; off++) {
+				for(i = 0; i < sizeof(src); i++) {
+					src[i] = i * 7 + 1;
+					dst[i] = 0xEE;
+				}
+				if(mem_variants[v].copy(dst + off, src + 3, n) != dst + off)
+					return FAIL;
+				for(i = 0; i < sizeof(dst); i++)
+					if(dst[i] != (i >= off && i < off + n ? src[i - off + 3] : 0xEE))
+						return FAIL;
+				memset(dst, 0xEE, sizeof(dst));
+				if(mem_variants[v].set(dst + off, 0x1A5, n) != dst + off)
+					return FAIL;
+				for(i = 0; i < sizeof(dst); i++)
+					if(dst[i] != (i >= off && i < off + n ? 0xA5 : 0xEE))
+						return FAIL;
+			}
+		}
+	}
+
+	/* overlapping both ways; a backward move must leave DF clear */
+	for(i = 0; i < sizeof(src); i++)
+		src[i] = i;
+	memmove(src + 5, src, 100);
+	for(i = 0; i < 100; i++)
+		if(src[i + 5] != i)
+			return FAIL;
+	asm volatile ("pushfl; popl %0" : "=r"(flags));
+	if(flags & 0x400)
+		return FAIL;
+	memmove(src, src + 5, 100);
+	for(i = 0; i < 100; i++)
+		if(src[i] != i)
+			return FAIL;
+
+	for(off = 0; off < 4; off++) {
+		memset(str, 'x', sizeof(str));
+		str[off + 21] = '\0';
+		if(strlen(str + off) != 21)
+			return FAIL;
+	}
+	strcpy(str + 1, "dispatch table");
+	if(strncmp(str + 1, "dispatch table", 20) != 0 || strncmp(str + 1, "dispatch tablf", 20) >= 0
+	   || strncmp(str + 1, "dispatch tab", 12) != 0)
+		return FAIL;
+	strcpy(str, "aligned words here");
+	if(strncmp(str, "aligned words herd", 20) <= 0 || strncmp(str, "aligned words here\0x", 21) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 heap_test()
+ *   DESCRIPTION: test that a new process starts with an empty heap and that
+ 			   page faults outside of a process are never papered over
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: none
+ *   COVERAGE: heap_init_process, page_fault_resolve
+ *   FILES: heap.c
+ */
+int heap_test()  {
+	TEST_HEADER;
+	pcb_t pcb;
+
+	heap_init_process(&pcb);
+	if(pcb.heap_brk != HEAP_START)
+		return FAIL;
+	/* the tests run before any process exists */
+	if(curr_process == PID_NONE && page_fault_resolve(0) != -1)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 getdents_test()
+ *   DESCRIPTION: test that getdents refuses fds that cannot be open and
+ 			   buffers outside the caller's memory, and that the record
+ 			   header keeps names 4-byte aligned
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: sets up the boot context's file array
+ *   COVERAGE: getdents and directory_getdents argument checks, dirent_t
+ 			   layout
+ *   FILES: filesys.c, syscalls.c
+ */
+int getdents_test()  {
+	TEST_HEADER;
+	uint8_t buf[64];
+	int32_t fd;
+
+	if(directory_getdents(-1, buf, sizeof(buf)) != -1)
+		return FAIL;
+	if(directory_getdents(NUM_MAX_OPEN_FILES, buf, sizeof(buf)) != -1)
+		return FAIL;
+	if(sizeof(dirent_t) != 12)
+		return FAIL;
+
+	/* an open directory, but buf is on the kernel stack */
+	test_files_init();
+	if((fd = directory_open((uint8_t*)".")) < 2)
+		return FAIL;
+	if(directory_getdents(fd, buf, sizeof(buf)) <= 0 || getdents(fd, buf, sizeof(buf)) != -1)
+		return FAIL;
+	if(directory_close(fd) != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/*
+ *	 stat_test()
+ *   DESCRIPTION: test that stat reports type, inode, length and blocks of
+ 			   files by name, refuses kernel pointers, and that stat,
+ 			   fstat and pipe take a buffer sbrk gave, as malloc does, but
+ 			   not one past the break
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   SIDE EFFECTS: sets up the boot context's file array and heap, maps
+ 			   and frees a heap page in the kernel page directory
+ *   COVERAGE: file_stat, file_fstat, pipe, sbrk, bad_userspace_addr
+ *   FILES: filesys.c, syscalls.c, pipe.c, heap.c
+ */
+int stat_test()  {
+	TEST_HEADER;
+	dentry_t dentry;
+	stat_t st;
+	stat_t* heap_st;
+	int32_t* heap_fds;
+	int32_t fd;
+
+	if(read_dentry_by_name((uint8_t*)"frame0.txt", &dentry) != 0)
+		return FAIL;
+	if(file_stat((uint8_t*)"frame0.txt", &st) != 0)
+		return FAIL;
+	if(st.filetype != FILE_TYPE_FILE || st.inode_num != dentry.inode_num)
+		return FAIL;
+	if(st.length != flength(dentry.inode_num) || st.blocks != (st.length + 4095) / 4096)
+		return FAIL;
+
+	if(file_stat((uint8_t*)".", &st) != 0 || st.filetype != FILE_TYPE_DIR || st.length != 0)
+		return FAIL;
+	if(file_stat((uint8_t*)"FAKE_FILE", &st) != -1)
+		return FAIL;
+	/* st on the kernel stack */
+	if(stat((uint8_t*)"frame0.txt", &st) != -1)
+		return FAIL;
+
+	test_files_init();
+	if(test_heap_init() == 0)
+		return FAIL;
+	heap_st = (stat_t*)(HEAP_START + 16);
+	heap_fds = (int32_t*)(HEAP_START + 64);
+
+	if(test_syscall(SYS_STAT, (uint32_t)"frame0.txt", (uint32_t)heap_st, 0) != 0 || heap_st->inode_num != dentry.inode_num)
+		return FAIL;
+	if((fd = test_syscall(SYS_OPEN, (uint32_t)"frame0.txt", 0, 0)) < 2)
+		return FAIL;
+	heap_st->length = 0;
+	if(test_syscall(SYS_FSTAT, fd, (uint32_t)heap_st, 0) != 0 || heap_st->length != st.length
+	   || test_syscall(SYS_CLOSE, fd, 0, 0) != 0)
+		return FAIL;
+	if(test_syscall(SYS_PIPE, (uint32_t)heap_fds, 0, 0) != 0
+	   || test_syscall(SYS_CLOSE, heap_fds[0], 0, 0) != 0 || test_syscall(SYS_CLOSE, heap_fds[1], 0, 0) != 0)
+		return FAIL;
+	/* straddling the break */
+	if(test_syscall(SYS_STAT, (uint32_t)"frame0.txt", HEAP_START + PAGE_SIZE - 4, 0) != -1)
+		return FAIL;
+
+	if(test_heap_release() != 0)
+		return FAIL;
+
+	return PASS;
+}
+
+/* =======================================================================================END== */
+
+
 /* Test suite entry point */
 void launch_tests(){
 	//TEST_OUTPUT("idt_test", idt_test());
-	
-	/* so we can see test outputs*/
-	volatile unsigned long arb = 0;
-	while(arb < STALL_TIME) arb++; 
 
-	/* so the screen does not overwrite */
+	/* the boot messages stay in the kernel log, see dmesg */
 	clear();
 	printf(" ========== STARTING TESTS ==========\n");
 
+	/* ============================================== launch CHECKPOINT 4 TESTS here */
+	// TEST_OUTPUT("spawn_wait_test()", spawn_wait_test());
+	// TEST_OUTPUT("thread_create_test()", thread_create_test());
+	// TEST_OUTPUT("futex_test()", futex_test());
+	// TEST_OUTPUT("pipe_test()", pipe_test());
+	// TEST_OUTPUT("frame_test()", frame_test());
+	// TEST_OUTPUT("file_block_test()", file_block_test());
+	// TEST_OUTPUT("indirect_block_test()", indirect_block_test());
+	// TEST_OUTPUT("extent_read_test()", extent_read_test());
+	// TEST_OUTPUT("dentry_lookup_test()", dentry_lookup_test());
+	// TEST_OUTPUT("write_test()", write_test());
+	// TEST_OUTPUT("mmap_truncate_test()", mmap_truncate_test());
+	// TEST_OUTPUT("read_bench_test()", read_bench_test());
+	// TEST_OUTPUT("serial_test()", serial_test());
+	// TEST_OUTPUT("trace_test()", trace_test());
+	// TEST_OUTPUT("sysstat_test()", sysstat_test());
+	// TEST_OUTPUT("proc_test()", proc_test());
+	// TEST_OUTPUT("profile_test()", profile_test());
+	// TEST_OUTPUT("irq_stat_test()", irq_stat_test());
+	// TEST_OUTPUT("snprintf_test()", snprintf_test());
+	// TEST_OUTPUT("klog_test()", klog_test());
+	// TEST_OUTPUT("mem_dispatch_test()", mem_dispatch_test());
+	// TEST_OUTPUT("heap_test()", heap_test());
+	// TEST_OUTPUT("getdents_test()", getdents_test());
+	// TEST_OUTPUT("stat_test()", stat_test());
+	/* ============================================================== END CKPT4 ==== */
+
 	/* ============================================== launch CHECKPOINT 3 TESTS here */
 	// TEST_OUTPUT("open_sys_test()", open_sys_test());
 	// TEST_OUTPUT("close_sys_test()", close_sys_test());
@@ -909,7 +2267,5 @@ void launch_tests(){
 
 
 
-/* =============================== CHECKPOINT 4 TESTS ========================START== */
-/* =============================================================================END== */
 /* =============================== CHECKPOINT 5 TESTS ========================START== */
 /* =============================================================================END== */
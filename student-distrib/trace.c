@@ -0,0 +1,159 @@
+#include "trace.h"
+#include "lib.h"
+#include "serial.h"
+#include "syscalls.h"
+#include "filesys.h"
+
+/* A writer never waits for anything: the ring belongs to its CPU and a
+ * record is filled with interrupts off on that CPU, so no other writer can
+ * tear it. head counts every record ever written, tail the ones drained;
+ * head - tail over TRACE_RECORDS means the oldest ones were overwritten */
+typedef struct trace_cpu_t {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t lost;                  /* overwritten before they were drained */
+    trace_rec_t recs[TRACE_RECORDS];
+} trace_cpu_t;
+
+int32_t trace_on = 0;
+static trace_cpu_t trace_cpus[TRACE_CPUS];
+
+/* trace_event
+ * DESCRIPTION: appends a record to the ring of this CPU if tracing is on
+ * INPUTS: event -- TRACE_*, arg -- meaning depends on the event
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: may overwrite the oldest record
+ */
+void trace_event(uint32_t event, uint32_t arg) {
+    trace_cpu_t* cpu = &trace_cpus[0];
+    trace_rec_t* rec;
+    uint64_t now;
+    uint32_t flags;
+
+    if (!trace_on)
+        return;
+
+    cli_and_save(flags);
+    rec = &cpu->recs[cpu->head & (TRACE_RECORDS - 1)];
+    rdtsc(now);
+    rec->tsc_lo = (uint32_t)now;
+    rec->tsc_hi = (uint32_t)(now >> 32);
+    rec->event = event;
+    rec->pid = curr_process;
+    rec->arg = arg;
+    cpu->head++;
+    restore_flags(flags);
+}
+
+/* trace_take
+ * DESCRIPTION: takes the oldest record that has not been drained yet
+ * INPUTS: cpu -- ring to drain
+ * OUTPUTS: the record in rec
+ * RETURN VALUE: 1 if there was one, 0 if the ring is empty
+ * SIDE EFFECTS: counts records that were overwritten as lost
+ */
+static int32_t trace_take(trace_cpu_t* cpu, trace_rec_t* rec) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    if (cpu->head - cpu->tail > TRACE_RECORDS) {
+        cpu->lost += cpu->head - cpu->tail - TRACE_RECORDS;
+        cpu->tail = cpu->head - TRACE_RECORDS;
+    }
+    if (cpu->tail == cpu->head) {
+        restore_flags(flags);
+        return 0;
+    }
+    *rec = cpu->recs[cpu->tail & (TRACE_RECORDS - 1)];
+    cpu->tail++;
+    restore_flags(flags);
+    return 1;
+}
+
+/* trace_dump
+ * DESCRIPTION: drains every ring to COM1 as text, one line per record:
+ *                  TRACE <tsc> <event> <pid> <arg>
+ *              all in hex, and TRACE_LOST <count> if records were
+ *              overwritten before they were drained. The format that
+ *              syscalls/ece391tracedump.c writes and host/tracedecode.c
+ *              reads. Called by stop() so that a fatal exception leaves
+ *              the events that led up to it
+ * INPUTS: none
+ * OUTPUTS: the lines on COM1
+ * RETURN VALUE: none
+ * SIDE EFFECTS: waits for the UART to send them
+ */
+void trace_dump(void) {
+    trace_rec_t rec;
+    uint32_t i;
+
+    for (i = 0; i < TRACE_CPUS; i++) {
+        while (trace_take(&trace_cpus[i], &rec)) {
+            serial_puts("TRACE ");
+            serial_puthex(rec.tsc_hi, 8);
+            serial_puthex(rec.tsc_lo, 8);
+            serial_putc(' ');
+            serial_puthex(rec.event, 2);
+            serial_putc(' ');
+            serial_puthex(rec.pid, 4);
+            serial_putc(' ');
+            serial_puthex(rec.arg, 8);
+            serial_putc('\n');
+        }
+        if (trace_cpus[i].lost != 0) {
+            serial_puts("TRACE_LOST ");
+            serial_puthex(trace_cpus[i].lost, 8);
+            serial_putc('\n');
+            trace_cpus[i].lost = 0;
+        }
+    }
+    serial_flush();
+}
+
+/* trace_open, trace_close
+ * DESCRIPTION: the rings are shared by all openers; close gives the fd back
+ * RETURN VALUE: 0, -1 if fd is not open
+ */
+int32_t trace_open(const uint8_t* filename) {
+    return 0;
+}
+
+int32_t trace_close(int32_t fd) {
+    return file_close(fd);
+}
+
+/* trace_read
+ * DESCRIPTION: drains records, as many whole ones as fit in buf
+ * INPUTS: fd, buf, nbytes
+ * OUTPUTS: trace_rec_t records in buf, oldest first
+ * RETURN VALUE: bytes read, a multiple of sizeof(trace_rec_t); 0 when
+ *               nothing is left, -1 if buf is NULL or nbytes negative
+ * SIDE EFFECTS: records read are gone for the next reader
+ */
+int32_t trace_read(int32_t fd, void* buf, int32_t nbytes) {
+    trace_rec_t* out = (trace_rec_t*)buf;
+    int32_t count = 0;
+    uint32_t i;
+
+    if (buf == NULL || nbytes < 0)
+        return -1;
+    for (i = 0; i < TRACE_CPUS; i++)
+        while ((count + 1) * (int32_t)sizeof(trace_rec_t) <= nbytes && trace_take(&trace_cpus[i], &out[count]))
+            count++;
+    return count * sizeof(trace_rec_t);
+}
+
+/* trace_write
+ * DESCRIPTION: turns tracing on or off
+ * INPUTS: fd, buf -- an int32_t, nonzero for on, nbytes -- its size
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 if buf is not an int32_t
+ * SIDE EFFECTS: none
+ */
+int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes) {
+    if (buf == NULL || nbytes != sizeof(int32_t))
+        return -1;
+    trace_on = (*(const int32_t*)buf != 0);
+    return nbytes;
+}
@@ -0,0 +1,52 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "types.h"
+
+/* Kernel event trace. Each CPU has a ring of fixed-size records stamped
+ * with the TSC; when it is full the oldest records are overwritten. The
+ * "trace" device file drains it: a read returns whole trace_rec_t records
+ * oldest first, writing a nonzero int32_t turns tracing on, 0 turns it
+ * off. "trace" on the multiboot command line turns it on at boot */
+
+/* events, the arg of the record in brackets */
+#define TRACE_NONE              0
+#define TRACE_SYSCALL_ENTER     1       /* syscall number */
+#define TRACE_SYSCALL_EXIT      2       /* return value */
+#define TRACE_IRQ_ENTER         3       /* IRQ number */
+#define TRACE_IRQ_EXIT          4       /* IRQ number */
+#define TRACE_EXCEPTION         5       /* vector */
+#define TRACE_PAGE_FAULT        6       /* faulting address */
+#define TRACE_SWITCH            7       /* pid switched to */
+
+#define TRACE_CPUS              1       /* the kernel runs on the boot CPU only */
+#define TRACE_RECORDS           4096    /* per CPU, power of 2 */
+#define TRACE_FILENAME          "trace" /* device file name for open */
+
+#ifndef ASM
+
+/* 16 bytes. pid is the low half of curr_process when the event happened,
+ * 0xFFFF for the idle loop */
+typedef struct trace_rec_t {
+    uint32_t tsc_lo;
+    uint32_t tsc_hi;
+    uint16_t event;
+    uint16_t pid;
+    uint32_t arg;
+} trace_rec_t;
+
+/* nonzero while events are recorded; the asm stubs test it before calling */
+extern int32_t trace_on;
+
+extern void trace_event(uint32_t event, uint32_t arg);
+extern void trace_dump(void);
+
+/* ops of the "trace" device file, see trace_ops in filesys.c */
+extern int32_t trace_open(const uint8_t* filename);
+extern int32_t trace_read(int32_t fd, void* buf, int32_t nbytes);
+extern int32_t trace_write(int32_t fd, const void* buf, int32_t nbytes);
+extern int32_t trace_close(int32_t fd);
+
+#endif /* ASM */
+
+#endif
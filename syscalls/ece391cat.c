@@ -7,6 +7,8 @@ int main ()
 {
     int32_t fd, cnt;
     uint8_t buf[1024];
+    uint8_t* data;
+    ece391_stat_t st;
 
     if (0 != ece391_getargs (buf, 1024)) {
         ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
@@ -18,6 +20,20 @@ int main ()
 	return 2;
     }
 
+    /* read the whole file in one call when the heap can hold it */
+    if (0 == ece391_fstat (fd, &st) && 0 != st.length &&
+        0 != (data = ece391_malloc (st.length))) {
+        cnt = ece391_read (fd, data, st.length);
+        if (-1 == cnt) {
+            ece391_fdputs (1, (uint8_t*)"file read failed\n");
+            return 3;
+        }
+        if (-1 == ece391_write (1, data, cnt))
+            return 3;
+        ece391_free (data);
+        return 0;
+    }
+
     while (0 != (cnt = ece391_read (fd, buf, 1024))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"file read failed\n");
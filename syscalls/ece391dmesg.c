@@ -0,0 +1,25 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Prints the kernel log: the boot messages and whatever the kernel
+   printed since, as far back as the kernel still keeps it. */
+
+#define BUFSIZE 1024
+
+static uint8_t buf[BUFSIZE];
+
+int main ()
+{
+    int32_t fd, cnt;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"kmsg"))) {
+        ece391_fdputs (1, (uint8_t*)"no kmsg device\n");
+        return 2;
+    }
+    while (0 < (cnt = ece391_read (fd, buf, BUFSIZE)))
+        ece391_write (1, buf, cnt);
+    ece391_close (fd);
+    return 0;
+}
@@ -3,25 +3,50 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define DBUFSIZE 4096
+#define LINESIZE 80
+#define NAMECOL  34
+
+/* Append s to the output at *len */
+static void
+out_str (uint8_t* out, int32_t* len, const uint8_t* s)
+{
+    while ('\0' != *s)
+        out[(*len)++] = *s++;
+}
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos, len, col;
+    uint8_t dbuf[DBUFSIZE];
+    /* a whole batch of lines goes out in one write */
+    uint8_t out[(DBUFSIZE / 16) * LINESIZE];
+    uint8_t num[12];
+    ece391_dirent_t* d;
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    while (0 != (cnt = ece391_getdents (fd, dbuf, DBUFSIZE))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
+	    len = 0;
+	    for (pos = 0; pos < cnt; pos += d->reclen) {
+	        d = (ece391_dirent_t*)(dbuf + pos);
+	        out_str (out, &len, (uint8_t*)d->name);
+	        for (col = d->namelen; col < NAMECOL; col++)
+	            out[len++] = ' ';
+	        out_str (out, &len, (uint8_t*)"type: ");
+	        out_str (out, &len, ece391_itoa (d->type, num, 10));
+	        out_str (out, &len, (uint8_t*)"  size: ");
+	        out_str (out, &len, ece391_itoa (d->size, num, 10));
+	        out[len++] = '\n';
+	    }
+	    if (-1 == ece391_write (1, out, len))
 	        return 3;
     }
 
@@ -0,0 +1,193 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Benchmarks of the system calls for perf/perfcheck.sh.  Each result is
+   the fastest of REPS runs, printed as "PERF <name> <value> <unit>".
+   "perfbench nop" just exits, for timing spawn. */
+
+#define REPS 5
+#define CHUNK 4096
+#define WRITE_SIZE (64 * 1024)
+#define SPAWNS 8
+#define TMP_FILE "perfbench.tmp"
+
+static uint8_t buf[CHUNK];
+
+/* Low half of the time stamp counter; runs stay far below 2^32 cycles */
+static uint32_t
+cycles ()
+{
+    uint32_t lo, hi;
+
+    asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return lo;
+}
+
+static void
+report (const char* name, uint32_t value, const char* unit)
+{
+    uint8_t num[12];
+
+    ece391_fdputs (1, (uint8_t*)"PERF ");
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, ece391_itoa (value, num, 10));
+    ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, (uint8_t*)unit);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* One run of each benchmark: returns the cycles it took and sets *units
+   to what the result is counted in, 0 if it could not run */
+
+static uint32_t
+bench_null (uint32_t* units)
+{
+    uint32_t start = cycles ();
+    int32_t i;
+
+    for (i = 0; i < 1000; i++)
+        ece391_close (-1);
+    *units = 1000;
+    return cycles () - start;
+}
+
+static uint32_t
+bench_open_close (uint32_t* units)
+{
+    uint32_t start = cycles ();
+    int32_t i, fd;
+
+    for (i = 0; i < 100; i++) {
+        if (-1 == (fd = ece391_open ((uint8_t*)"frame0.txt")))
+            return 0;
+        ece391_close (fd);
+    }
+    *units = 100;
+    return cycles () - start;
+}
+
+static uint32_t
+bench_read (uint32_t* units)
+{
+    uint32_t start, bytes = 0;
+    int32_t fd, cnt;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"fish")))
+        return 0;
+    start = cycles ();
+    while (0 < (cnt = ece391_read (fd, buf, CHUNK)))
+        bytes += cnt;
+    start = cycles () - start;
+    ece391_close (fd);
+    *units = bytes / 1024;
+    return start;
+}
+
+static uint32_t
+bench_write (uint32_t* units)
+{
+    uint32_t start, done;
+    int32_t fd;
+
+    ece391_create ((uint8_t*)TMP_FILE);
+    if (-1 == (fd = ece391_open ((uint8_t*)TMP_FILE)))
+        return 0;
+    ece391_ftruncate (fd, 0);
+    start = cycles ();
+    for (done = 0; done < WRITE_SIZE; done += CHUNK)
+        if (CHUNK != ece391_write (fd, buf, CHUNK))
+            break;
+    start = cycles () - start;
+    ece391_ftruncate (fd, 0);
+    ece391_close (fd);
+    *units = done / 1024;
+    return start;
+}
+
+static uint32_t
+bench_getdents (uint32_t* units)
+{
+    uint32_t start = cycles ();
+    int32_t fd, cnt;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)".")))
+        return 0;
+    while (0 < (cnt = ece391_getdents (fd, buf, CHUNK)))
+        ;
+    ece391_close (fd);
+    *units = 1;
+    return cycles () - start;
+}
+
+static uint32_t
+bench_pipe (uint32_t* units)
+{
+    uint32_t start;
+    int32_t fds[2], i;
+
+    if (-1 == ece391_pipe (fds))
+        return 0;
+    start = cycles ();
+    for (i = 0; i < 100; i++) {
+        ece391_write (fds[1], buf, 64);
+        ece391_read (fds[0], buf, 64);
+    }
+    start = cycles () - start;
+    ece391_close (fds[0]);
+    ece391_close (fds[1]);
+    *units = 100;
+    return start;
+}
+
+static uint32_t
+bench_spawn (uint32_t* units)
+{
+    uint32_t start = cycles ();
+    int32_t i, pid, status;
+
+    for (i = 0; i < SPAWNS; i++) {
+        if (-1 == (pid = ece391_spawn ((uint8_t*)"perfbench nop", -1, -1)))
+            return 0;
+        ece391_waitpid (pid, &status, 0);
+    }
+    *units = SPAWNS;
+    return cycles () - start;
+}
+
+/* Report the fastest of REPS runs of bench */
+static void
+run (const char* name, const char* unit, uint32_t (*bench) (uint32_t*))
+{
+    uint32_t i, took, units, best = 0xFFFFFFFF, best_units = 1;
+
+    for (i = 0; i < REPS; i++) {
+        units = 0;
+        took = bench (&units);
+        if (0 != units && took < best) {
+            best = took;
+            best_units = units;
+        }
+    }
+    if (0xFFFFFFFF != best)
+        report (name, best / best_units, unit);
+}
+
+int main ()
+{
+    uint8_t args[16];
+
+    if (0 == ece391_getargs (args, 16) && 0 == ece391_strcmp (args, (uint8_t*)"nop"))
+        return 0;
+
+    run ("u_syscall_null", "cycles/op", bench_null);
+    run ("u_open_close", "cycles/op", bench_open_close);
+    run ("u_read_4k", "cycles/KB", bench_read);
+    run ("u_write_4k", "cycles/KB", bench_write);
+    run ("u_getdents", "cycles/op", bench_getdents);
+    run ("u_pipe_64b", "cycles/op", bench_pipe);
+    run ("u_spawn_wait", "cycles/op", bench_spawn);
+    return 0;
+}
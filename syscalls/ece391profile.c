@@ -0,0 +1,41 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Sampling profiler control.  "profile start" drops the last run and starts
+   sampling on every timer tick, "profile stop" stops it, and plain
+   "profile" (or "profile dump") stops it and has the kernel send the
+   samples to COM1, for host/profsym.sh on the serial log. */
+
+#define PROFILE_STOP  0
+#define PROFILE_START 1
+#define PROFILE_DUMP  2
+
+int main ()
+{
+    uint8_t args[16];
+    int32_t fd, cmd = PROFILE_DUMP;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"profile"))) {
+        ece391_fdputs (1, (uint8_t*)"no profile device\n");
+        return 2;
+    }
+
+    if (0 == ece391_getargs (args, 16)) {
+        if (0 == ece391_strcmp (args, (uint8_t*)"start"))
+            cmd = PROFILE_START;
+        else if (0 == ece391_strcmp (args, (uint8_t*)"stop"))
+            cmd = PROFILE_STOP;
+        else if (0 != ece391_strcmp (args, (uint8_t*)"dump")) {
+            ece391_fdputs (1, (uint8_t*)"usage: profile [start|stop|dump]\n");
+            return 3;
+        }
+    }
+
+    if (-1 == ece391_write (fd, &cmd, sizeof (cmd)))
+        return 3;
+    if (PROFILE_DUMP == cmd)
+        ece391_fdputs (1, (uint8_t*)"samples sent to serial\n");
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Lists the tasks from proc/ps.  "ps -f" also lists every open file. */
+
+#define BUFSIZE 4096
+
+static uint8_t buf[BUFSIZE];
+
+/* Copy a whole proc file to stdout, 0 on success */
+static int32_t
+show (const char* name)
+{
+    int32_t fd, cnt;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)name))) {
+        ece391_fdputs (1, (uint8_t*)name);
+        ece391_fdputs (1, (uint8_t*)": no such file\n");
+        return -1;
+    }
+    while (0 < (cnt = ece391_read (fd, buf, BUFSIZE)))
+        ece391_write (1, buf, cnt);
+    ece391_close (fd);
+    return cnt;
+}
+
+int main ()
+{
+    uint8_t args[16];
+    int32_t files = 0;
+
+    if (0 == ece391_getargs (args, 16)) {
+        if (0 != ece391_strcmp (args, (uint8_t*)"-f")) {
+            ece391_fdputs (1, (uint8_t*)"usage: ps [-f]\n");
+            return 3;
+        }
+        files = 1;
+    }
+
+    if (0 != show ("proc/ps"))
+        return 2;
+    if (files) {
+        ece391_fdputs (1, (uint8_t*)"\n");
+        if (0 != show ("proc/fds"))
+            return 2;
+    }
+    return 0;
+}
@@ -4,14 +4,203 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 4
+
+/* Report background jobs that have halted since the last prompt */
+static void
+reap_jobs ()
+{
+    int32_t pid, status;
+    uint8_t num[12];
+
+    while (0 < (pid = ece391_waitpid (-1, &status, WNOHANG))) {
+        ece391_fdputs (1, (uint8_t*)"[");
+        ece391_fdputs (1, ece391_itoa (pid, num, 10));
+        ece391_fdputs (1, (uint8_t*)"] done, status ");
+        ece391_fdputs (1, ece391_itoa (status, num, 10));
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+}
+
+/* Return 1 if the command is a pipeline */
+static int32_t
+has_pipe (const uint8_t* buf)
+{
+    for (; '\0' != *buf; buf++)
+        if ('|' == *buf)
+            return 1;
+    return 0;
+}
+
+/* Strip a trailing '&' (and blanks) off the command, return 1 if found */
+static int32_t
+strip_background (uint8_t* buf, int32_t cnt)
+{
+    while (cnt > 0 && ' ' == buf[cnt - 1])
+        cnt--;
+    if (0 == cnt || '&' != buf[cnt - 1])
+        return 0;
+    cnt--;
+    while (cnt > 0 && ' ' == buf[cnt - 1])
+        cnt--;
+    buf[cnt] = '\0';
+    return 1;
+}
+
+/* Report how a foreground command ended */
+static void
+report_status (int32_t rval)
+{
+    if (-1 == rval)
+        ece391_fdputs (1, (uint8_t*)"no such command\n");
+    else if (256 == rval)
+        ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
+    else if (0 != rval)
+        ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+}
+
+/* Cut a trailing "> file" off the command and return the file name, or
+   0 if the output is not redirected (or the name is missing) */
+static uint8_t*
+strip_redirect (uint8_t* buf)
+{
+    uint8_t* name;
+    uint8_t* end;
+
+    for (name = buf; '\0' != *name && '>' != *name; name++)
+        ;
+    if ('\0' == *name)
+        return 0;
+    *name++ = '\0';
+    while (' ' == *name)
+        name++;
+    for (end = name; '\0' != *end && ' ' != *end; end++)
+        ;
+    *end = '\0';
+    return ('\0' == *name) ? 0 : name;
+}
+
+/* Open name for "> name": create it if needed and empty it.  Return the
+   fd or -1 */
+static int32_t
+open_redirect (const uint8_t* name)
+{
+    int32_t fd;
+
+    ece391_create (name);
+    if (-1 == (fd = ece391_open (name)))
+        return -1;
+    if (-1 == ece391_ftruncate (fd, 0)) {
+        ece391_close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Cut the command at each '|' into at most MAX_STAGES blank-trimmed
+   stages, return how many (0 if one is empty or there are too many) */
+static int32_t
+split_pipeline (uint8_t* buf, uint8_t** stage)
+{
+    int32_t n = 0;
+    uint8_t* end;
+
+    while (1) {
+        while (' ' == *buf)
+            buf++;
+        if (MAX_STAGES == n)
+            return 0;
+        stage[n++] = buf;
+        while ('\0' != *buf && '|' != *buf)
+            buf++;
+        end = buf;
+        while (end > stage[n - 1] && ' ' == end[-1])
+            end--;
+        if (end == stage[n - 1])
+            return 0;
+        if ('\0' == *buf) {
+            *end = '\0';
+            return n;
+        }
+        *end = '\0';
+        buf++;
+    }
+}
+
+/* Run the stages of "a | b | c" concurrently, each one's stdout feeding
+   the next one's stdin, and wait for all of them unless in background.
+   The last stage writes to out_fd, or the terminal if it is -1 */
+static void
+run_pipeline (uint8_t* buf, int32_t background, int32_t last_fd)
+{
+    uint8_t* stage[MAX_STAGES];
+    int32_t pid[MAX_STAGES];
+    int32_t fds[2];
+    int32_t n, i, started, in_fd, out_fd, status, last;
+    uint8_t num[12];
+
+    if (0 == (n = split_pipeline (buf, stage))) {
+        ece391_fdputs (1, (uint8_t*)"bad pipeline\n");
+        return;
+    }
+
+    in_fd = -1;
+    for (started = 0; started < n; started++) {
+        out_fd = -1;
+        if (started < n - 1) {
+            if (-1 == ece391_pipe (fds)) {
+                ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+                break;
+            }
+            out_fd = fds[1];
+        }
+        /* last_fd stays open in the shell, the caller closes it */
+        pid[started] = ece391_spawn (stage[started], in_fd,
+                                     (-1 != out_fd) ? out_fd : last_fd);
+        /* the children hold their own copies of the ends now */
+        if (-1 != in_fd)
+            ece391_close (in_fd);
+        if (-1 != out_fd)
+            ece391_close (out_fd);
+        in_fd = (-1 != out_fd) ? fds[0] : -1;
+        if (-1 == pid[started]) {
+            ece391_fdputs (1, (uint8_t*)"no such command\n");
+            break;
+        }
+    }
+    if (-1 != in_fd)
+        ece391_close (in_fd);
+
+    if (background && started == n) {
+        for (i = 0; i < n; i++) {
+            ece391_fdputs (1, (uint8_t*)"[");
+            ece391_fdputs (1, ece391_itoa (pid[i], num, 10));
+            ece391_fdputs (1, (uint8_t*)"] started\n");
+        }
+        return;
+    }
+
+    /* the status of the pipeline is that of its last stage */
+    last = 0;
+    for (i = 0; i < started; i++) {
+        if (-1 == ece391_waitpid (pid[i], &status, 0))
+            status = -1;
+        last = status;
+    }
+    if (started == n)
+        report_status (last);
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, background, out_fd;
     uint8_t buf[BUFSIZE];
+    uint8_t* out_name;
+    uint8_t num[12];
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+        reap_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -24,13 +213,31 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
-	if (-1 == rval)
-	    ece391_fdputs (1, (uint8_t*)"no such command\n");
-	else if (256 == rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
-	else if (0 != rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+	background = strip_background (buf, cnt);
+	if (0 != (out_name = strip_redirect (buf))) {
+	    if (-1 == (out_fd = open_redirect (out_name))) {
+		ece391_fdputs (1, (uint8_t*)"cannot write file\n");
+		continue;
+	    }
+	    run_pipeline (buf, background, out_fd);
+	    ece391_close (out_fd);
+	    continue;
+	}
+	if (0 != has_pipe (buf)) {
+	    run_pipeline (buf, background, -1);
+	    continue;
+	}
+	if (background) {
+	    if (-1 == (rval = ece391_spawn (buf, -1, -1))) {
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+		continue;
+	    }
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (rval, num, 10));
+	    ece391_fdputs (1, (uint8_t*)"] started\n");
+	    continue;
+	}
+	report_status (ece391_execute (buf));
     }
 }
 
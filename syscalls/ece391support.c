@@ -102,3 +102,228 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+/* Wait for any child to halt */
+int32_t ece391_wait(int32_t* status)
+{
+    return ece391_waitpid (-1, status, 0);
+}
+
+/* Atomically replace *p with val if it holds old; returns the old value */
+static int32_t atomic_cmpxchg(int32_t* p, int32_t old, int32_t val)
+{
+    int32_t prev;
+
+    asm volatile ("lock; cmpxchgl %2, %1"
+            : "=a" (prev), "+m" (*p)
+            : "r" (val), "0" (old)
+            : "memory", "cc");
+    return prev;
+}
+
+/* Atomically store val in *p; returns the old value */
+static int32_t atomic_xchg(int32_t* p, int32_t val)
+{
+    asm volatile ("xchgl %0, %1"
+            : "+r" (val), "+m" (*p)
+            :
+            : "memory");
+    return val;
+}
+
+/* Atomically add n to *p; returns the old value */
+static int32_t atomic_add(int32_t* p, int32_t n)
+{
+    asm volatile ("lock; xaddl %0, %1"
+            : "+r" (n), "+m" (*p)
+            :
+            : "memory", "cc");
+    return n;
+}
+
+/* Take the mutex, sleeping in the kernel only when it is contended */
+void ece391_mutex_lock(ece391_mutex_t* m)
+{
+    int32_t c;
+
+    if ((c = atomic_cmpxchg(&m->state, 0, 1)) == 0)
+        return;
+    /* mark it contended so the holder knows to wake someone */
+    if (c != 2)
+        c = atomic_xchg(&m->state, 2);
+    while (c != 0) {
+        ece391_futex_wait(&m->state, 2);
+        c = atomic_xchg(&m->state, 2);
+    }
+}
+
+/* Take the mutex if it is free; returns 0 on success, -1 if held */
+int32_t ece391_mutex_trylock(ece391_mutex_t* m)
+{
+    return atomic_cmpxchg(&m->state, 0, 1) == 0 ? 0 : -1;
+}
+
+/* Release the mutex, waking one sleeper if there were any */
+void ece391_mutex_unlock(ece391_mutex_t* m)
+{
+    if (atomic_xchg(&m->state, 0) == 2)
+        ece391_futex_wake(&m->state, 1);
+}
+
+/* Release m, sleep until signalled, then take m again */
+void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m)
+{
+    int32_t seq = c->seq;
+
+    atomic_add(&c->waiters, 1);
+    ece391_mutex_unlock(m);
+    /* returns at once if a signal already bumped seq */
+    ece391_futex_wait(&c->seq, seq);
+    atomic_add(&c->waiters, -1);
+    /* others may be queued behind us, so lock in the contended state */
+    while (atomic_xchg(&m->state, 2) != 0)
+        ece391_futex_wait(&m->state, 2);
+}
+
+/* Wake one thread waiting on c; free when nobody waits */
+void ece391_cond_signal(ece391_cond_t* c)
+{
+    if (c->waiters == 0)
+        return;
+    atomic_add(&c->seq, 1);
+    ece391_futex_wake(&c->seq, 1);
+}
+
+/* Wake every thread waiting on c */
+void ece391_cond_broadcast(ece391_cond_t* c)
+{
+    if (c->waiters == 0)
+        return;
+    atomic_add(&c->seq, 1);
+    ece391_futex_wake(&c->seq, c->waiters);
+}
+
+/*
+ * Heap allocator.  Requests up to MALLOC_MAX_CLASS bytes are rounded up to
+ * a power-of-two size class and served from a free list per class, refilled
+ * by carving MALLOC_CHUNK bytes at a time from sbrk.  Bigger requests get
+ * whole pages from sbrk and are kept on one first-fit list once freed.
+ * Every block starts with a header holding its usable size.
+ */
+#define MALLOC_MIN_SHIFT    4                   /* smallest class, 16 bytes */
+#define MALLOC_NUM_CLASSES  8                   /* 16 .. 2048 bytes */
+#define MALLOC_MAX_CLASS    (1 << (MALLOC_MIN_SHIFT + MALLOC_NUM_CLASSES - 1))
+#define MALLOC_CHUNK        0x10000             /* sbrk step for small blocks */
+#define MALLOC_PAGE         4096
+#define MALLOC_HDR          8                   /* keeps blocks 8-byte aligned */
+
+typedef struct malloc_block {
+    uint32_t size;                  /* usable bytes after the header */
+    struct malloc_block* next;      /* free list link, unused while allocated */
+} malloc_block_t;
+
+static malloc_block_t* malloc_free_class[MALLOC_NUM_CLASSES];
+static malloc_block_t* malloc_free_large;
+static uint8_t* malloc_chunk;       /* unused part of the last small-block chunk */
+static uint8_t* malloc_chunk_end;
+static ece391_mutex_t malloc_lock;
+
+/* Size class index for size bytes */
+static int32_t malloc_class(uint32_t size)
+{
+    int32_t c = 0;
+
+    while ((uint32_t)(1 << (MALLOC_MIN_SHIFT + c)) < size)
+        c++;
+    return c;
+}
+
+/* Cut a new block of class c from the chunk, 0 if the heap is full */
+static malloc_block_t* malloc_carve(int32_t c)
+{
+    uint32_t need = MALLOC_HDR + (1 << (MALLOC_MIN_SHIFT + c));
+    malloc_block_t* b;
+    int32_t p;
+
+    if (malloc_chunk_end - malloc_chunk < need) {
+        /* the rest of the old chunk is lost, it is at most one block */
+        if (-1 == (p = ece391_sbrk (MALLOC_CHUNK)))
+            return 0;
+        if ((uint8_t*)p != malloc_chunk_end)
+            malloc_chunk = (uint8_t*)p;
+        malloc_chunk_end = (uint8_t*)p + MALLOC_CHUNK;
+    }
+    b = (malloc_block_t*)malloc_chunk;
+    b->size = 1 << (MALLOC_MIN_SHIFT + c);
+    malloc_chunk += need;
+    return b;
+}
+
+/* Find a freed large block of at least size bytes, or get a new one */
+static malloc_block_t* malloc_large(uint32_t size)
+{
+    malloc_block_t** link;
+    malloc_block_t* b;
+    uint32_t total;
+    int32_t p;
+
+    for (link = &malloc_free_large; 0 != *link; link = &(*link)->next) {
+        if ((*link)->size >= size) {
+            b = *link;
+            *link = b->next;
+            return b;
+        }
+    }
+
+    total = (size + MALLOC_HDR + MALLOC_PAGE - 1) & ~(MALLOC_PAGE - 1);
+    if (-1 == (p = ece391_sbrk (total)))
+        return 0;
+    b = (malloc_block_t*)p;
+    b->size = total - MALLOC_HDR;
+    return b;
+}
+
+/* Allocate size bytes, 0 if the heap is exhausted */
+void* ece391_malloc(uint32_t size)
+{
+    malloc_block_t* b;
+    int32_t c;
+
+    if (0 == size)
+        return 0;
+
+    ece391_mutex_lock (&malloc_lock);
+    if (size > MALLOC_MAX_CLASS) {
+        b = malloc_large (size);
+    } else {
+        c = malloc_class (size);
+        if (0 != (b = malloc_free_class[c]))
+            malloc_free_class[c] = b->next;
+        else
+            b = malloc_carve (c);
+    }
+    ece391_mutex_unlock (&malloc_lock);
+
+    return (0 == b) ? 0 : (uint8_t*)b + MALLOC_HDR;
+}
+
+/* Give back a block from ece391_malloc */
+void ece391_free(void* ptr)
+{
+    malloc_block_t* b;
+    int32_t c;
+
+    if (0 == ptr)
+        return;
+    b = (malloc_block_t*)((uint8_t*)ptr - MALLOC_HDR);
+
+    ece391_mutex_lock (&malloc_lock);
+    if (b->size > MALLOC_MAX_CLASS) {
+        b->next = malloc_free_large;
+        malloc_free_large = b;
+    } else {
+        c = malloc_class (b->size);
+        b->next = malloc_free_class[c];
+        malloc_free_class[c] = b;
+    }
+    ece391_mutex_unlock (&malloc_lock);
+}
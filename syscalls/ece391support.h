@@ -8,6 +8,29 @@ extern int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
 extern int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
 extern uint8_t *ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
 extern uint8_t *ece391_strrev(uint8_t* s);
+extern int32_t ece391_wait(int32_t* status);
+
+/* Futex-backed locks; zero-initialize before use. The fast paths never
+   enter the kernel. */
+typedef struct ece391_mutex {
+    int32_t state;      /* 0 unlocked, 1 locked, 2 locked with sleepers */
+} ece391_mutex_t;
+
+typedef struct ece391_cond {
+    int32_t seq;        /* bumped on every signal, the futex word */
+    int32_t waiters;    /* threads inside ece391_cond_wait */
+} ece391_cond_t;
+
+extern void ece391_mutex_lock(ece391_mutex_t* m);
+extern int32_t ece391_mutex_trylock(ece391_mutex_t* m);
+extern void ece391_mutex_unlock(ece391_mutex_t* m);
+extern void ece391_cond_wait(ece391_cond_t* c, ece391_mutex_t* m);
+extern void ece391_cond_signal(ece391_cond_t* c);
+extern void ece391_cond_broadcast(ece391_cond_t* c);
+
+/* Heap allocator on top of sbrk, safe to call from several threads */
+extern void* ece391_malloc(uint32_t size);
+extern void ece391_free(void* ptr);
 
 #endif /* ECE391SUPPORT_H */
 
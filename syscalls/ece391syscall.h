@@ -22,6 +22,132 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * spawn starts a program without waiting for it and returns its pid.
+ * The child gets the caller's in_fd/out_fd as its stdin/stdout (e.g. pipe
+ * ends); -1 leaves it on the terminal.
+ * waitpid collects a halted child (pid -1 for any child) and returns its
+ * pid; with WNOHANG it returns 0 instead of blocking when no child has
+ * halted yet.  Pid 0 is the root shell, so it is never a child.
+ */
+extern int32_t ece391_spawn (const uint8_t* command, int32_t in_fd, int32_t out_fd);
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t options);
+
+#define WNOHANG 1
+
+/*
+ * thread_create runs entry(arg) as another thread of the calling program,
+ * on the stack that ends at stack_top (caller-provided memory).  The thread
+ * shares the program's memory and open files.  The function must finish
+ * with ece391_halt, which ends just that thread; ece391_waitpid on the
+ * returned id joins it.  Halting the main thread ends all of them.
+ */
+extern int32_t ece391_thread_create (void (*entry)(void*), void* arg, void* stack_top);
+
+/*
+ * futex_wait sleeps as long as *addr still equals expected and returns 0
+ * once woken, or -1 straight away if the value already changed.
+ * futex_wake wakes up to n sleepers on addr and returns how many woke.
+ * Use the mutex/condvar wrappers in ece391support.h rather than these.
+ */
+extern int32_t ece391_futex_wait (int32_t* addr, int32_t expected);
+extern int32_t ece391_futex_wake (int32_t* addr, int32_t n);
+
+/*
+ * pipe opens a pipe, fds[0] reads what is written to fds[1].  Reads block
+ * while it is empty and return 0 once every write end is closed; writes
+ * block while it is full and fail once every read end is closed.  A read
+ * of 0 bytes returns 0 on a pipe and -1 on the keyboard.
+ */
+extern int32_t ece391_pipe (int32_t fds[2]);
+
+/*
+ * shm_map maps the shared memory segment named key, creating it with size
+ * bytes of zeroed memory if no program has it mapped; size may not exceed
+ * the size of an existing segment.  addr picks a page-aligned address at
+ * or above 0x0C000000, or 0 lets the kernel choose.  Returns the address,
+ * or -1.  shm_unmap takes that address back; the memory is freed when the
+ * last program unmaps it or halts.
+ */
+extern int32_t ece391_shm_map (int32_t key, uint32_t size, void* addr);
+extern int32_t ece391_shm_unmap (void* addr);
+
+/*
+ * mmap maps the first len bytes of the open file fd read-only and returns
+ * their address, or -1; len may not exceed the file length.  The mapping
+ * shares the file system's memory, so no bytes are copied.  Bytes after
+ * the end of the file up to the page end read as 0.  munmap removes it.
+ */
+extern int32_t ece391_mmap (int32_t fd, uint32_t len);
+extern int32_t ece391_munmap (void* addr);
+
+/*
+ * The heap runs from 0x08800000 up to the break, at most to 0x0C000000.
+ * brk sets the break (0 or -1); sbrk moves it by increment bytes and
+ * returns the old break, or -1.  Pages are backed with zeroed memory the
+ * first time they are touched.  Use ece391_malloc/ece391_free instead.
+ */
+extern int32_t ece391_brk (void* addr);
+extern int32_t ece391_sbrk (int32_t increment);
+
+/*
+ * getdents fills buf with as many directory entries of the open directory
+ * fd as fit, as ece391_dirent records packed one after the other (step by
+ * reclen).  Returns the bytes filled, 0 at the end of the directory, or -1
+ * (also when buf cannot hold even one record).
+ */
+typedef struct ece391_dirent {
+    uint32_t inode;
+    uint32_t size;          /* length of a regular file, else 0 */
+    uint16_t reclen;        /* bytes to the next record */
+    uint8_t type;           /* 0 rtc, 1 directory, 2 regular file */
+    uint8_t namelen;
+    int8_t name[];          /* NUL terminated */
+} ece391_dirent_t;
+
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+
+/*
+ * stat describes the file called name, fstat the open file fd.  st must be
+ * on the stack or among the program's globals.  Both return 0 or -1.
+ */
+#define ECE391_TYPE_RTC      0
+#define ECE391_TYPE_DIR      1
+#define ECE391_TYPE_FILE     2
+#define ECE391_TYPE_PIPE     3      /* fstat only */
+#define ECE391_TYPE_TERMINAL 4      /* fstat only */
+#define ECE391_TYPE_SERIAL   5      /* the "serial" device, output only */
+#define ECE391_TYPE_TRACE    6      /* the "trace" device, see tracedump */
+#define ECE391_TYPE_SYSSTAT  7      /* the "sysstat" device, see sysstat */
+#define ECE391_TYPE_PROC     8      /* "proc" and the text files in it */
+#define ECE391_TYPE_PROFILE  9      /* the "profile" device, see profile */
+#define ECE391_TYPE_KMSG     10     /* the "kmsg" device, see dmesg */
+
+typedef struct ece391_stat {
+    uint32_t type;
+    uint32_t inode;
+    uint32_t length;        /* bytes, 0 unless a regular file */
+    uint32_t blocks;        /* 4KB blocks */
+} ece391_stat_t;
+
+extern int32_t ece391_stat (const uint8_t* name, ece391_stat_t* st);
+extern int32_t ece391_fstat (int32_t fd, ece391_stat_t* st);
+
+/*
+ * create makes an empty regular file (names are at most 31 characters) and
+ * fails if the name is taken; open it to write.  Writes go at the file
+ * position and grow the file.  ftruncate sets the length of an open file,
+ * lseek moves its position and returns the new one.  Files live in memory
+ * and are gone after a reboot.
+ */
+#define ECE391_SEEK_SET 0
+#define ECE391_SEEK_CUR 1
+#define ECE391_SEEK_END 2
+
+extern int32_t ece391_create (const uint8_t* name);
+extern int32_t ece391_ftruncate (int32_t fd, uint32_t length);
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
@@ -11,5 +11,23 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_SPAWN   11
+#define SYS_WAITPID 12
+#define SYS_THREAD_CREATE 13
+#define SYS_FUTEX_WAIT 14
+#define SYS_FUTEX_WAKE 15
+#define SYS_PIPE    16
+#define SYS_SHM_MAP 17
+#define SYS_SHM_UNMAP 18
+#define SYS_MMAP    19
+#define SYS_MUNMAP  20
+#define SYS_BRK     21
+#define SYS_SBRK    22
+#define SYS_GETDENTS 23
+#define SYS_STAT    24
+#define SYS_FSTAT   25
+#define SYS_CREATE  26
+#define SYS_FTRUNCATE 27
+#define SYS_LSEEK   28
 
 #endif /* ECE391SYSNUM_H */
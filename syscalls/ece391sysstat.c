@@ -0,0 +1,111 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* System call latency.  "sysstat on" clears the kernel's histograms and
+   starts timing every system call, "sysstat off" stops it, and plain
+   "sysstat" prints calls, errors, p50, p99 and max in cycles for each call
+   made so far.  The histograms have a bucket per power of 2, so p50 and
+   p99 are the upper end of the bucket the percentile falls in. */
+
+#define CALLS 29
+#define BUCKETS 32
+
+/* a record of the "sysstat" device */
+typedef struct sysstat {
+    uint32_t num;
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t max;
+    uint32_t buckets[BUCKETS];
+} sysstat_t;
+
+static const char* names[CALLS] = {
+    "?", "halt", "execute", "read", "write", "open", "close", "getargs",
+    "vidmap", "set_handler", "sigreturn", "spawn", "waitpid",
+    "thread_create", "futex_wait", "futex_wake", "pipe", "shm_map",
+    "shm_unmap", "mmap", "munmap", "brk", "sbrk", "getdents", "stat",
+    "fstat", "create", "ftruncate", "lseek"
+};
+
+static sysstat_t stats[CALLS];
+
+/* Print s, then blanks up to width */
+static void
+put_col (const uint8_t* s, uint32_t width)
+{
+    uint32_t len = ece391_strlen (s);
+
+    ece391_fdputs (1, s);
+    while (len++ < width)
+        ece391_fdputs (1, (uint8_t*)" ");
+}
+
+/* Print value right aligned in width */
+static void
+put_num (uint32_t value, uint32_t width)
+{
+    uint8_t num[12];
+    uint32_t len;
+
+    ece391_itoa (value, num, 10);
+    for (len = ece391_strlen (num); len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, num);
+}
+
+/* Upper end in cycles of the bucket that holds the call ranked rank, 1 up */
+static uint32_t
+percentile (const sysstat_t* st, uint32_t rank)
+{
+    uint32_t b, seen = 0;
+
+    for (b = 0; b < BUCKETS - 1; b++) {
+        seen += st->buckets[b];
+        if (seen >= rank)
+            break;
+    }
+    return (2u << b) - 1;
+}
+
+int main ()
+{
+    uint8_t args[16];
+    int32_t fd, cnt, i, on;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"sysstat"))) {
+        ece391_fdputs (1, (uint8_t*)"no sysstat device\n");
+        return 2;
+    }
+
+    if (0 == ece391_getargs (args, 16)) {
+        on = (0 == ece391_strcmp (args, (uint8_t*)"on"));
+        if (!on && 0 != ece391_strcmp (args, (uint8_t*)"off")) {
+            ece391_fdputs (1, (uint8_t*)"usage: sysstat [on|off]\n");
+            return 3;
+        }
+        return -1 == ece391_write (fd, &on, sizeof (on)) ? 3 : 0;
+    }
+
+    if (0 >= (cnt = ece391_read (fd, stats, sizeof (stats)))) {
+        ece391_fdputs (1, (uint8_t*)"cannot read sysstat\n");
+        return 3;
+    }
+
+    ece391_fdputs (1, (uint8_t*)"syscall          calls   errors      p50      p99      max\n");
+    for (i = 0; i < cnt / (int32_t)sizeof (sysstat_t); i++) {
+        sysstat_t* st = &stats[i];
+
+        if (0 == st->calls || st->num >= CALLS)
+            continue;
+        put_col ((uint8_t*)names[st->num], 14);
+        put_num (st->calls, 8);
+        put_num (st->errors, 9);
+        put_num (percentile (st, st->calls - st->calls / 2), 9);
+        put_num (percentile (st, st->calls - st->calls / 100), 9);
+        put_num (st->max, 9);
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+    return 0;
+}
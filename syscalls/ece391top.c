@@ -0,0 +1,177 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Shows the share of the cpu each task got, from the PIT ticks in
+   proc/uptime and proc/ps, once a second.  "top n" stops after n screens,
+   5 by default; the first one covers the time since boot. */
+
+#define BUFSIZE 4096
+#define MAX_TASKS 8
+#define SCREENS 5
+#define RTC_HZ 2
+
+typedef struct task {
+    uint32_t pid;
+    uint32_t ticks;
+    uint8_t* state;
+    uint8_t* name;
+} task_t;
+
+static uint8_t buf[BUFSIZE];
+static task_t tasks[MAX_TASKS];
+static uint32_t last_ticks[MAX_TASKS];  /* by pid, at the last screen */
+
+/* Read a whole proc file into buf as a string, return its length or -1 */
+static int32_t
+read_proc (const char* name)
+{
+    int32_t fd, cnt, len = 0;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)name)))
+        return -1;
+    while (len < BUFSIZE - 1 && 0 < (cnt = ece391_read (fd, buf + len, BUFSIZE - 1 - len)))
+        len += cnt;
+    ece391_close (fd);
+    buf[len] = '\0';
+    return len;
+}
+
+/* Cut the next blank separated word off *p, NUL terminate it, return it */
+static uint8_t*
+next_word (uint8_t** p)
+{
+    uint8_t* word;
+
+    while (' ' == **p)
+        (*p)++;
+    word = *p;
+    while ('\0' != **p && ' ' != **p && '\n' != **p)
+        (*p)++;
+    if (' ' == **p)
+        *(*p)++ = '\0';
+    return word;
+}
+
+/* Skip to the start of the next line */
+static void
+next_line (uint8_t** p)
+{
+    while ('\0' != **p && '\n' != **p)
+        (*p)++;
+    if ('\n' == **p)
+        *(*p)++ = '\0';
+}
+
+static uint32_t
+to_num (const uint8_t* s)
+{
+    uint32_t n = 0;
+
+    while (*s >= '0' && *s <= '9')
+        n = n * 10 + (*s++ - '0');
+    return n;
+}
+
+static void
+put_num (uint32_t value, uint32_t width)
+{
+    uint8_t num[12];
+    uint32_t len;
+
+    ece391_itoa (value, num, 10);
+    for (len = ece391_strlen (num); len < width; len++)
+        ece391_fdputs (1, (uint8_t*)" ");
+    ece391_fdputs (1, num);
+}
+
+/* Parse proc/ps in buf into tasks, return how many there are */
+static int32_t
+parse_ps ()
+{
+    uint8_t* p = buf;
+    int32_t n = 0;
+
+    next_line (&p);                     /* header */
+    while ('\0' != *p && n < MAX_TASKS) {
+        tasks[n].pid = to_num (next_word (&p));
+        next_word (&p);                 /* parent */
+        next_word (&p);                 /* owner */
+        next_word (&p);                 /* terminal */
+        tasks[n].state = next_word (&p);
+        tasks[n].ticks = to_num (next_word (&p));
+        tasks[n].name = next_word (&p);
+        next_line (&p);
+        if (tasks[n].pid < MAX_TASKS)
+            n++;
+    }
+    return n;
+}
+
+int main ()
+{
+    uint8_t args[16];
+    uint8_t* p;
+    uint32_t screens = SCREENS, screen, ticks, idle, dt, di, dtask;
+    uint32_t last = 0, last_idle = 0;
+    int32_t rtc, n, i, garbage;
+
+    if (0 == ece391_getargs (args, 16) && 0 == (screens = to_num (args))) {
+        ece391_fdputs (1, (uint8_t*)"usage: top [screens]\n");
+        return 3;
+    }
+    if (-1 == (rtc = ece391_open ((uint8_t*)"rtc")))
+        return 2;
+    garbage = RTC_HZ;
+    ece391_write (rtc, &garbage, 4);
+
+    for (screen = 0; screen < screens; screen++) {
+        if (screen > 0)
+            for (i = 0; i < RTC_HZ; i++)
+                ece391_read (rtc, &garbage, 4);
+
+        if (-1 == read_proc ("proc/uptime")) {
+            ece391_fdputs (1, (uint8_t*)"no proc files\n");
+            return 2;
+        }
+        p = buf;
+        ticks = to_num (next_word (&p));
+        idle = to_num (next_word (&p));
+        dt = ticks - last;
+        di = idle - last_idle;
+        last = ticks;
+        last_idle = idle;
+        if (0 == dt)
+            dt = 1;
+
+        if (-1 == read_proc ("proc/ps"))
+            return 2;
+        n = parse_ps ();
+
+        ece391_fdputs (1, (uint8_t*)"\n  PID STATE     %CPU    TICKS NAME\n");
+        for (i = 0; i < n; i++) {
+            /* a new task in a slot starts from 0 again */
+            dtask = tasks[i].ticks >= last_ticks[tasks[i].pid]
+                  ? tasks[i].ticks - last_ticks[tasks[i].pid] : tasks[i].ticks;
+            last_ticks[tasks[i].pid] = tasks[i].ticks;
+            put_num (tasks[i].pid, 5);
+            ece391_fdputs (1, (uint8_t*)" ");
+            ece391_fdputs (1, tasks[i].state);
+            for (garbage = ece391_strlen (tasks[i].state); garbage < 8; garbage++)
+                ece391_fdputs (1, (uint8_t*)" ");
+            put_num (dtask * 100 / dt, 5);
+            put_num (tasks[i].ticks, 9);
+            ece391_fdputs (1, (uint8_t*)" ");
+            ece391_fdputs (1, tasks[i].name);
+            ece391_fdputs (1, (uint8_t*)"\n");
+        }
+        ece391_fdputs (1, (uint8_t*)"idle ");
+        put_num (di * 100 / dt, 3);
+        ece391_fdputs (1, (uint8_t*)"% of ");
+        put_num (dt, 0);
+        ece391_fdputs (1, (uint8_t*)" ticks\n");
+    }
+    ece391_close (rtc);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+/* Kernel trace control.  "tracedump on" and "tracedump off" start and stop
+   recording; plain "tracedump" stops it and sends every record left in the
+   kernel's rings to COM1 as lines of
+       TRACE <tsc> <event> <pid> <arg>
+   in hex, for host/tracedecode on the serial log. */
+
+#define RECS 64
+
+/* a record of the "trace" device, 16 bytes */
+typedef struct trace_rec {
+    uint32_t tsc_lo;
+    uint32_t tsc_hi;
+    uint16_t event;
+    uint16_t pid;
+    uint32_t arg;
+} trace_rec_t;
+
+static trace_rec_t recs[RECS];
+static uint8_t line[64];
+
+/* Write value as digits hex digits at p, return the end */
+static uint8_t*
+put_hex (uint8_t* p, uint32_t value, int32_t digits)
+{
+    while (digits-- > 0)
+        *p++ = "0123456789abcdef"[(value >> (digits * 4)) & 0xF];
+    return p;
+}
+
+static int32_t
+set_tracing (int32_t fd, int32_t on)
+{
+    return ece391_write (fd, &on, sizeof (on));
+}
+
+int main ()
+{
+    uint8_t args[16], num[12];
+    int32_t fd, serial, cnt, i;
+    uint32_t total = 0;
+    uint8_t* p;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"trace"))) {
+        ece391_fdputs (1, (uint8_t*)"no trace device\n");
+        return 2;
+    }
+
+    if (0 == ece391_getargs (args, 16)) {
+        if (0 == ece391_strcmp (args, (uint8_t*)"on"))
+            return -1 == set_tracing (fd, 1) ? 3 : 0;
+        if (0 == ece391_strcmp (args, (uint8_t*)"off"))
+            return -1 == set_tracing (fd, 0) ? 3 : 0;
+        ece391_fdputs (1, (uint8_t*)"usage: tracedump [on|off]\n");
+        return 3;
+    }
+
+    /* our own reads would keep the trace from ever running dry */
+    set_tracing (fd, 0);
+    if (-1 == (serial = ece391_open ((uint8_t*)"serial"))) {
+        ece391_fdputs (1, (uint8_t*)"no serial device\n");
+        return 2;
+    }
+
+    while (0 < (cnt = ece391_read (fd, recs, sizeof (recs)))) {
+        for (i = 0; i < cnt / (int32_t)sizeof (trace_rec_t); i++) {
+            p = line;
+            ece391_strcpy (p, (uint8_t*)"TRACE ");
+            p += 6;
+            p = put_hex (p, recs[i].tsc_hi, 8);
+            p = put_hex (p, recs[i].tsc_lo, 8);
+            *p++ = ' ';
+            p = put_hex (p, recs[i].event, 2);
+            *p++ = ' ';
+            p = put_hex (p, recs[i].pid, 4);
+            *p++ = ' ';
+            p = put_hex (p, recs[i].arg, 8);
+            *p++ = '\n';
+            ece391_write (serial, line, p - line);
+            total++;
+        }
+    }
+
+    ece391_fdputs (1, ece391_itoa (total, num, 10));
+    ece391_fdputs (1, (uint8_t*)" records sent to serial\n");
+    return 0;
+}